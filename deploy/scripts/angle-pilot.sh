@@ -0,0 +1,9 @@
+#! /usr/bin/sh
+
+# This script starts the fused Cone Detector and Angle Calculator,
+# which calculates the steering value without the shared memory hop
+echo "Starting fused Cone Detector and Angle Calculator"
+docker run --rm -it --init --net=host -v /tmp:/tmp \
+--ipc=host --entrypoint /usr/bin/angle-pilot \
+registry.git.chalmers.se/courses/dit638/students/2023-group-13/cone-detector:v1.0.0 \
+--cid=253 --name=img --width=640 --height=480 --z=55 --m=75 --y=-0.5 --l=3 --b=0 --trace
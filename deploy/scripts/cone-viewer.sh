@@ -0,0 +1,10 @@
+#! /usr/bin/sh
+
+# This script shows what the Cone Detector finds in verbose mode,
+# drawn on a copy of the frames outside of the Cone Detector
+xhost +
+echo "Starting Cone Viewer"
+docker run --rm -it --init -e DISPLAY=$DISPLAY -v /tmp:/tmp \
+--ipc=host --entrypoint /usr/bin/cone-viewer \
+registry.git.chalmers.se/courses/dit638/students/2023-group-13/cone-detector:v1.0.0 \
+--name=img --width=640 --height=480
@@ -0,0 +1,9 @@
+#! /usr/bin/sh
+
+# This script captures the decoded frames into a frame store,
+# which the Cone Detector can replay with --replay
+echo "Starting Frame Capture"
+docker run --rm -it --init --net=host -v /tmp:/tmp \
+--ipc=host --entrypoint /usr/bin/frame-capture \
+registry.git.chalmers.se/courses/dit638/students/2023-group-13/cone-detector:v1.0.0 \
+--name=img --width=640 --height=480 --out=/tmp/frames.store --rows=270:400
@@ -0,0 +1,7 @@
+#! /usr/bin/sh
+
+# This script shows the statistics the Cone Detector, angle-pilot
+# and the Angle Calculator publish in shared memory, live
+echo "Starting Pipeline Top"
+docker run --rm -it --init --ipc=host --entrypoint /usr/bin/pipeline-top \
+registry.git.chalmers.se/courses/dit638/students/2023-group-13/angle-calculator:v1.0.0
@@ -0,0 +1,451 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Benchmarks every step of the steering calculation, and the
+// whole chain, on generated cone layouts. Besides layouts like
+// the ones on the track it generates the edge cases the
+// calculation branches on: vertical lines (INF_SLOPE), sides
+// without cones (NO_CONE_POS) and parallel lines. With --check
+// it instead checks that the statistics of the accuracy test
+// merge into the same result as when accumulated in one go.
+
+// The steering calculation to benchmark
+#include "steering.hpp"
+
+// The timing and reporting helpers
+#include "../api/bench.hpp"
+
+// The hardware counters of the CPU
+#include "../api/perf-counters.hpp"
+
+// The statistics of the accuracy test, checked with --check
+#include "angle-validator.hpp"
+
+// Include the standard int types of C
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Declares a set of function to compute common mathematical operations.
+#include <math.h>
+
+// The number of distinct layouts each benchmark cycles through
+#define INPUT_COUNT 4096
+
+// The size of the frame the layouts are generated for,
+// which is the cropped frame of the cone detector
+#define FRAME_WIDTH 640
+#define FRAME_HEIGHT 110
+
+// The number of frames of the error stream the merge check splits
+#define CHECK_FRAMES 100000
+
+// The largest relative difference of the merged mean and M2
+#define CHECK_TOLERANCE 1e-9
+
+/*
+ * The kinds of cone layouts that can be generated
+ */
+enum Layout {
+    // Blue cones on the left, yellow cones on the right,
+    // both edges leaning towards the middle of the frame
+    REALISTIC,
+
+    // Both cones of each side straight above each other
+    VERTICAL,
+
+    // One or both sides without any cones
+    MISSING,
+
+    // Both edges with the same slope
+    PARALLEL,
+
+    // All of the above, picked at random per layout
+    MIXED,
+
+    // The number of layouts
+    LAYOUT_KINDS
+};
+
+// The names of the layouts, in the order of Layout
+const char *const LAYOUT_NAMES[LAYOUT_KINDS] = {
+    "realistic",
+    "vertical",
+    "missing",
+    "parallel",
+    "mixed"
+};
+
+/**
+ * Generates cone data for a layout
+ *
+ * @param layout the kind of layout to generate
+ * @param rng the random number generator to use
+ * @return the generated cone data
+ */
+pos_api::data_t generate(Layout layout, std::mt19937 &rng);
+
+/**
+ * Counts one call of a steering calculation per layout with the
+ * hardware counters, and adds the counts per call of the counters
+ * that are counted. The counters are read once around all of the
+ * calls, so the reads don't add to the counts
+ *
+ * @param name the name of the metrics, followed by the counter
+ * @param steer the steering calculation to count
+ * @param data the layouts to count it on
+ * @param counters the counters to count with
+ * @param metrics the metrics to add to
+ */
+void addCounts(const std::string &name, _Float32 (*steer)(const pos_api::data_t), const std::vector<pos_api::data_t> &data,
+               const perf_counters::Counters &counters, std::vector<bench::metric_t> &metrics);
+
+/**
+ * Splits a generated stream of steering values and ground steering
+ * requests in two at several points and windows of several sizes,
+ * accumulates each part in statistics of its own, merges them and
+ * compares the result with the statistics of the whole stream
+ *
+ * @return whether every merge matched
+ */
+bool checkMerge();
+
+/**
+ * Gets the pass or fail bits of the sliding window, oldest first,
+ * as they don't start at the same position in every instance
+ *
+ * @param stats the statistics holding the window
+ * @return the bits of the window
+ */
+std::vector<bool> windowBits(const ang_vld::stats_t &stats);
+
+/**
+ * Gets the relative difference of two values
+ *
+ * @param a the one value
+ * @param b the other value
+ * @return the difference relative to the larger of them
+ */
+double relativeDifference(double a, double b);
+
+// Main entry point
+int32_t main(int32_t argc, char **argv)
+{
+    auto cmdargs = cluon::getCommandlineArguments(argc, argv);
+    if (cmdargs.count("help"))
+    {
+        std::cerr << argv[0] << " benchmarks the steering calculation on generated cone layouts." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " [--ops=<operations>] [--layout=<layout>] [--json=<file>] [--check]" << std::endl;
+        std::cerr << "         --ops: number of operations to time per benchmark (int, default 5000000)" << std::endl;
+        std::cerr << "         --layout: only benchmark one of realistic, vertical, missing, parallel or mixed" << std::endl;
+        std::cerr << "         --json: file to write the results to as JSON, along with the hardware counts per call where the CPU's counters can be read" << std::endl;
+        std::cerr << "         --check: check that merged statistics of the accuracy test match the ones of the whole run instead, exits with 1 if they don't" << std::endl;
+        std::cerr << "Example: " << argv[0] << " --ops=1000000 --json=angle-calculator.json" << std::endl;
+        return 1;
+    }
+
+    if (cmdargs.count("check"))
+    {
+        bool passed = checkMerge();
+        std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+        return passed ? 0 : 1;
+    }
+
+    // The parameters the angle calculator is deployed with
+    ang_calc::configure(FRAME_WIDTH, FRAME_HEIGHT, 55.0f, 75.0f, -0.5f, 3.0f, 0.0f);
+
+    uint64_t ops = cmdargs.count("ops") ? std::stoull(cmdargs["ops"]) : 5000000;
+    const uint32_t MASK = INPUT_COUNT - 1;
+    const ang_calc::point_t origin = ang_calc::getOrigin();
+    std::vector<bench::result_t> results;
+    std::vector<bench::metric_t> metrics;
+    const perf_counters::Counters counters;
+    if (!counters.any())
+    {
+        std::clog << "The hardware counters can't be read here, only the times are reported" << std::endl;
+    }
+
+    for (uint8_t l = 0; l < LAYOUT_KINDS; l++)
+    {
+        if (cmdargs.count("layout") && cmdargs["layout"] != LAYOUT_NAMES[l]) continue;
+
+        // Fixed seed, so every run times the same layouts
+        std::mt19937 rng(13 + l);
+
+        // The inputs of every step, precomputed from the
+        // layouts so each step is timed on its own
+        std::vector<pos_api::data_t> data;
+        std::vector<ang_calc::line_t> bLines;
+        std::vector<ang_calc::line_t> yLines;
+        std::vector<ang_calc::line_t> bEdges;
+        std::vector<ang_calc::line_t> yEdges;
+        std::vector<ang_calc::point_t> intersects;
+        for (uint32_t i = 0; i < INPUT_COUNT; i++)
+        {
+            data.push_back(generate((Layout) l, rng));
+
+            ang_calc::line_t b = ang_calc::getLineFromCones(data[i].bClose, data[i].bFar);
+            ang_calc::line_t y = ang_calc::getLineFromCones(data[i].yClose, data[i].yFar);
+            bLines.push_back(b);
+            yLines.push_back(y);
+            ang_calc::determineEdges(&b, &y);
+            bEdges.push_back(b);
+            yEdges.push_back(y);
+            intersects.push_back(ang_calc::getIntersect(b, y));
+        }
+
+        const std::string PREFIX = std::string(LAYOUT_NAMES[l]) + "/";
+
+        results.push_back(bench::measure(PREFIX + "getLineFromCones", ops, [&](uint64_t i) {
+            const pos_api::data_t &d = data[i & MASK];
+            bench::consume(ang_calc::getLineFromCones(d.bClose, d.bFar).coefficient);
+        }));
+        results.push_back(bench::measure(PREFIX + "determineEdges", ops, [&](uint64_t i) {
+            ang_calc::line_t b = bLines[i & MASK];
+            ang_calc::line_t y = yLines[i & MASK];
+            ang_calc::determineEdges(&b, &y);
+            bench::consume(b.constant + y.constant);
+        }));
+        results.push_back(bench::measure(PREFIX + "getIntersect", ops, [&](uint64_t i) {
+            bench::consume(ang_calc::getIntersect(bEdges[i & MASK], yEdges[i & MASK]).x);
+        }));
+        results.push_back(bench::measure(PREFIX + "getAngle", ops, [&](uint64_t i) {
+            bench::consume(ang_calc::getAngle(origin, intersects[i & MASK]));
+        }));
+        results.push_back(bench::measure(PREFIX + "calculateSteering", ops, [&](uint64_t i) {
+            bench::consume(ang_calc::calculateSteering(data[i & MASK]));
+        }));
+        results.push_back(bench::measure(PREFIX + "calculateSteeringFast", ops, [&](uint64_t i) {
+            bench::consume(ang_calc::calculateSteeringFast(data[i & MASK]));
+        }));
+        addCounts(PREFIX + "calculateSteering/", ang_calc::calculateSteering, data, counters, metrics);
+        addCounts(PREFIX + "calculateSteeringFast/", ang_calc::calculateSteeringFast, data, counters, metrics);
+    }
+
+    for (const bench::result_t &r : results)
+    {
+        bench::print(r, std::cout);
+    }
+    for (const bench::metric_t &m : metrics)
+    {
+        std::cout << m.name << ": " << m.value << std::endl;
+    }
+
+    if (cmdargs.count("json"))
+    {
+        std::ofstream json(cmdargs["json"]);
+        bench::printJson(results, metrics, json);
+    }
+    return 0;
+}
+
+pos_api::data_t generate(Layout layout, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<uint16_t> layoutDist(0, MIXED - 1);
+    std::uniform_int_distribution<uint16_t> sideDist(60, 260);
+    std::uniform_int_distribution<uint16_t> leanDist(10, 80);
+    std::uniform_int_distribution<uint16_t> closeYDist(0, 40);
+    std::uniform_int_distribution<uint16_t> farYDist(50, FRAME_HEIGHT - 1);
+    std::uniform_int_distribution<uint16_t> missingDist(0, 2);
+
+    if (layout == MIXED)
+    {
+        layout = (Layout) layoutDist(rng);
+    }
+
+    // The close cones are lower in the frame, and the far
+    // cones lean towards the middle of it
+    uint16_t bCloseX = sideDist(rng);
+    uint16_t yCloseX = (uint16_t) (FRAME_WIDTH - sideDist(rng));
+    uint16_t bCloseY = closeYDist(rng);
+    uint16_t yCloseY = closeYDist(rng);
+    uint16_t bFarX = (uint16_t) (bCloseX + leanDist(rng));
+    uint16_t yFarX = (uint16_t) (yCloseX - leanDist(rng));
+    uint16_t bFarY = farYDist(rng);
+    uint16_t yFarY = farYDist(rng);
+
+    if (layout == VERTICAL)
+    {
+        bFarX = bCloseX;
+        yFarX = yCloseX;
+    }
+    else if (layout == PARALLEL)
+    {
+        // Shift the yellow edge sideways from the blue one
+        yCloseY = bCloseY;
+        yFarY = bFarY;
+        yFarX = (uint16_t) (yCloseX + (bFarX - bCloseX));
+    }
+
+    pos_api::cone_t bClose{bCloseX, bCloseY};
+    pos_api::cone_t bFar{bFarX, bFarY};
+    pos_api::cone_t yClose{yCloseX, yCloseY};
+    pos_api::cone_t yFar{yFarX, yFarY};
+
+    if (layout == MISSING)
+    {
+        // Drop the blue side, the yellow side or both
+        uint16_t missing = missingDist(rng);
+        if (missing != 1)
+        {
+            return {pos_api::NO_CONE_POS, pos_api::NO_CONE_POS, missing == 0 ? yClose : pos_api::NO_CONE_POS,
+                    missing == 0 ? yFar : pos_api::NO_CONE_POS, {0}, {0}, 0.0f};
+        }
+        return {bClose, bFar, pos_api::NO_CONE_POS, pos_api::NO_CONE_POS, {0}, {0}, 0.0f};
+    }
+    return {bClose, bFar, yClose, yFar, {0}, {0}, 0.0f};
+}
+
+void addCounts(const std::string &name, _Float32 (*steer)(const pos_api::data_t), const std::vector<pos_api::data_t> &data,
+               const perf_counters::Counters &counters, std::vector<bench::metric_t> &metrics)
+{
+    if (!counters.any()) return;
+
+    // Warm up the caches and the branch predictor first,
+    // as the timed benchmarks do
+    for (const pos_api::data_t &d : data)
+    {
+        bench::consume(steer(d));
+    }
+
+    perf_counters::counts_t counts{};
+    perf_counters::counts_t start = counters.read();
+    for (const pos_api::data_t &d : data)
+    {
+        bench::consume(steer(d));
+    }
+    perf_counters::accumulate(counts, start, counters.read());
+
+    for (uint8_t c = 0; c < perf_counters::COUNTER_COUNT; c++)
+    {
+        if (counters.available((perf_counters::Counter) c))
+        {
+            metrics.push_back({name + perf_counters::COUNTER_NAMES[c], (double) counts.values[c] / (double) data.size()});
+        }
+    }
+}
+
+std::vector<bool> windowBits(const ang_vld::stats_t &stats)
+{
+    std::vector<bool> bits;
+    if (stats.windowSize == 0) return bits;
+
+    uint16_t start = (uint16_t) ((stats.windowHead + stats.windowSize - stats.windowFrames) % stats.windowSize);
+    for (uint16_t i = 0; i < stats.windowFrames; i++)
+    {
+        uint16_t pos = (uint16_t) ((start + i) % stats.windowSize);
+        bits.push_back((stats.window[pos / 64] >> (pos % 64)) & 1);
+    }
+    return bits;
+}
+
+double relativeDifference(double a, double b)
+{
+    double scale = fmax(fabs(a), fabs(b));
+    return scale == 0.0 ? 0.0 : fabs(a - b) / scale;
+}
+
+bool checkMerge()
+{
+    // Fixed seed, so every run checks the same stream
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> actualDist(-0.3f, 0.3f);
+    std::normal_distribution<float> errorDist(0.0f, 0.05f);
+    std::uniform_real_distribution<float> outlierDist(-1.0f, 1.0f);
+    std::uniform_int_distribution<uint16_t> kindDist(0, 9);
+
+    // Ground steering requests with a fifth of them zero, and
+    // steering values around them with a few beyond MAX_ERROR
+    std::vector<_Float32> actual;
+    std::vector<_Float32> ours;
+    for (uint32_t i = 0; i < CHECK_FRAMES; i++)
+    {
+        uint16_t kind = kindDist(rng);
+        _Float32 a = kind < 2 ? 0.0f : actualDist(rng);
+        actual.push_back(a);
+        ours.push_back(kind == 9 ? outlierDist(rng) : a + errorDist(rng));
+    }
+
+    const uint16_t WINDOWS[] = {0, 1, 300, MAX_WINDOW_SIZE};
+    const uint32_t SPLITS[] = {0, 1, 150, 299, 300, 301, CHECK_FRAMES / 2, CHECK_FRAMES - 300, CHECK_FRAMES - 1, CHECK_FRAMES};
+    const _Float32 PERCENTILES[] = {50.0f, 90.0f, 99.0f, 100.0f};
+
+    bool passed = true;
+    double maxDifference = 0.0;
+    uint32_t merges = 0;
+    for (uint16_t windowSize : WINDOWS)
+    {
+        ang_vld::stats_t whole;
+        ang_vld::reset(whole, windowSize);
+        for (uint32_t i = 0; i < CHECK_FRAMES; i++)
+        {
+            ang_vld::add(whole, actual[i], ours[i]);
+        }
+
+        for (uint32_t split : SPLITS)
+        {
+            ang_vld::stats_t first;
+            ang_vld::stats_t second;
+            ang_vld::reset(first, windowSize);
+            ang_vld::reset(second, windowSize);
+            for (uint32_t i = 0; i < CHECK_FRAMES; i++)
+            {
+                ang_vld::add(i < split ? first : second, actual[i], ours[i]);
+            }
+            ang_vld::merge(first, second);
+            merges++;
+
+            bool same = first.registeredFrames == whole.registeredFrames &&
+                        first.passedFrames == whole.passedFrames &&
+                        first.zeroesRegistered == whole.zeroesRegistered &&
+                        first.zeroesPassed == whole.zeroesPassed &&
+                        first.positivePassed == whole.positivePassed &&
+                        first.positiveUnder == whole.positiveUnder &&
+                        first.positiveAbove == whole.positiveAbove &&
+                        first.negativePassed == whole.negativePassed &&
+                        first.negativeUnder == whole.negativeUnder &&
+                        first.negativeAbove == whole.negativeAbove &&
+                        first.errorMin == whole.errorMin &&
+                        first.errorMax == whole.errorMax &&
+                        memcmp(first.errorBuckets, whole.errorBuckets, sizeof whole.errorBuckets) == 0 &&
+                        first.windowFrames == whole.windowFrames &&
+                        first.windowPassed == whole.windowPassed &&
+                        windowBits(first) == windowBits(whole);
+            for (_Float32 p : PERCENTILES)
+            {
+                same = same && ang_vld::errorPercentile(first, p) == ang_vld::errorPercentile(whole, p);
+            }
+
+            double difference = fmax(relativeDifference(first.errorMean, whole.errorMean),
+                                     relativeDifference(first.errorM2, whole.errorM2));
+            maxDifference = fmax(maxDifference, difference);
+            if (!same || difference > CHECK_TOLERANCE)
+            {
+                std::cout << "Merge of " << split << " and " << CHECK_FRAMES - split << " frames with a window of "
+                          << windowSize << " frames differs from the whole run" << std::endl;
+                passed = false;
+            }
+        }
+    }
+
+    std::cout << "Merges checked: " << merges << std::endl;
+    std::cout << "Largest relative mean/M2 difference: " << maxDifference << " (bound " << CHECK_TOLERANCE << ")" << std::endl;
+    return passed;
+}
@@ -18,174 +18,77 @@
 // Include the header with structs to test the shared memory on
 #include "../api/position.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// For taking the exit signals on a thread of their own
+#include <csignal>
+#include <pthread.h>
 
 // Include the standard int types of C
 #include <cstdint>
 
-// Declares a set of function to compute common mathematical operations. 
-#include <math.h>
-
-// The testing functions used for the angle calculator
-#include "angle-validator.hpp"
-
-// The maximum absolute steering value
-#define MAX_ABS_STEERING_VAL 0.290888f
-
-// Output value of no steering angle
-#define NO_ANGLE 0.0f
-
-/**
- * Struct representing a linear mathematical functions.
- * (y = coefficient * x + constant)
- * 
- * @param coefficient the slope of the linear function.
- * float max if the slope inclination is infinite
- * @param constant the constant of the linear function.
- * x value if the slope inclination is infinite
- */
-struct line_t {
-    _Float32 coefficient;
-    _Float32 constant;
-};
-
-/**
- * Struct representing a point in a graph with x and y
- * coordinates
- * 
- * @param x the x coordinate of the point
- * @param y the y coordinate of the point
- */
-struct point_t {
-    _Float32 x;
-    _Float32 y;
-};
-
-// The width of the frame being processed
-uint16_t width;
-
-// The height of the frame being processed
-uint16_t height;
-
-// The threshold to pass for calculateSteering to output something non-zero
-_Float32 zeroThreshold;
-// The threshold to pass for calculateSteering to output MAX_ABS_STEERING_ANGLE
-_Float32 maxThreshold;
-
-// The fraction that the origin's y coordinate
-// should be offset by
-_Float32 originYOffset;
+// The steering calculation itself
+#include "steering.hpp"
 
-// The fraction that each default lines' top point should be placed
-// from the sides of the frame. This MUST be a whole number!!
-_Float32 defaultLineOffset;
+// The per-stage latency tracing
+#include "../api/trace.hpp"
 
-// Degrees to shift when calculating the output,
-// with positive going counterclockwise
-_Float32 angleBias;
+// The real-time mode
+#include "../api/realtime.hpp"
 
-// The origin of the car heading
-point_t origin;
+// The hardware counters of the CPU
+#include "../api/perf-counters.hpp"
 
-// The default edge for the right side
-// when no line can be drawn
-line_t rightDefault;
-// The default edge for the left side
-// when no line can be drawn
-line_t leftDefault;
+// The statistics published for pipeline-top
+#include "../api/telemetry.hpp"
 
-// The coefficient for a slope with infinite inclination
-const _Float32 INF_SLOPE = 0.0f;
-
-// The slope for NO_CONE_POS
-const line_t NO_CONE_LINE = {pos_api::NO_CONE_POS.posX, pos_api::NO_CONE_POS.posY};
+// The testing functions used for the angle calculator
+#include "angle-validator.hpp"
 
 // Boolean representing whether we're in test mode or not
 bool test;
 // Boolean representing whether we're in verbose test mode or not
 bool verbose;
+// Boolean representing whether stage latencies are traced or not
+bool tracing;
+// Boolean representing whether the fast float path is used or not
+bool fast;
+// Boolean representing whether we're running in real-time mode or not
+bool realtimeMode;
+// The hardware counters of the calculation, if it's sampled
+perf_counters::Counters *hwCounters = nullptr;
+// The counts and the number of the sampled calculations
+perf_counters::counts_t steerCounts{};
+uint64_t countedCalls = 0;
+// The publisher of the statistics, if the segment could be created
+telemetry::Publisher *publisher = nullptr;
+// Whether the loop is to stop, upon an exit signal
+std::atomic<bool> stopping{false};
+// Guards looping
+std::mutex loopMutex;
+// Whether the loop runs, and has to be woken to stop
+bool looping = false;
 
 /**
- * Exit handler that cleans up after the process
- * if possible
- * 
- * @param sig the exit signal
- */
-void handleExit(int sig);
-
-/**
- * Applies the two-point-equation on two cone
- * positions and calculates a mathematical
- * linear function
- * 
- * @param close the closest cone of one side
- * @param far the second closest cone on the
- * same side
- * @returns the coefficient and constant for
- * a linear mathematical function unless it
- * has an infinite slope inclination, in which
- * case it returns float max and the x value
- * of the line
- */
-line_t getLineFromCones(const pos_api::cone_t close, const pos_api::cone_t far);
-
-/**
- * Calculates the intersection between 2 lines,
- * if there is one. Otherwise returns the origin
- * in terms of the car heading.
- * 
- * @param f one of the functions to check the
- * intersect of
- * @param g the other function to check the
- * intersect of
- * @returns the point of intersect if there is one,
- * otherwise the origin in terms of the car heading
- */
-point_t getIntersect(const line_t f, const line_t g);
-
-/**
- * Gets the angle between a vertical line and the line
- * between two points.
- * The output value ranges from -180 deg to +180 deg
- * with negative values going clockwise
- * 
- * @param origin the starting point of the line
- * @param p the endpoint of the line
- * @return an angle between -180 and +180
- */
-_Float32 getAngle(const point_t origin, const point_t p);
-
-/**
- * Checks if two lines are equal.
- * Lines are equal if both of their coefficients and
- * constants are equal
- * 
- * @param f a line
- * @param g another line
- * @return a bool representing if the lines are equal
- * or not
+ * Reports and cleans up after the process if possible,
+ * once the loop has stopped or if it couldn't be started
  */
-bool isEqual(const line_t f, const line_t g);
+void handleExit();
 
 /**
- * Fills in edges if they don't exist by checking the
- * existing edge. If no edge exists, it assumes the default
- * lines
+ * Waits on a thread of its own for an exit signal,
+ * which every other thread blocks, and stops the loop
+ * upon it, so the exit handler runs as normal code
  * 
- * @param f a pointer to a line
- * @param g a pointer to another line
+ * @param signals the exit signals
  */
-void determineEdges(line_t *const f, line_t *const g);
-
-/**
- * Calculates the steering angle value based on the
- * data passed
- * 
- * @param data the cone data to perform calculations on
- * @return a steering angle value between -MAX_ABS_STEERING_VAL
- * and MAX_ABS_STEERING_VAL
- */
-_Float32 calculateSteering(pos_api::data_t data);
+void waitForExit(sigset_t signals);
 
 // Main entry point
 int32_t main(int32_t argc, char **argv)
@@ -203,7 +106,7 @@ int32_t main(int32_t argc, char **argv)
         std::cerr << "Usage:   " << argv[0] << " --width=<width of frame> --height=<height of frame>"
                   << "--z=<threshold for non-zero values> --m=<threshold for max value>"
                   << "--y=<origin y value offset> --l=<endpoint offset for default lines>"
-                  << "--b=<angle calculation offset> [--test] [--verbose]" << std::endl;
+                  << "--b=<angle calculation offset> [--test] [--verbose] [--report-frames=<frames>] [--report-ms=<milliseconds>] [--window=<frames>] [--fast] [--trace] [--realtime [--core=<core>] [--priority=<priority>]] [--counters=<calls>] [--channel=<name>]" << std::endl;
         std::cerr << "         --width:  width of the frame (int)" << std::endl;
         std::cerr << "         --height: height of the frame (int)" << std::endl;
         std::cerr << "         --z: angle threshold for the algorithm to output non-zero values (float)" << std::endl;
@@ -212,7 +115,17 @@ int32_t main(int32_t argc, char **argv)
         std::cerr << "         --l: number of partitions to create from the frame to offset the default lines' ending point to (int)" << std::endl;
         std::cerr << "         --b: angle to offset the angle calculation by (float)" << std::endl;
         std::cerr << "         --test: whether or not to perform an accuracy test and print the results unot exiting the programme" << std::endl;
-        std::cerr << "         --verbose: whether or not to perform an accuracy test and for each frame" << std::endl;
+        std::cerr << "         --verbose: whether or not to perform an accuracy test and report on it to stderr while running" << std::endl;
+        std::cerr << "         --report-frames: number of frames between accuracy reports in verbose mode (int, default 30, 0 disables)" << std::endl;
+        std::cerr << "         --report-ms: number of milliseconds between accuracy reports in verbose mode (int, default 1000, 0 disables)" << std::endl;
+        std::cerr << "         --window: number of most recent frames to calculate the sliding window accuracy over (int, default 300)" << std::endl;
+        std::cerr << "         --fast: whether or not to use the polynomial atan" << std::endl;
+        std::cerr << "         --trace: whether or not to print the latency of each pipeline stage upon exiting the programme" << std::endl;
+        std::cerr << "         --realtime: whether or not to run with SCHED_FIFO and locked memory, and print the page faults upon exiting the programme" << std::endl;
+        std::cerr << "         --core: core to pin the calculation to in real-time mode (int, default any)" << std::endl;
+        std::cerr << "         --priority: SCHED_FIFO priority in real-time mode (int, 1 to 99, default 50)" << std::endl;
+        std::cerr << "         --counters: count one in this many calculations with the CPU's counters and print the counts upon exiting the programme (int)" << std::endl;
+        std::cerr << "         --channel: name of the shared memory to read the cones from, of another camera of the cone detector (default position)" << std::endl;
         std::cerr << "Example: " << argv[0] << " --width=640 --height=480 --z=10 --m=70 --y=0.2 --l=3 --b=0" << std::endl;
         return 1;
     }
@@ -227,46 +140,51 @@ int32_t main(int32_t argc, char **argv)
             std::cerr << "Width or height out of bounds" << std::endl;
             return 1;
         }
-        width = tmpWidth;
-        height = tmpHeight;
-        zeroThreshold = std::stof(cmdargs["z"]);
-        maxThreshold = std::stof(cmdargs["m"]);
-        originYOffset = std::stof(cmdargs["y"]);
-        defaultLineOffset = std::stof(cmdargs["l"]);
-        angleBias = std::stof(cmdargs["b"]);
+        ang_calc::configure(
+            tmpWidth,
+            tmpHeight,
+            std::stof(cmdargs["z"]),  // zeroThreshold
+            std::stof(cmdargs["m"]),  // maxThreshold
+            std::stof(cmdargs["y"]),  // originYOffset
+            std::stof(cmdargs["l"]),  // defaultLineOffset
+            std::stof(cmdargs["b"])   // angleBias
+        );
     }
 
     test = cmdargs.count("test");
     verbose = cmdargs.count("verbose");
-    origin = {(_Float32) width / 2.0f, height * originYOffset};
-
-    // Get the default right edge between the top center
-    // and bottom right corner
-    rightDefault = getLineFromCones(
-        {(uint16_t) (width - 1), 0},
-        {(uint16_t) ((width / defaultLineOffset) * (defaultLineOffset - 1.0f)), height}
-    );
-
-    // Get the default right edge between the top center
-    // and bottom left corner
-    leftDefault = getLineFromCones(
-        {1, 0},
-        {(uint16_t) (width / defaultLineOffset), height}
-    );
-
-
-    // Attach an exit handler to the ^C event
-    signal(SIGINT, handleExit);
-    // Attach the exit handler to the process termination event
-    signal(SIGTERM, handleExit);
-    // Attach the exit handler to the ^/ event
-    signal(SIGQUIT, handleExit);
-    // Attach the exit handler to the hangup signal (kill terminal)
-    signal(SIGHUP, handleExit);
+    tracing = cmdargs.count("trace");
+    fast = cmdargs.count("fast");
+    realtimeMode = cmdargs.count("realtime");
+
+    if (cmdargs.count("window"))
+    {
+        int32_t tmpWindow = stoi(cmdargs["window"]);
+        if (tmpWindow < 1 || tmpWindow > MAX_WINDOW_SIZE)
+        {
+            std::cerr << "Window size out of bounds" << std::endl;
+            return 1;
+        }
+        ang_vld::setWindowSize(tmpWindow);
+    }
 
+    // The ^C, process termination, ^/ and hangup (kill terminal)
+    // signals are blocked before any other thread is started,
+    // which inherit it, and taken by a thread of their own
+    sigset_t exitSignals;
+    sigemptyset(&exitSignals);
+    for (int sig : {SIGINT, SIGTERM, SIGQUIT, SIGHUP})
+    {
+        sigaddset(&exitSignals, sig);
+    }
+    pthread_sigmask(SIG_BLOCK, &exitSignals, nullptr);
+    std::thread(waitForExit, exitSignals).detach();
+
+    // Every camera of the cone detector has a channel of its own
+    const std::string CHANNEL = cmdargs.count("channel") ? cmdargs["channel"] : pos_api::DEFAULT_CHANNEL;
     try
     {
-        pos_api::attach();
+        pos_api::attach(CHANNEL);
     }
     catch (const pos_api::APIException& e)
     {
@@ -282,7 +200,7 @@ int32_t main(int32_t argc, char **argv)
                 std::cerr << "Oops! Something went wrong" << std::endl;
         }
 
-        handleExit(SIGTERM);
+        handleExit();
         return 1;
     }
 
@@ -290,6 +208,13 @@ int32_t main(int32_t argc, char **argv)
     if (verbose)
     {
         std::cout << "Running in verbose test mode" << std::endl;
+
+        // Print the accuracy reports to std::clog from a separate
+        // thread, so printing doesn't hold up the frame loop
+        ang_vld::startReporter(
+            cmdargs.count("report-frames") ? stoi(cmdargs["report-frames"]) : 30,
+            cmdargs.count("report-ms") ? stoi(cmdargs["report-ms"]) : 1000
+        );
     }
     else if (test)
     {
@@ -300,22 +225,120 @@ int32_t main(int32_t argc, char **argv)
         std::cout << "Running in normal mode" << std::endl;
     }
 
+    // Publish the statistics of every calculation for pipeline-top,
+    // the calculation runs the same without them
+    std::unique_ptr<telemetry::Publisher> telemetryPublisher;
+    try
+    {
+        // The calculators of other cameras' channels are told apart by the channel
+        telemetryPublisher.reset(new telemetry::Publisher(
+            CHANNEL == pos_api::DEFAULT_CHANNEL ? "angle-calculator" : "angle-calculator." + CHANNEL, "angle-calculator"));
+        publisher = telemetryPublisher.get();
+    }
+    catch (const telemetry::TelemetryException &)
+    {
+        std::cerr << "Could not create the telemetry segment, no statistics are published" << std::endl;
+    }
+
+    // Enter the real-time mode last, so the reporter thread
+    // keeps the default core and scheduling
+    if (realtimeMode)
+    {
+        realtime::config_t config{
+            cmdargs.count("core") ? stoi(cmdargs["core"]) : -1,
+            cmdargs.count("priority") ? stoi(cmdargs["priority"]) : realtime::DEFAULT_PRIORITY
+        };
+        try
+        {
+            realtime::enter(config);
+        }
+        catch (const realtime::RealtimeException& e)
+        {
+            switch (e)
+            {
+                case realtime::RealtimeException::CORE:
+                    std::cerr << "Could not pin the calculation to core " << config.core << std::endl;
+                    break;
+                case realtime::RealtimeException::SCHEDULER:
+                    std::cerr << "Could not schedule the calculation with SCHED_FIFO priority " << config.priority << std::endl;
+                    break;
+                default:
+                    std::cerr << "Could not lock the memory" << std::endl;
+            }
+
+            realtimeMode = false;
+            handleExit();
+            return 1;
+        }
+        std::cout << "Running in real-time mode" << std::endl;
+    }
+
+    // One in every counterInterval calculations is counted with
+    // the hardware counters, opened on this thread
+    uint64_t counterInterval = cmdargs.count("counters") ? std::max(stoull(cmdargs["counters"]), 1ull) : 0;
+    std::unique_ptr<perf_counters::Counters> counters;
+    if (counterInterval > 0)
+    {
+        counters.reset(new perf_counters::Counters());
+        if (!counters->any())
+        {
+            std::cerr << "The hardware counters can't be read here, no calculations are counted" << std::endl;
+            counters.reset();
+        }
+    }
+    hwCounters = counters.get();
+    uint64_t calls = 0;
+
     // Used to check the timestamp of the last iteration.
     // The wait function of SharedMemory seems to be inconsistent
     int64_t lastTs = INT64_MIN;
+    // The loop is woken when it's stopped while it waits
+    {
+        std::lock_guard<std::mutex> lock(loopMutex);
+        looping = true;
+    }
+
     // Endless loop, exit with ^C
-    while (true)
+    while (!stopping)
     {
         pos_api::data_t d = pos_api::get();
 
+        // The loop may only have been woken to stop
+        if (stopping) break;
+
+        // The time the data arrived in this process
+        int64_t received = trace::now();
+
         // Skip if the timestamp is a duplicate
         if (d.vidTimestamp.micros == lastTs) continue;
 
         lastTs = d.vidTimestamp.micros;
 
-        _Float32 outputVal = calculateSteering(d);
+        bool counted = counters && calls++ % counterInterval == 0;
+        perf_counters::counts_t start = counted ? counters->read() : perf_counters::counts_t{};
+        _Float32 outputVal = fast ? ang_calc::calculateSteeringFast(d) : ang_calc::calculateSteering(d);
+        if (counted)
+        {
+            perf_counters::accumulate(steerCounts, start, counters->read());
+            countedCalls++;
+        }
         _Float32 gsrVal = d.gsr;
 
+        int64_t steered = (tracing || publisher) ? trace::now() : 0;
+        if (tracing)
+        {
+            // The cone detector sets now right before it
+            // puts the data, so this is the cost of the IPC hop
+            trace::record(trace::HANDOFF, received - d.now.micros);
+            trace::record(trace::STEER, steered - received);
+        }
+        if (publisher)
+        {
+            publisher->record(trace::HANDOFF, received - d.now.micros);
+            publisher->record(trace::STEER, steered - received);
+            publisher->frame(d.vidTimestamp.micros, received, steered);
+        }
+
         if (test || verbose)
         {
             ang_vld::registerSteering(gsrVal, outputVal);
@@ -325,211 +348,76 @@ int32_t main(int32_t argc, char **argv)
 
         if (verbose)
         {
-            ang_vld::printResult();
+            ang_vld::reportIfDue();
         }
-    }
 
-    return 0;
-}
-
-void handleExit(int sig)
-{
-    std::cout << std::endl;
-    if (test && !verbose)
-    {
-        ang_vld::printResult();
+        // The first calculation is done, the page faults
+        // are counted from here on
+        if (realtimeMode)
+        {
+            realtime::markSteady();
+        }
     }
-    std::cout << "Cleaning up..." << std::endl;
-    pos_api::clear();
-    std::cout << "Exiting programme..." << std::endl;
-}
 
-line_t getLineFromCones(const pos_api::cone_t close, const pos_api::cone_t far)
-{
-    // Check if there is a cone at all
-    if (pos_api::isEqual(close, pos_api::NO_CONE_POS))
     {
-        return NO_CONE_LINE;
+        std::lock_guard<std::mutex> lock(loopMutex);
+        looping = false;
     }
-    // Catch division by 0 (infinite slope)
-    if (far.posX == close.posX)
-    {
-        // Includes the x value in place of line_t.constant
-        return {INF_SLOPE, (_Float32) close.posX};
-    }
-
-    // dy/dx
-    _Float32 coeff = (_Float32) (far.posY - close.posY) / (_Float32) (far.posX - close.posX);
-    // y1 - ax1
-    _Float32 constant = far.posY - (coeff * far.posX);
-
-    return {coeff, constant};
+    handleExit();
+    return 0;
 }
 
-point_t getIntersect(const line_t f, const line_t g)
+void handleExit()
 {
-    // x coordinate of the intersect
-    _Float32 x;
-    // y coordinate of the intersect
-    _Float32 y;
-
-    // Return the point at the top of the frame
-    // right in between the lines if they are vertical
-    if (f.coefficient == INF_SLOPE && g.coefficient == INF_SLOPE)
-    {
-        return {f.constant - g.constant, 0.0f};
-    }
-    // If one of the lines is vertical,
-    // take that into consideration
-    else if (f.coefficient == INF_SLOPE)
+    std::cout << std::endl;
+    if (verbose)
     {
-        // f.constant is the x value where the line is at
-        x = f.constant;
-        y = g.coefficient * x;
+        ang_vld::stopReporter();
     }
-    else if (g.coefficient == INF_SLOPE)
+    if (test || verbose)
     {
-        // g.constant is the x value where the line is at
-        x = g.constant;
-        y = f.coefficient * x;
+        ang_vld::printResult();
     }
-    // Otherwise, treat them as regular functions
-    else
+    if (tracing)
     {
-        // f(x) = g(x)
-        // mf * x + bf = mg * x + bg
-        // x * (mf - mg) = bg - bf
-        // x = (bg - bf) / (mf - mg)
-        x = (g.constant - f.constant) / (f.coefficient - g.coefficient);
-
-        y = f.coefficient * x + f.constant;
+        trace::printStages(std::cout);
     }
-
-    return {x, y};
-}
-
-_Float32 getAngle(const point_t origin, const point_t p) {
-    // The angle in degrees from the line between the line
-    // between origin and p, and the x-axis
-    // Positive values -> counterclockwise rotation
-    _Float32 angle = atan((origin.y - p.y) / (origin.x - p.x)) * (180 / M_PI);
-
-    // Convert negative angles to their corresponding positive
-    // angle and shift by 90 degrees, so the positive y-axis
-    // becomes the line of refernece
-    angle = fmod(angle + 180.0f, 180.0f) - 90.0f;
-
-    // Return the angle with a bias, if there is one
-    return angle + angleBias;
-}
-
-bool isEqual(const line_t f, const line_t g)
-{
-    return f.coefficient == g.coefficient && f.constant == g.constant;
-}
-
-void determineEdges(line_t *const f, line_t *const g)
-{
-    // The value of function f
-    line_t _f = *f;
-    // The value of function g
-    line_t _g = *g;
-
-    // Represents if f has cones or not
-    bool fNoCone = isEqual(_f, NO_CONE_LINE);
-    // Represents if g has cones or not
-    bool gNoCone = isEqual(_g, NO_CONE_LINE);
-
-    // If there are no cones, assume both lines
-    if (fNoCone && gNoCone)
+    if (realtimeMode)
     {
-        *f = leftDefault;
-        *g = rightDefault;
+        // The loop ran on this thread, whose faults are the ones counted
+        realtime::printFaults(realtime::faults(), std::cout);
     }
-    // If f has no cones...
-    else if (fNoCone && !gNoCone)
+    if (hwCounters != nullptr)
     {
-        // Check if g is on the right or left side
-        // and then assume f
-        if (_g.coefficient < 0 ||
-            _g.coefficient == INF_SLOPE && _g.constant > origin.x)
-        {
-            *f = leftDefault;
-        }
-        else
-        {
-            *f = rightDefault;
-        }
+        std::cout << "Hardware counts per counted calculation, of " << countedCalls << " calculations:" << std::endl;
+        hwCounters->print(fast ? "calculateSteeringFast" : "calculateSteering", steerCounts, countedCalls, std::cout);
     }
-    // If g has no cones...
-    else if (gNoCone && !fNoCone)
+    std::cout << "Cleaning up..." << std::endl;
+    if (publisher)
     {
-        // Check if f is on the right or left side
-        // and then assume g
-        if (_f.coefficient < 0 ||
-            _f.coefficient == INF_SLOPE && _f.constant > origin.x)
-        {
-            *g = leftDefault;
-        }
-        else
-        {
-            *g = rightDefault;
-        }
+        publisher->remove();
     }
+    pos_api::clear();
+    std::cout << "Exiting programme..." << std::endl;
 }
 
-_Float32 calculateSteering(const pos_api::data_t data)
+void waitForExit(sigset_t signals)
 {
-    // Start by getting the lines from the cones,
-    // if there are any
-
-    // The line between the blue cones
-    line_t bLine = getLineFromCones(data.bClose, data.bFar);
-    // The line between the yellow cones
-    line_t yLine = getLineFromCones(data.yClose, data.yFar);
-
-    // Determine which side the cones are on
-    // and assume edges for non-existent edges
-    determineEdges(&bLine, &yLine);
-
-    // The intersect between the two lines, if there is one
-    point_t intersect = getIntersect(bLine, yLine);
-
-    // The angle between a horizontal line and
-    // the line between origin and intersect
-    _Float32 angle = getAngle(origin, intersect);
-
-    // A check for whether the angle is on the right side
-    bool right = angle < 0;
-    // The magnitude of the angle
-    _Float32 magnitude = abs(angle);
-
-    // If the angle is within the range that it's acceptable
-    // to not turn, don't
-    if (0.0f <= magnitude && magnitude <= zeroThreshold)
-    {
-        return 0.0f;
-    }
-    // If it's between no steering and maximum turn,
-    // output a value between 0 and the maximum value
-    else if (zeroThreshold < magnitude && magnitude <= maxThreshold)
+    int sig = 0;
+    sigwait(&signals, &sig);
+    stopping = true;
+
+    // The loop waiting for data is woken until it has stopped,
+    // the notification may come before it waits so it's
+    // repeated. Other consumers of the channel skip the data
+    // they read again, as its timestamp is a duplicate
+    while (true)
     {
-        // The value to output
-        _Float32 val;
-        // Get the percentage between no steering and max turn
-        val = (magnitude - zeroThreshold) / (maxThreshold - zeroThreshold);
-        // Multiply the percentage with the maximum value
-        val *= MAX_ABS_STEERING_VAL;
-
-        // Right turns have a negative angle
-        if (right)
         {
-            val = -val;
+            std::lock_guard<std::mutex> lock(loopMutex);
+            if (!looping) return;
+            pos_api::wake();
         }
-        return val;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
-
-    // If it's above the max turn threshold, turn
-    // Multiply by -1 if we're turning to the right
-    return MAX_ABS_STEERING_VAL * (right ? -1 : 1);
 }
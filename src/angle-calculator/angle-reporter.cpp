@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "angle-validator.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+// The longest the reporter sleeps before checking if it should stop
+#define STOP_POLL_MS 100
+
+// The number of registered frames between reports
+uint32_t reportFrames = 0;
+// The time between reports
+std::chrono::milliseconds reportInterval{0};
+
+// The number of frames registered since the last snapshot
+uint32_t framesSinceReport = 0;
+// The time of the last snapshot
+std::chrono::steady_clock::time_point lastReportTime;
+
+// Guards snapshot and snapshotReady
+std::mutex snapshotMutex;
+// Wakes the reporter when a snapshot is ready
+std::condition_variable snapshotReadyCond;
+// The latest snapshot handed over by the frame loop
+ang_vld::stats_t snapshot;
+// Whether snapshot holds a report that hasn't been printed
+bool snapshotReady = false;
+
+// Whether the reporter is running
+std::atomic<bool> reporting{false};
+// The thread printing the snapshots
+std::thread reporter;
+
+/**
+ * The loop of the reporter thread. Waits for snapshots and
+ * prints them until the reporter is stopped.
+ */
+void runReporter();
+
+void ang_vld::startReporter(uint32_t frames, uint32_t millis)
+{
+    if (reporting) return;
+
+    reportFrames = frames;
+    reportInterval = std::chrono::milliseconds(millis);
+    lastReportTime = std::chrono::steady_clock::now();
+    reporting = true;
+    reporter = std::thread(runReporter);
+}
+
+void ang_vld::reportIfDue()
+{
+    if (!reporting) return;
+
+    framesSinceReport++;
+    bool due = reportFrames != 0 && framesSinceReport >= reportFrames;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    due = due || (reportInterval.count() != 0 && now - lastReportTime >= reportInterval);
+
+    if (!due) return;
+
+    // Skip this frame rather than wait for the reporter
+    std::unique_lock<std::mutex> lock(snapshotMutex, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+
+    snapshot = ang_vld::getStats();
+    snapshotReady = true;
+    lock.unlock();
+    snapshotReadyCond.notify_one();
+
+    framesSinceReport = 0;
+    lastReportTime = now;
+}
+
+void ang_vld::stopReporter()
+{
+    // The reporter notices the stop by polling
+    if (!reporting.exchange(false)) return;
+    reporter.join();
+}
+
+void runReporter()
+{
+    std::unique_lock<std::mutex> lock(snapshotMutex);
+    while (reporting)
+    {
+        if (!snapshotReady)
+        {
+            snapshotReadyCond.wait_for(lock, std::chrono::milliseconds(STOP_POLL_MS));
+        }
+        if (!snapshotReady)
+        {
+            continue;
+        }
+
+        // Copy the snapshot so the frame loop can hand over
+        // the next one while this one is printed
+        ang_vld::stats_t report = snapshot;
+        snapshotReady = false;
+        lock.unlock();
+
+        // The report is written in one go to std::clog, so the
+        // frame loop never waits on it to write its lines to
+        // std::cout, however slowly either stream is read
+        std::ostringstream text;
+        ang_vld::print(report, text);
+        std::clog << text.str() << std::flush;
+        lock.lock();
+    }
+}
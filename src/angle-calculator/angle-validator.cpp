@@ -23,41 +23,35 @@ _Float32 marginOfError = 0.3f;
 // ground steering request was zero
 _Float32 zeroValTolerance = 0.05f;
 
-// The total amount of frames registered in the test
-int16_t registeredFrames = 0;
-// The subset of registered frames that have passed the test
-int16_t passedFrames = 0;
-
-// The subset of registered frames with had zero as the original
-// ground steering request
-int16_t zeroesRegistered = 0;
-// The subset of passed frames that were compared to a zero in
-// the original ground steering request
-int16_t zeroesPassed = 0;
-
-// The subset of passed frames that were compared to a positive
-// value in the original ground steering request
-int16_t positivePassed = 0;
-// The subset of registered frames that were compared to a positive
-// value in the original ground steering request but failed due to
-// having value that's too low
-int16_t positiveUnder = 0;
-// The subset of registered frames that were compared to a positive
-// value in the original ground steering request but failed due to
-// having value that's too high
-int16_t positiveAbove = 0;
-
-// The subset of passed frames that were compared to a negative
-// value in the original ground steering request
-int16_t negativePassed = 0;
-// The subset of registered frames that were compared to a positive
-// value in the original ground steering request but failed due to
-// having value that's too low
-int16_t negativeUnder = 0;
-// The subset of registered frames that were compared to a positive
-// value in the original ground steering request but failed due to
-// having value that's too high
-int16_t negativeAbove = 0;
+// The sliding window size used unless setWindowSize() is called
+#define DEFAULT_WINDOW_SIZE 300
+
+// The statistics of the test
+ang_vld::stats_t results;
+
+// Whether results has been reset before its first use
+bool resultsReady = false;
+
+/**
+ * Checks a frame against the acceptable range and registers
+ * which pass/fail bucket it belongs to
+ *
+ * @param stats the statistics to register the frame in
+ * @param actual the original ground steering request
+ * @param ours the output from the angle calculator
+ * @return whether the frame passed or not
+ */
+bool registerBucket(ang_vld::stats_t &stats, _Float32 actual, _Float32 ours);
+
+/**
+ * Writes the pass or fail bit of a frame into the
+ * sliding window, dropping the oldest frame if the
+ * window is full
+ *
+ * @param stats the statistics holding the window
+ * @param passed whether the frame passed or not
+ */
+void pushWindow(ang_vld::stats_t &stats, bool passed);
 
 void ang_vld::setMarginOfError(_Float32 margin)
 {
@@ -69,28 +63,25 @@ void ang_vld::setZeroValTolerance(_Float32 tolerance)
     zeroValTolerance = tolerance;
 }
 
-void ang_vld::registerSteering(_Float32 actual, _Float32 ours)
+bool registerBucket(ang_vld::stats_t &stats, _Float32 actual, _Float32 ours)
 {
-    // Register the frame
-    registeredFrames++;
-
     // The case for when the original ground steering request is zero
     if (actual == 0)
     {
         // Register the zero frame
-        zeroesRegistered++;
+        stats.zeroesRegistered++;
 
         // Do nothing if the output value is outside the accepted range
         if (!(actual - zeroValTolerance <= ours && ours <= actual + zeroValTolerance))
         {
-            return;
+            return false;
         }
 
         // Otherwise register that the frame passed and
         // that it's a zero frame that passed
-        passedFrames++;
-        zeroesPassed++;
-        return;
+        stats.passedFrames++;
+        stats.zeroesPassed++;
+        return true;
     }
 
     // The case for positive original ground steering requests
@@ -101,8 +92,8 @@ void ang_vld::registerSteering(_Float32 actual, _Float32 ours)
         // ground steering request
         if (ours < actual * (1.0f - marginOfError))
         {
-            positiveUnder++;
-            return;
+            stats.positiveUnder++;
+            return false;
         }
 
         // If the output value is above the acceptable range,
@@ -110,16 +101,16 @@ void ang_vld::registerSteering(_Float32 actual, _Float32 ours)
         // ground steering request
         if (actual * (1.0f + marginOfError) < ours)
         {
-            positiveAbove++;
-            return;
+            stats.positiveAbove++;
+            return false;
         }
 
         // Otherwise the value must be in the acceptable range,
         // so we register it as passed and that it's a positive
         // frame that passed
-        passedFrames++;
-        positiveAbove++;
-        return;
+        stats.passedFrames++;
+        stats.positivePassed++;
+        return true;
     }
 
     // The case for negative original ground steering requests
@@ -130,8 +121,8 @@ void ang_vld::registerSteering(_Float32 actual, _Float32 ours)
         // ground steering request
         if (ours < actual * (1.0f + marginOfError))
         {
-            negativeUnder++;
-            return;
+            stats.negativeUnder++;
+            return false;
         }
 
         // If the output value is above the acceptable range,
@@ -139,40 +130,238 @@ void ang_vld::registerSteering(_Float32 actual, _Float32 ours)
         // ground steering request
         if (actual * (1.0f - marginOfError) < ours)
         {
-            negativeAbove++;
-            return;
+            stats.negativeAbove++;
+            return false;
         }
 
         // Otherwise the value must be in the acceptable range,
         // so we register it as passed and that it's a negative
         // frame that passed
-        passedFrames++;
-        negativePassed++;
+        stats.passedFrames++;
+        stats.negativePassed++;
+        return true;
+    }
+
+    // Not a number, which can't be within any range
+    return false;
+}
+
+void ang_vld::registerSteering(_Float32 actual, _Float32 ours)
+{
+    if (!resultsReady)
+    {
+        ang_vld::reset(results, DEFAULT_WINDOW_SIZE);
+        resultsReady = true;
+    }
+    ang_vld::add(results, actual, ours);
+}
+
+void ang_vld::reset(ang_vld::stats_t &stats, uint16_t windowSize)
+{
+    stats = {};
+    stats.windowSize = windowSize < MAX_WINDOW_SIZE ? windowSize : MAX_WINDOW_SIZE;
+}
+
+void ang_vld::add(ang_vld::stats_t &stats, _Float32 actual, _Float32 ours)
+{
+    // Register the frame
+    stats.registeredFrames++;
+
+    // The error of the output value
+    double error = (double) ours - (double) actual;
+
+    // Update the mean and the sum of squared differences
+    // with Welford's algorithm, which doesn't lose precision
+    // the way a plain sum of squares does on long runs
+    double delta = error - stats.errorMean;
+    stats.errorMean += delta / (double) stats.registeredFrames;
+    stats.errorM2 += delta * (error - stats.errorMean);
+
+    if (stats.registeredFrames == 1 || error < stats.errorMin)
+    {
+        stats.errorMin = (_Float32) error;
+    }
+    if (stats.registeredFrames == 1 || error > stats.errorMax)
+    {
+        stats.errorMax = (_Float32) error;
+    }
+
+    // Put the absolute error in its bucket, with anything
+    // beyond MAX_ERROR in the last one
+    double bucket = fabs(error) * (ERROR_BUCKETS / MAX_ERROR);
+    stats.errorBuckets[bucket < ERROR_BUCKETS - 1 ? (uint32_t) bucket : ERROR_BUCKETS - 1]++;
+
+    pushWindow(stats, registerBucket(stats, actual, ours));
+}
+
+void ang_vld::merge(ang_vld::stats_t &dest, const ang_vld::stats_t &src)
+{
+    // Nothing to merge
+    if (src.registeredFrames == 0) return;
+
+    // Combine the means and sums of squared differences
+    // with the parallel variant of Welford's algorithm
+    uint64_t total = dest.registeredFrames + src.registeredFrames;
+    double delta = src.errorMean - dest.errorMean;
+    double destShare = (double) dest.registeredFrames / (double) total;
+    double srcShare = (double) src.registeredFrames / (double) total;
+    dest.errorM2 += src.errorM2 + delta * delta * destShare * (double) src.registeredFrames;
+    dest.errorMean = dest.errorMean * destShare + src.errorMean * srcShare;
+
+    if (dest.registeredFrames == 0 || src.errorMin < dest.errorMin)
+    {
+        dest.errorMin = src.errorMin;
+    }
+    if (dest.registeredFrames == 0 || src.errorMax > dest.errorMax)
+    {
+        dest.errorMax = src.errorMax;
+    }
+
+    dest.registeredFrames = total;
+    dest.passedFrames += src.passedFrames;
+    dest.zeroesRegistered += src.zeroesRegistered;
+    dest.zeroesPassed += src.zeroesPassed;
+    dest.positivePassed += src.positivePassed;
+    dest.positiveUnder += src.positiveUnder;
+    dest.positiveAbove += src.positiveAbove;
+    dest.negativePassed += src.negativePassed;
+    dest.negativeUnder += src.negativeUnder;
+    dest.negativeAbove += src.negativeAbove;
+
+    for (uint16_t i = 0; i < ERROR_BUCKETS; i++)
+    {
+        dest.errorBuckets[i] += src.errorBuckets[i];
+    }
+
+    // A source without a window has nothing to replay
+    if (src.windowSize == 0) return;
+
+    // Replay the window of the source, oldest frame first,
+    // as if its frames came after the ones of dest
+    uint16_t start = (uint16_t) ((src.windowHead + src.windowSize - src.windowFrames) % src.windowSize);
+    for (uint16_t i = 0; i < src.windowFrames; i++)
+    {
+        uint16_t pos = (uint16_t) ((start + i) % src.windowSize);
+        pushWindow(dest, (src.window[pos / 64] >> (pos % 64)) & 1);
+    }
+}
+
+_Float32 ang_vld::errorPercentile(const ang_vld::stats_t &stats, _Float32 p)
+{
+    // The number of frames at or below the percentile
+    double target = (double) stats.registeredFrames * p / 100.0;
+    // The number of frames in the buckets passed so far
+    uint64_t seen = 0;
+
+    for (uint16_t i = 0; i < ERROR_BUCKETS; i++)
+    {
+        uint64_t count = stats.errorBuckets[i];
+        if (count != 0 && (double) (seen + count) >= target)
+        {
+            // Assume the frames are spread evenly within the bucket
+            double within = (target - (double) seen) / (double) count;
+            return (_Float32) ((i + within) * (MAX_ERROR / ERROR_BUCKETS));
+        }
+        seen += count;
+    }
+    return 0.0f;
+}
+
+void ang_vld::setWindowSize(uint16_t frames)
+{
+    // Keep the frames, but start the window over
+    if (!resultsReady)
+    {
+        ang_vld::reset(results, frames);
+        resultsReady = true;
         return;
     }
+    results.windowSize = frames < MAX_WINDOW_SIZE ? frames : MAX_WINDOW_SIZE;
+    results.windowHead = 0;
+    results.windowFrames = 0;
+    results.windowPassed = 0;
+}
+
+ang_vld::stats_t ang_vld::getStats()
+{
+    if (!resultsReady)
+    {
+        ang_vld::reset(results, DEFAULT_WINDOW_SIZE);
+        resultsReady = true;
+    }
+    return results;
+}
+
+void pushWindow(ang_vld::stats_t &stats, bool passed)
+{
+    // A window of size 0 is disabled
+    if (stats.windowSize == 0) return;
+
+    uint64_t &word = stats.window[stats.windowHead / 64];
+    uint64_t bit = (uint64_t) 1 << (stats.windowHead % 64);
+
+    // Drop the oldest frame, which is the one being overwritten
+    if (stats.windowFrames == stats.windowSize)
+    {
+        if (word & bit)
+        {
+            stats.windowPassed--;
+        }
+    }
+    else
+    {
+        stats.windowFrames++;
+    }
+
+    if (passed)
+    {
+        word |= bit;
+        stats.windowPassed++;
+    }
+    else
+    {
+        word &= ~bit;
+    }
+    stats.windowHead = (uint16_t) ((stats.windowHead + 1) % stats.windowSize);
 }
 
 void ang_vld::printResult()
+{
+    ang_vld::print(ang_vld::getStats(), std::cout);
+}
+
+void ang_vld::print(const ang_vld::stats_t &stats, std::ostream &out)
 {
     const std::string SEP = "----------";
 
+    // The variance of the error, undefined below two frames
+    double variance = stats.registeredFrames > 1 ? stats.errorM2 / (double) (stats.registeredFrames - 1) : 0.0;
+
     // This is pretty self explanatory...
-    std::cout << SEP << std::endl;
-    std::cout << "Accuracy report" << std::endl;
-    std::cout << SEP << std::endl;
-    std::cout << "Total frames: " << registeredFrames << std::endl;
-    std::cout << "Passed frames: " << passedFrames << std::endl;
-    std::cout << "Overall accuracy: " << (_Float32) (100 * passedFrames) / (_Float32) registeredFrames << "%" << std::endl;
-    std::cout << SEP << std::endl;
-    std::cout << "Total zeroes: " << zeroesRegistered << std::endl;
-    std::cout << "Values within tolerated zero value: " << zeroesPassed << std::endl;
-    std::cout << SEP << std::endl;
-    std::cout << "Values above tolerated positive values: " << positiveAbove << std::endl;
-    std::cout << "Values within the tolerated positive values: " << positivePassed << std::endl;
-    std::cout << "Values below tolerated positive values: " << positiveUnder << std::endl;
-    std::cout << SEP << std::endl;
-    std::cout << "Values above tolerated negative values: " << negativeAbove << std::endl;
-    std::cout << "Values within the tolerated negative values: " << negativePassed << std::endl;
-    std::cout << "Values below tolerated negative values: " << negativeUnder << std::endl;
-    std::cout << SEP << std::endl;
+    out << SEP << std::endl;
+    out << "Accuracy report" << std::endl;
+    out << SEP << std::endl;
+    out << "Total frames: " << stats.registeredFrames << std::endl;
+    out << "Passed frames: " << stats.passedFrames << std::endl;
+    out << "Overall accuracy: " << (_Float32) (100 * stats.passedFrames) / (_Float32) stats.registeredFrames << "%" << std::endl;
+    out << "Accuracy over the last " << stats.windowFrames << " frames: "
+        << (_Float32) (100 * stats.windowPassed) / (_Float32) stats.windowFrames << "%" << std::endl;
+    out << SEP << std::endl;
+    out << "Total zeroes: " << stats.zeroesRegistered << std::endl;
+    out << "Values within tolerated zero value: " << stats.zeroesPassed << std::endl;
+    out << SEP << std::endl;
+    out << "Values above tolerated positive values: " << stats.positiveAbove << std::endl;
+    out << "Values within the tolerated positive values: " << stats.positivePassed << std::endl;
+    out << "Values below tolerated positive values: " << stats.positiveUnder << std::endl;
+    out << SEP << std::endl;
+    out << "Values above tolerated negative values: " << stats.negativeAbove << std::endl;
+    out << "Values within the tolerated negative values: " << stats.negativePassed << std::endl;
+    out << "Values below tolerated negative values: " << stats.negativeUnder << std::endl;
+    out << SEP << std::endl;
+    out << "Mean error: " << stats.errorMean << std::endl;
+    out << "Standard deviation of the error: " << sqrt(variance) << std::endl;
+    out << "Lowest/highest error: " << stats.errorMin << " / " << stats.errorMax << std::endl;
+    out << "Absolute error p50/p90/p99: " << ang_vld::errorPercentile(stats, 50.0f) << " / "
+        << ang_vld::errorPercentile(stats, 90.0f) << " / " << ang_vld::errorPercentile(stats, 99.0f) << std::endl;
+    out << SEP << std::endl;
 }
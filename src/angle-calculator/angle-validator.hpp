@@ -21,6 +21,20 @@
 #include <iostream>
 #include <math.h>
 
+// Include the standard int types of C
+#include <cstdint>
+
+// The number of buckets in the histogram of the absolute error
+#define ERROR_BUCKETS 64
+
+// The largest absolute error the histogram resolves. Larger
+// errors end up in the last bucket. Twice the maximum
+// absolute steering value covers every possible error
+#define MAX_ERROR 0.6f
+
+// The largest number of frames the sliding window can span
+#define MAX_WINDOW_SIZE 4096
+
 /**
  * A namespace containing functions for testing the accuracy
  * of the angle calculator by comparing its output to the
@@ -29,6 +43,139 @@
  * Author: Bao Quan Lindgren (2023)
  */
 namespace ang_vld {
+
+    /**
+     * The streaming statistics of an accuracy test.
+     *
+     * It takes constant memory no matter how many frames
+     * are registered, and instances can be merged. This
+     * lets every thread of a parallel run fill in its own
+     * instance without locking and merge them at the end.
+     *
+     * @param registeredFrames the total amount of frames
+     * @param passedFrames the subset of frames that passed
+     * @param zeroesRegistered the frames with zero as the
+     * original ground steering request
+     * @param zeroesPassed the passed frames with zero as the
+     * original ground steering request
+     * @param positivePassed the passed frames with a positive
+     * original ground steering request
+     * @param positiveUnder the failed frames with a positive
+     * original ground steering request and a value too low
+     * @param positiveAbove the failed frames with a positive
+     * original ground steering request and a value too high
+     * @param negativePassed the passed frames with a negative
+     * original ground steering request
+     * @param negativeUnder the failed frames with a negative
+     * original ground steering request and a value too low
+     * @param negativeAbove the failed frames with a negative
+     * original ground steering request and a value too high
+     * @param errorMean the running mean of the error
+     * (ours - actual), updated with Welford's algorithm
+     * @param errorM2 the running sum of squared differences
+     * from the mean, updated with Welford's algorithm
+     * @param errorMin the lowest error registered
+     * @param errorMax the highest error registered
+     * @param errorBuckets the histogram of the absolute error,
+     * each bucket spanning MAX_ERROR / ERROR_BUCKETS
+     * @param windowSize the number of most recent frames the
+     * sliding window spans
+     * @param window the pass (1) or fail (0) bit of the most
+     * recent frames, used as a ring buffer
+     * @param windowHead the position in window the next frame
+     * is written to
+     * @param windowFrames the number of frames in the window
+     * @param windowPassed the number of passed frames in the window
+     */
+    struct stats_t {
+        uint64_t registeredFrames;
+        uint64_t passedFrames;
+        uint64_t zeroesRegistered;
+        uint64_t zeroesPassed;
+        uint64_t positivePassed;
+        uint64_t positiveUnder;
+        uint64_t positiveAbove;
+        uint64_t negativePassed;
+        uint64_t negativeUnder;
+        uint64_t negativeAbove;
+        double errorMean;
+        double errorM2;
+        _Float32 errorMin;
+        _Float32 errorMax;
+        uint64_t errorBuckets[ERROR_BUCKETS];
+        uint16_t windowSize;
+        uint64_t window[MAX_WINDOW_SIZE / 64];
+        uint16_t windowHead;
+        uint16_t windowFrames;
+        uint16_t windowPassed;
+    };
+
+    /**
+     * Resets statistics to hold no frames
+     *
+     * @param stats the statistics to reset
+     * @param windowSize the number of most recent frames
+     * the sliding window spans, at most MAX_WINDOW_SIZE
+     */
+    void reset(stats_t &stats, uint16_t windowSize);
+
+    /**
+     * Registers a frame in statistics without touching
+     * the global test
+     *
+     * @param stats the statistics to register the frame in
+     * @param actual the original ground steering request
+     * @param ours the output from the angle calculator
+     */
+    void add(stats_t &stats, _Float32 actual, _Float32 ours);
+
+    /**
+     * Merges the frames of one instance of statistics into
+     * another. The frames of the source are treated as having
+     * been registered after the ones of the destination, which
+     * decides what ends up in the sliding window.
+     *
+     * @param dest the statistics to merge into
+     * @param src the statistics to merge from
+     */
+    void merge(stats_t &dest, const stats_t &src);
+
+    /**
+     * Estimates a percentile of the absolute error from
+     * the histogram. The estimate is off by at most the
+     * width of one bucket
+     *
+     * @param stats the statistics to read from
+     * @param p the percentile, between 0 and 100
+     * @return the absolute error that p percent of the
+     * frames are at or below
+     */
+    _Float32 errorPercentile(const stats_t &stats, _Float32 p);
+
+    /**
+     * Prints statistics
+     *
+     * @param stats the statistics to print
+     * @param out the stream to print to
+     */
+    void print(const stats_t &stats, std::ostream &out);
+
+    /**
+     * Sets the number of most recent frames the sliding
+     * window accuracy of the test is calculated over.
+     * Resets the window.
+     *
+     * @param frames the number of frames, at most
+     * MAX_WINDOW_SIZE
+     */
+    void setWindowSize(uint16_t frames);
+
+    /**
+     * Gets a copy of the current statistics of the test
+     *
+     * @return the statistics of the test
+     */
+    stats_t getStats();
     /**
      * Sets the acceptable margin of error for each frame
      * with a non-zero value.
@@ -59,6 +206,35 @@ namespace ang_vld {
      */
     void registerSteering(_Float32 actual, _Float32 ours);
 
+    /**
+     * Starts a background thread that prints snapshots of
+     * the statistics of the test to std::clog, apart from the
+     * steering values on std::cout. The frame loop only hands
+     * over a copy of the statistics when a report is due, so
+     * reporting doesn't slow the loop down.
+     *
+     * @param frames the number of registered frames between
+     * reports, or 0 to not report by frame count
+     * @param millis the number of milliseconds between
+     * reports, or 0 to not report by time
+     */
+    void startReporter(uint32_t frames, uint32_t millis);
+
+    /**
+     * Hands a snapshot of the statistics to the reporter if
+     * a report is due. Meant to be called after every
+     * registered frame. Never blocks; if the reporter is busy
+     * the snapshot is skipped and taken on the next frame.
+     */
+    void reportIfDue();
+
+    /**
+     * Stops the reporter. A snapshot that hasn't been printed
+     * is dropped, as the final statistics are printed after it
+     * with printResult. Called once the frame loop has stopped.
+     */
+    void stopReporter();
+
     /**
      * Prints the current statistics of the accuracy test.
      * This includes the total amount of registered frames,
@@ -0,0 +1,37 @@
+#! /usr/bin/sh
+# Builds the angle calculator with profile-guided and link-time optimisation into
+# build/: an instrumented build is trained on the benchmarks, then rebuilt with
+# its profile and LTO. The benchmarks of a plain release build are compared with
+# the optimised one in build/pgo-report.txt.
+
+set -e
+
+rm -rf build/ build-baseline/
+
+# The plain release build, to compare with
+mkdir build-baseline
+cd build-baseline
+cmake -D CMAKE_BUILD_TYPE=Release ..
+make
+./angle-calculator-bench --json=angle-calculator.json > /dev/null
+./steering-math-bench --json=steering-math.json > /dev/null
+cd ..
+
+# The instrumented build, trained on every cone layout and the steering math
+mkdir build
+cd build
+cmake -D CMAKE_BUILD_TYPE=Release -D PGO=generate -D LTO=OFF ..
+make
+./angle-calculator-bench --ops=500000 > /dev/null
+./steering-math-bench --ops=1000000 > /dev/null
+
+# The optimised build
+cmake -D PGO=use -D LTO=ON ..
+make clean
+make
+./angle-calculator-bench --json=angle-calculator.json > /dev/null
+./steering-math-bench --json=steering-math.json > /dev/null
+
+sh ../../api/bench-report.sh ../build-baseline/angle-calculator.json angle-calculator.json > pgo-report.txt
+sh ../../api/bench-report.sh ../build-baseline/steering-math.json steering-math.json >> pgo-report.txt
+cat pgo-report.txt
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Shows the statistics the cone detector, angle-pilot and the
+// angle calculator publish in their telemetry segments, live,
+// like top. It only maps the segments read-only, so it can be
+// started and stopped at any time without the binaries noticing.
+
+// The segments to read
+#include "../api/telemetry.hpp"
+
+// Include cluon for the command line parameters
+#include "../cone-detection/cluon-complete-v0.0.127.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+// Include the standard int types of C
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// For listing the segments and checking their binaries are alive
+#include <dirent.h>
+#include <signal.h>
+
+// Where the segments are
+#define SHM_DIR "/dev/shm"
+
+/**
+ * A segment that is shown, with the copy of the previous refresh
+ * that the rates and percentiles are worked out against
+ *
+ * @param reader the reader of the segment
+ * @param previous the copy of the previous refresh
+ * @param hasPrevious whether there was a previous refresh
+ */
+struct shown_t {
+    std::unique_ptr<telemetry::Reader> reader;
+    telemetry::snapshot_t previous;
+    bool hasPrevious;
+};
+
+/**
+ * Lists the segments in SHM_DIR
+ *
+ * @return the names of the segments, after telemetry::PREFIX
+ */
+std::vector<std::string> listSegments();
+
+/**
+ * Prints one segment
+ *
+ * @param name the name of the segment
+ * @param now the copy of this refresh
+ * @param before the copy of the previous refresh, all zero for since the start
+ * @param elapsed the microseconds between the two copies
+ * @param out the stream to print to
+ */
+void printSegment(const std::string &name, const telemetry::snapshot_t &now, const telemetry::snapshot_t &before,
+                  int64_t elapsed, std::ostream &out);
+
+// Main entry point
+int32_t main(int32_t argc, char **argv)
+{
+    auto cmdargs = cluon::getCommandlineArguments(argc, argv);
+    if (cmdargs.count("help"))
+    {
+        std::cerr << argv[0] << " shows the statistics the cone detector, angle-pilot and the angle calculator publish, live." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " [--name=<segment>] [--interval=<milliseconds>] [--once]" << std::endl;
+        std::cerr << "         --name: only show this segment, e.g. cone-detector (default: every segment in " << SHM_DIR << ")" << std::endl;
+        std::cerr << "         --interval: milliseconds between refreshes, over which the rates and percentiles are worked out (int, default 1000)" << std::endl;
+        std::cerr << "         --once: print the statistics since the binaries started once and exit" << std::endl;
+        std::cerr << "Example: " << argv[0] << " --interval=500" << std::endl;
+        return 1;
+    }
+
+    const bool ONCE = cmdargs.count("once");
+    const int64_t INTERVAL = cmdargs.count("interval") ? std::max(std::stoll(cmdargs["interval"]), 10ll) : 1000;
+    const telemetry::snapshot_t ZERO{};
+
+    std::map<std::string, shown_t> shown;
+    int64_t lastRefresh = trace::now();
+    while (true)
+    {
+        // Segments come and go with their binaries
+        std::vector<std::string> names = cmdargs.count("name") ? std::vector<std::string>{cmdargs["name"]} : listSegments();
+        for (auto it = shown.begin(); it != shown.end();)
+        {
+            it = std::find(names.begin(), names.end(), it->first) == names.end() ? shown.erase(it) : std::next(it);
+        }
+        for (const std::string &name : names)
+        {
+            if (shown.count(name)) continue;
+            try
+            {
+                shown[name] = {std::unique_ptr<telemetry::Reader>(new telemetry::Reader(name)), {}, false};
+            }
+            catch (const telemetry::TelemetryException &e)
+            {
+                // Another version's segment is only mentioned, a missing one is waited for
+                if (e == telemetry::TelemetryException::FORMAT)
+                {
+                    std::cerr << "The segment " << name << " is laid out by another version" << std::endl;
+                }
+            }
+        }
+
+        int64_t now = trace::now();
+        int64_t elapsed = now - lastRefresh;
+        lastRefresh = now;
+
+        // Clear the terminal, unless printing once
+        if (!ONCE)
+        {
+            std::cout << "\033[H\033[2J";
+        }
+        if (shown.empty())
+        {
+            std::cout << "No telemetry segments in " << SHM_DIR << " yet" << std::endl;
+        }
+        for (auto &s : shown)
+        {
+            telemetry::snapshot_t snapshot;
+            if (!s.second.reader->read(snapshot))
+            {
+                std::cout << s.first << ": busy" << std::endl;
+                continue;
+            }
+            const bool SINCE_START = ONCE || !s.second.hasPrevious;
+            printSegment(s.first, snapshot, SINCE_START ? ZERO : s.second.previous,
+                         SINCE_START ? snapshot.updated - snapshot.started : elapsed, std::cout);
+            s.second.previous = snapshot;
+            s.second.hasPrevious = true;
+        }
+        std::cout << std::flush;
+
+        if (ONCE)
+        {
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(INTERVAL));
+    }
+}
+
+std::vector<std::string> listSegments()
+{
+    std::vector<std::string> names;
+    DIR *dir = opendir(SHM_DIR);
+    if (dir == nullptr)
+    {
+        return names;
+    }
+
+    const size_t PREFIX_LENGTH = std::strlen(telemetry::PREFIX);
+    while (struct dirent *entry = readdir(dir))
+    {
+        if (std::strncmp(entry->d_name, telemetry::PREFIX, PREFIX_LENGTH) == 0)
+        {
+            names.push_back(entry->d_name + PREFIX_LENGTH);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+void printSegment(const std::string &name, const telemetry::snapshot_t &now, const telemetry::snapshot_t &before,
+                  int64_t elapsed, std::ostream &out)
+{
+    // A binary that was killed leaves its segment behind
+    const bool ALIVE = kill(now.pid, 0) == 0 || errno == EPERM;
+    const double SECONDS = (double) std::max(elapsed, (int64_t) 1) / 1e6;
+
+    out << std::fixed << std::setprecision(1);
+    out << now.binary << " [" << name << "] pid " << now.pid << ", up " << (double) (now.updated - now.started) / 1e6 << " s, ";
+    if (ALIVE)
+    {
+        out << "last frame " << (double) (trace::now() - now.updated) / 1e3 << " ms ago" << std::endl;
+    }
+    else
+    {
+        out << "exited" << std::endl;
+    }
+
+    out << "  frames " << now.frames << "   fps " << (double) (now.frames - before.frames) / SECONDS
+        << "   drops " << now.drops << " (+" << now.drops - before.drops << ")"
+        << "   queue " << now.queueDepth << " (max " << now.maxQueueDepth << ")"
+        << "   qos " << (now.qosLevel < 0 ? "-" : now.qosName)
+        << "   cpu " << (double) (now.cpuMicros - before.cpuMicros) / 1e4 / SECONDS << "%" << std::endl;
+
+    // The frames and time at every quality level, with a deadline
+    if (now.qosLevel >= 0)
+    {
+        out << "  " << std::left << std::setw(10) << "quality" << std::right << std::setw(10) << "frames"
+            << std::setw(10) << "ms" << std::setw(12) << "all frames" << std::setw(10) << "all ms" << std::endl;
+        for (uint32_t i = 0; i < telemetry::QOS_LEVELS; i++)
+        {
+            const telemetry::qos_t &qos = now.qos[i];
+
+            // Skip levels that the binary doesn't have
+            if (qos.name[0] == '\0') continue;
+
+            out << "  " << std::left << std::setw(10) << qos.name << std::right
+                << std::setw(10) << qos.frames - before.qos[i].frames
+                << std::setw(10) << (double) (qos.micros - before.qos[i].micros) / 1e3
+                << std::setw(12) << qos.frames
+                << std::setw(10) << (double) qos.micros / 1e3 << std::endl;
+        }
+    }
+
+    out << "  " << std::left << std::setw(10) << "stage" << std::right << std::setw(10) << "passes"
+        << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max" << "  (us)" << std::endl;
+    for (uint8_t i = 0; i < trace::STAGE_COUNT; i++)
+    {
+        const telemetry::stage_t &stage = now.stages[i];
+
+        // Skip stages that the binary doesn't run
+        if (stage.passes == 0) continue;
+
+        out << "  " << std::left << std::setw(10) << trace::STAGE_NAMES[i] << std::right
+            << std::setw(10) << stage.passes - before.stages[i].passes
+            << std::setw(10) << telemetry::percentile(stage, before.stages[i], 0.5)
+            << std::setw(10) << telemetry::percentile(stage, before.stages[i], 0.9)
+            << std::setw(10) << telemetry::percentile(stage, before.stages[i], 0.99)
+            << std::setw(10) << stage.max << std::endl;
+    }
+    out << std::endl;
+}
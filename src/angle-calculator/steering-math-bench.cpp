@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Compares the fast float path of the steering calculation
+// (fastAtan2, getAngleFast) with the original
+// one, both in speed and, with --check, in accuracy.
+
+// The steering calculation to benchmark
+#include "steering.hpp"
+
+// The timing and reporting helpers
+#include "../api/bench.hpp"
+
+// Include the standard int types of C
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Declares a set of function to compute common mathematical operations.
+#include <math.h>
+
+// The number of distinct inputs each benchmark cycles through
+#define INPUT_COUNT 4096
+
+/**
+ * Checks fastAtan2 against atan2 for every float ratio between
+ * 0 and 1, which is every input the polynomial sees, in all
+ * octants, and checks getAngleFast against getAngle on a grid
+ * of points around the origin
+ *
+ * @return the largest error found in degrees
+ */
+double checkAtan2();
+
+// Main entry point
+int32_t main(int32_t argc, char **argv)
+{
+    auto cmdargs = cluon::getCommandlineArguments(argc, argv);
+    if (cmdargs.count("help"))
+    {
+        std::cerr << argv[0] << " benchmarks the fast steering math against the original implementation." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " [--ops=<operations>] [--json=<file>] [--check]" << std::endl;
+        std::cerr << "         --ops: number of operations to time per benchmark (int, default 10000000)" << std::endl;
+        std::cerr << "         --json: file to write the results to as JSON" << std::endl;
+        std::cerr << "         --check: check the accuracy over the whole input range instead, exits with 1 if out of bounds" << std::endl;
+        std::cerr << "Example: " << argv[0] << " --ops=1000000 --json=steering-math.json" << std::endl;
+        return 1;
+    }
+
+    // The parameters the angle calculator is deployed with
+    ang_calc::configure(640, 110, 55.0f, 75.0f, -0.5f, 3.0f, 0.0f);
+
+    if (cmdargs.count("check"))
+    {
+        double atanError = checkAtan2();
+        std::cout << "Largest fastAtan2/getAngleFast error: " << atanError << " deg (bound " << FAST_ATAN2_MAX_ERROR << ")" << std::endl;
+
+        bool passed = atanError <= FAST_ATAN2_MAX_ERROR;
+        std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+        return passed ? 0 : 1;
+    }
+
+    uint64_t ops = cmdargs.count("ops") ? std::stoull(cmdargs["ops"]) : 10000000;
+
+    // Fixed seed, so every run times the same inputs
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> xDist(0.0f, 640.0f);
+    std::uniform_real_distribution<float> yDist(-200.0f, 400.0f);
+    std::uniform_real_distribution<float> angleDist(-100.0f, 100.0f);
+    std::uniform_int_distribution<uint16_t> coneX(0, 639);
+    std::uniform_int_distribution<uint16_t> coneY(0, 109);
+
+    std::vector<ang_calc::point_t> points;
+    std::vector<_Float32> angles;
+    std::vector<pos_api::data_t> data;
+    for (uint32_t i = 0; i < INPUT_COUNT; i++)
+    {
+        points.push_back({xDist(rng), yDist(rng)});
+        angles.push_back(angleDist(rng));
+        data.push_back({
+            {coneX(rng), coneY(rng)},
+            {coneX(rng), coneY(rng)},
+            {coneX(rng), coneY(rng)},
+            {coneX(rng), coneY(rng)},
+            {0}, {0}, 0.0f
+        });
+    }
+
+    const ang_calc::point_t origin = ang_calc::getOrigin();
+    const uint32_t MASK = INPUT_COUNT - 1;
+    std::vector<bench::result_t> results;
+
+    results.push_back(bench::measure("atan2f", ops, [&](uint64_t i) {
+        const ang_calc::point_t &p = points[i & MASK];
+        bench::consume(atan2f(p.y, p.x));
+    }));
+    results.push_back(bench::measure("fastAtan2", ops, [&](uint64_t i) {
+        const ang_calc::point_t &p = points[i & MASK];
+        bench::consume(ang_calc::fastAtan2(p.y, p.x));
+    }));
+    results.push_back(bench::measure("getAngle", ops, [&](uint64_t i) {
+        bench::consume(ang_calc::getAngle(origin, points[i & MASK]));
+    }));
+    results.push_back(bench::measure("getAngleFast", ops, [&](uint64_t i) {
+        bench::consume(ang_calc::getAngleFast(origin, points[i & MASK]));
+    }));
+    results.push_back(bench::measure("mapAngle", ops, [&](uint64_t i) {
+        bench::consume(ang_calc::mapAngle(angles[i & MASK]));
+    }));
+    results.push_back(bench::measure("calculateSteering", ops, [&](uint64_t i) {
+        bench::consume(ang_calc::calculateSteering(data[i & MASK]));
+    }));
+    results.push_back(bench::measure("calculateSteeringFast", ops, [&](uint64_t i) {
+        bench::consume(ang_calc::calculateSteeringFast(data[i & MASK]));
+    }));
+
+    for (const bench::result_t &r : results)
+    {
+        bench::print(r, std::cout);
+    }
+
+    if (cmdargs.count("json"))
+    {
+        std::ofstream json(cmdargs["json"]);
+        bench::printJson(results, json);
+    }
+    return 0;
+}
+
+double checkAtan2()
+{
+    double maxError = 0.0;
+    const double DEG = 180.0 / M_PI;
+
+    // Every float from 0 up to and including 1
+    uint32_t last;
+    const float ONE = 1.0f;
+    memcpy(&last, &ONE, sizeof (float));
+    for (uint32_t bits = 0; bits <= last; bits++)
+    {
+        float z;
+        memcpy(&z, &bits, sizeof (float));
+
+        // One vector per octant, so both reductions and
+        // every sign combination are covered
+        const float VECTORS[8][2] = {
+            {z, 1.0f}, {1.0f, z}, {1.0f, -z}, {z, -1.0f},
+            {-z, -1.0f}, {-1.0f, -z}, {-1.0f, z}, {-z, 1.0f}
+        };
+        // The octants share their error up to the sign, so
+        // checking all of them for a sample is enough
+        uint8_t octants = (bits & 0xfff) == 0 ? 8 : 2;
+        for (uint8_t o = 0; o < octants; o++)
+        {
+            double expected = atan2((double) VECTORS[o][0], (double) VECTORS[o][1]) * DEG;
+            double error = fabs(ang_calc::fastAtan2(VECTORS[o][0], VECTORS[o][1]) - expected);
+
+            // +180 and -180 are the same angle
+            error = fmin(error, 360.0 - error);
+            maxError = fmax(maxError, error);
+        }
+    }
+
+    // getAngleFast against getAngle, including the folding
+    const ang_calc::point_t origin = ang_calc::getOrigin();
+    for (int32_t x = -1000; x <= 1640; x++)
+    {
+        for (int32_t y = -1000; y <= 1110; y += 7)
+        {
+            ang_calc::point_t p = {(_Float32) x + 0.25f, (_Float32) y};
+            double error = fabs(ang_calc::getAngleFast(origin, p) - ang_calc::getAngle(origin, p));
+            maxError = fmax(maxError, error);
+        }
+
+        // The horizontal lines on both sides
+        ang_calc::point_t level = {(_Float32) x + 0.25f, origin.y};
+        maxError = fmax(maxError, fabs(ang_calc::getAngleFast(origin, level) - ang_calc::getAngle(origin, level)));
+    }
+
+    // The origin itself has no line, both are NaN
+    if (!isnan(ang_calc::getAngleFast(origin, origin)) || !isnan(ang_calc::getAngle(origin, origin)))
+    {
+        maxError = INFINITY;
+    }
+    return maxError;
+}
@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "steering.hpp"
+
+// Declares a set of function to compute common mathematical operations. 
+#include <math.h>
+
+using namespace ang_calc;
+
+// The width of the frame being processed
+uint16_t width;
+
+// The height of the frame being processed
+uint16_t height;
+
+// The threshold to pass for calculateSteering to output something non-zero
+_Float32 zeroThreshold;
+// The threshold to pass for calculateSteering to output MAX_ABS_STEERING_ANGLE
+_Float32 maxThreshold;
+
+// The fraction that the origin's y coordinate
+// should be offset by
+_Float32 originYOffset;
+
+// The fraction that each default lines' top point should be placed
+// from the sides of the frame. This MUST be a whole number!!
+_Float32 defaultLineOffset;
+
+// Degrees to shift when calculating the output,
+// with positive going counterclockwise
+_Float32 angleBias;
+
+// The origin of the car heading
+point_t origin;
+
+// The default edge for the right side
+// when no line can be drawn
+line_t rightDefault;
+// The default edge for the left side
+// when no line can be drawn
+line_t leftDefault;
+
+void ang_calc::configure(uint16_t frameWidth, uint16_t frameHeight,
+                         _Float32 zero, _Float32 max,
+                         _Float32 yOffset, _Float32 lineOffset,
+                         _Float32 bias)
+{
+    width = frameWidth;
+    height = frameHeight;
+    zeroThreshold = zero;
+    maxThreshold = max;
+    originYOffset = yOffset;
+    defaultLineOffset = lineOffset;
+    angleBias = bias;
+
+    origin = {(_Float32) width / 2.0f, height * originYOffset};
+
+    // Get the default right edge between the top center
+    // and bottom right corner
+    rightDefault = getLineFromCones(
+        {(uint16_t) (width - 1), 0},
+        {(uint16_t) ((width / defaultLineOffset) * (defaultLineOffset - 1.0f)), height}
+    );
+
+    // Get the default right edge between the top center
+    // and bottom left corner
+    leftDefault = getLineFromCones(
+        {1, 0},
+        {(uint16_t) (width / defaultLineOffset), height}
+    );
+}
+
+point_t ang_calc::getOrigin()
+{
+    return origin;
+}
+
+line_t ang_calc::getLineFromCones(const pos_api::cone_t close, const pos_api::cone_t far)
+{
+    // Check if there is a cone at all
+    if (pos_api::isEqual(close, pos_api::NO_CONE_POS))
+    {
+        return NO_CONE_LINE;
+    }
+    // Catch division by 0 (infinite slope)
+    if (far.posX == close.posX)
+    {
+        // Includes the x value in place of line_t.constant
+        return {INF_SLOPE, (_Float32) close.posX};
+    }
+
+    // dy/dx
+    _Float32 coeff = (_Float32) (far.posY - close.posY) / (_Float32) (far.posX - close.posX);
+    // y1 - ax1
+    _Float32 constant = far.posY - (coeff * far.posX);
+
+    return {coeff, constant};
+}
+
+point_t ang_calc::getIntersect(const line_t f, const line_t g)
+{
+    // x coordinate of the intersect
+    _Float32 x;
+    // y coordinate of the intersect
+    _Float32 y;
+
+    // Return the point at the top of the frame
+    // right in between the lines if they are vertical
+    if (f.coefficient == INF_SLOPE && g.coefficient == INF_SLOPE)
+    {
+        return {f.constant - g.constant, 0.0f};
+    }
+    // If one of the lines is vertical,
+    // take that into consideration
+    else if (f.coefficient == INF_SLOPE)
+    {
+        // f.constant is the x value where the line is at
+        x = f.constant;
+        y = g.coefficient * x;
+    }
+    else if (g.coefficient == INF_SLOPE)
+    {
+        // g.constant is the x value where the line is at
+        x = g.constant;
+        y = f.coefficient * x;
+    }
+    // Otherwise, treat them as regular functions
+    else
+    {
+        // f(x) = g(x)
+        // mf * x + bf = mg * x + bg
+        // x * (mf - mg) = bg - bf
+        // x = (bg - bf) / (mf - mg)
+        x = (g.constant - f.constant) / (f.coefficient - g.coefficient);
+
+        y = f.coefficient * x + f.constant;
+    }
+
+    return {x, y};
+}
+
+_Float32 ang_calc::getAngle(const point_t origin, const point_t p) {
+    // The angle in degrees from the line between the line
+    // between origin and p, and the x-axis
+    // Positive values -> counterclockwise rotation
+    _Float32 angle = atan((origin.y - p.y) / (origin.x - p.x)) * (180 / M_PI);
+
+    // Convert negative angles to their corresponding positive
+    // angle and shift by 90 degrees, so the positive y-axis
+    // becomes the line of refernece
+    angle = fmod(angle + 180.0f, 180.0f) - 90.0f;
+
+    // Return the angle with a bias, if there is one
+    return angle + angleBias;
+}
+
+_Float32 ang_calc::fastAtan2(const _Float32 y, const _Float32 x)
+{
+    _Float32 absY = fabsf(y);
+    _Float32 absX = fabsf(x);
+
+    // Reduce to a ratio between 0 and 1, which is the
+    // range the polynomial is fitted on
+    bool steep = absY > absX;
+    _Float32 z = steep ? absX / absY : absY / absX;
+
+    // atan(0/0) is 0, like atan2
+    if (absX == 0.0f && absY == 0.0f)
+    {
+        z = 0.0f;
+    }
+
+    // Minimax polynomial of atan(z) on [0, 1] in degrees, with the
+    // coefficients from radians scaled by 180 / pi. The maximum
+    // error of the polynomial is 1.8e-6 rad, which is 1.0e-4 deg
+    _Float32 s = z * z;
+    _Float32 a = z * (57.29447661f + s * (-19.05792100f + s * (11.08922341f +
+                 s * (-6.67111205f + s * (3.01681301f + s * -0.67157529f)))));
+
+    // Undo the reduction, one octant at a time
+    if (steep)
+    {
+        a = 90.0f - a;
+    }
+    if (x < 0)
+    {
+        a = 180.0f - a;
+    }
+    return y < 0 ? -a : a;
+}
+
+_Float32 ang_calc::getAngleFast(const point_t origin, const point_t p)
+{
+    // The line between origin and p, as a vector
+    _Float32 dx = origin.x - p.x;
+    _Float32 dy = origin.y - p.y;
+
+    // getAngle folds a horizontal line to -90 on either side,
+    // and gives NaN for the origin itself; it's left to give
+    // the same for these rare points
+    if (dy == 0.0f)
+    {
+        return getAngle(origin, p);
+    }
+
+    // getAngle folds atan(dy / dx) into the angle from the
+    // y-axis, which is -atan(dx / dy). Flipping the vector
+    // into the upper half-plane keeps atan2 within
+    // -90 to +90 degrees, the same range as atan
+    _Float32 angle = dy < 0 ? -fastAtan2(-dx, -dy) : -fastAtan2(dx, dy);
+
+    // Return the angle with a bias, if there is one
+    return angle + angleBias;
+}
+
+bool ang_calc::isEqual(const line_t f, const line_t g)
+{
+    return f.coefficient == g.coefficient && f.constant == g.constant;
+}
+
+void ang_calc::determineEdges(line_t *const f, line_t *const g)
+{
+    // The value of function f
+    line_t _f = *f;
+    // The value of function g
+    line_t _g = *g;
+
+    // Represents if f has cones or not
+    bool fNoCone = isEqual(_f, NO_CONE_LINE);
+    // Represents if g has cones or not
+    bool gNoCone = isEqual(_g, NO_CONE_LINE);
+
+    // If there are no cones, assume both lines
+    if (fNoCone && gNoCone)
+    {
+        *f = leftDefault;
+        *g = rightDefault;
+    }
+    // If f has no cones...
+    else if (fNoCone && !gNoCone)
+    {
+        // Check if g is on the right or left side
+        // and then assume f
+        if (_g.coefficient < 0 ||
+            _g.coefficient == INF_SLOPE && _g.constant > origin.x)
+        {
+            *f = leftDefault;
+        }
+        else
+        {
+            *f = rightDefault;
+        }
+    }
+    // If g has no cones...
+    else if (gNoCone && !fNoCone)
+    {
+        // Check if f is on the right or left side
+        // and then assume g
+        if (_f.coefficient < 0 ||
+            _f.coefficient == INF_SLOPE && _f.constant > origin.x)
+        {
+            *g = leftDefault;
+        }
+        else
+        {
+            *g = rightDefault;
+        }
+    }
+}
+
+_Float32 ang_calc::getSteeringAngle(const pos_api::data_t data, bool fast)
+{
+    // Start by getting the lines from the cones,
+    // if there are any
+
+    // The line between the blue cones
+    line_t bLine = getLineFromCones(data.bClose, data.bFar);
+    // The line between the yellow cones
+    line_t yLine = getLineFromCones(data.yClose, data.yFar);
+
+    // Determine which side the cones are on
+    // and assume edges for non-existent edges
+    determineEdges(&bLine, &yLine);
+
+    // The intersect between the two lines, if there is one
+    point_t intersect = getIntersect(bLine, yLine);
+
+    // The angle between a horizontal line and
+    // the line between origin and intersect
+    return fast ? getAngleFast(origin, intersect) : getAngle(origin, intersect);
+}
+
+_Float32 ang_calc::mapAngle(const _Float32 angle)
+{
+    // A check for whether the angle is on the right side
+    bool right = angle < 0;
+    // The magnitude of the angle
+    _Float32 magnitude = fabsf(angle);
+
+    // If the angle is within the range that it's acceptable
+    // to not turn, don't
+    if (0.0f <= magnitude && magnitude <= zeroThreshold)
+    {
+        return 0.0f;
+    }
+    // If it's between no steering and maximum turn,
+    // output a value between 0 and the maximum value
+    else if (zeroThreshold < magnitude && magnitude <= maxThreshold)
+    {
+        // The value to output
+        _Float32 val;
+        // Get the percentage between no steering and max turn
+        val = (magnitude - zeroThreshold) / (maxThreshold - zeroThreshold);
+        // Multiply the percentage with the maximum value
+        val *= MAX_ABS_STEERING_VAL;
+
+        // Right turns have a negative angle
+        if (right)
+        {
+            val = -val;
+        }
+        return val;
+    }
+
+    // If it's above the max turn threshold, turn
+    // Multiply by -1 if we're turning to the right
+    return MAX_ABS_STEERING_VAL * (right ? -1 : 1);
+}
+
+_Float32 ang_calc::calculateSteering(const pos_api::data_t data)
+{
+    return mapAngle(getSteeringAngle(data, false));
+}
+
+_Float32 ang_calc::calculateSteeringFast(const pos_api::data_t data)
+{
+    return mapAngle(getSteeringAngle(data, true));
+}
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_STEERING_HPP
+#define DIT639_2023_GROUP_13_STEERING_HPP
+
+// Include the header with the cone data structs
+#include "../api/position.hpp"
+
+// Include the standard int types of C
+#include <cstdint>
+
+// The maximum absolute steering value
+#define MAX_ABS_STEERING_VAL 0.290888f
+
+// Output value of no steering angle
+#define NO_ANGLE 0.0f
+
+// The upper bound of the error of fastAtan2 in degrees
+#define FAST_ATAN2_MAX_ERROR 0.0002f
+
+/*
+ * The steering calculation of the angle calculator.
+ *
+ * It is kept apart from the angle calculator's main()
+ * so that the same calculation can be linked into any
+ * binary that has cone data at hand, e.g. the fused
+ * detector and calculator.
+ *
+ * configure() MUST be called once before any of the
+ * other functions are used.
+ */
+namespace ang_calc {
+
+    /**
+     * Struct representing a linear mathematical functions.
+     * (y = coefficient * x + constant)
+     *
+     * @param coefficient the slope of the linear function.
+     * float max if the slope inclination is infinite
+     * @param constant the constant of the linear function.
+     * x value if the slope inclination is infinite
+     */
+    struct line_t {
+        _Float32 coefficient;
+        _Float32 constant;
+    };
+
+    /**
+     * Struct representing a point in a graph with x and y
+     * coordinates
+     *
+     * @param x the x coordinate of the point
+     * @param y the y coordinate of the point
+     */
+    struct point_t {
+        _Float32 x;
+        _Float32 y;
+    };
+
+    // The coefficient for a slope with infinite inclination
+    const _Float32 INF_SLOPE = 0.0f;
+
+    // The slope for NO_CONE_POS
+    const line_t NO_CONE_LINE = {
+        (_Float32) pos_api::NO_CONE_POS.posX,
+        (_Float32) pos_api::NO_CONE_POS.posY
+    };
+
+    /**
+     * Sets the parameters of the steering calculation and
+     * derives the origin and the default edges from them.
+     *
+     * @param width the width of the frame being processed
+     * @param height the height of the frame being processed
+     * @param zeroThreshold the threshold to pass to output
+     * something non-zero
+     * @param maxThreshold the threshold to pass to output
+     * MAX_ABS_STEERING_VAL
+     * @param originYOffset the fraction that the origin's
+     * y coordinate should be offset by
+     * @param defaultLineOffset the fraction that each default
+     * lines' top point should be placed from the sides of the
+     * frame. This MUST be a whole number!!
+     * @param angleBias degrees to shift when calculating the
+     * output, with positive going counterclockwise
+     */
+    void configure(uint16_t width, uint16_t height,
+                   _Float32 zeroThreshold, _Float32 maxThreshold,
+                   _Float32 originYOffset, _Float32 defaultLineOffset,
+                   _Float32 angleBias);
+
+    /**
+     * Applies the two-point-equation on two cone
+     * positions and calculates a mathematical
+     * linear function
+     *
+     * @param close the closest cone of one side
+     * @param far the second closest cone on the
+     * same side
+     * @returns the coefficient and constant for
+     * a linear mathematical function unless it
+     * has an infinite slope inclination, in which
+     * case it returns float max and the x value
+     * of the line
+     */
+    line_t getLineFromCones(const pos_api::cone_t close, const pos_api::cone_t far);
+
+    /**
+     * Calculates the intersection between 2 lines,
+     * if there is one. Otherwise returns the origin
+     * in terms of the car heading.
+     *
+     * @param f one of the functions to check the
+     * intersect of
+     * @param g the other function to check the
+     * intersect of
+     * @returns the point of intersect if there is one,
+     * otherwise the origin in terms of the car heading
+     */
+    point_t getIntersect(const line_t f, const line_t g);
+
+    /**
+     * Gets the angle between a vertical line and the line
+     * between two points.
+     * The output value ranges from -180 deg to +180 deg
+     * with negative values going clockwise
+     *
+     * @param origin the starting point of the line
+     * @param p the endpoint of the line
+     * @return an angle between -180 and +180
+     */
+    _Float32 getAngle(const point_t origin, const point_t p);
+
+    /**
+     * Calculates atan2(y, x) with a polynomial instead of
+     * the math library. The result is within
+     * FAST_ATAN2_MAX_ERROR degrees of atan2.
+     *
+     * @param y the y coordinate of the vector
+     * @param x the x coordinate of the vector
+     * @return the angle between the x-axis and the vector
+     * in degrees, between -180 and +180
+     */
+    _Float32 fastAtan2(const _Float32 y, const _Float32 x);
+
+    /**
+     * Does the same as getAngle, using fastAtan2.
+     * The result is within FAST_ATAN2_MAX_ERROR degrees
+     * of getAngle.
+     *
+     * @param origin the starting point of the line
+     * @param p the endpoint of the line
+     * @return an angle between -180 and +180
+     */
+    _Float32 getAngleFast(const point_t origin, const point_t p);
+
+    /**
+     * Checks if two lines are equal.
+     * Lines are equal if both of their coefficients and
+     * constants are equal
+     *
+     * @param f a line
+     * @param g another line
+     * @return a bool representing if the lines are equal
+     * or not
+     */
+    bool isEqual(const line_t f, const line_t g);
+
+    /**
+     * Fills in edges if they don't exist by checking the
+     * existing edge. If no edge exists, it assumes the default
+     * lines
+     *
+     * @param f a pointer to a line
+     * @param g a pointer to another line
+     */
+    void determineEdges(line_t *const f, line_t *const g);
+
+    /**
+     * Calculates the angle between the car heading and the
+     * point the edges of the track meet at
+     *
+     * @param data the cone data to perform calculations on
+     * @param fast whether to use getAngleFast instead of
+     * getAngle
+     * @return an angle between -180 and +180
+     */
+    _Float32 getSteeringAngle(const pos_api::data_t data, bool fast);
+
+    /**
+     * Maps an angle to a steering value. Angles up to
+     * zeroThreshold map to zero, angles from maxThreshold
+     * on map to MAX_ABS_STEERING_VAL, and angles in
+     * between are interpolated linearly.
+     *
+     * @param angle the angle to map
+     * @return a steering angle value between -MAX_ABS_STEERING_VAL
+     * and MAX_ABS_STEERING_VAL
+     */
+    _Float32 mapAngle(const _Float32 angle);
+
+    /**
+     * Calculates the steering angle value based on the
+     * data passed
+     *
+     * @param data the cone data to perform calculations on
+     * @return a steering angle value between -MAX_ABS_STEERING_VAL
+     * and MAX_ABS_STEERING_VAL
+     */
+    _Float32 calculateSteering(const pos_api::data_t data);
+
+    /**
+     * Does the same as calculateSteering, using getAngleFast.
+     * The mapping is a few comparisons and one division, which
+     * a table doesn't beat, so mapAngle is used as it is
+     *
+     * @param data the cone data to perform calculations on
+     * @return a steering angle value between -MAX_ABS_STEERING_VAL
+     * and MAX_ABS_STEERING_VAL
+     */
+    _Float32 calculateSteeringFast(const pos_api::data_t data);
+
+    /**
+     * Gets the origin of the car heading derived by configure()
+     *
+     * @return the origin of the car heading
+     */
+    point_t getOrigin();
+} // !namespace ang_calc
+
+#endif // !DIT639_2023_GROUP_13_STEERING_HPP
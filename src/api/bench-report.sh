@@ -0,0 +1,36 @@
+#! /usr/bin/sh
+# Compares the JSON results of a benchmark from two builds, e.g. before and after
+# profile-guided optimisation, with the change in ns/op of every benchmark.
+#
+# Usage: sh bench-report.sh <before.json> <after.json>
+
+if [ $# -ne 2 ]; then
+    echo "Usage: sh $0 <before.json> <after.json>" >&2
+    exit 1
+fi
+
+awk '
+    # The value of a field of a benchmark line of the JSON
+    function field(line, key,    rest) {
+        rest = substr(line, index(line, "\"" key "\":") + length(key) + 3)
+        sub(/^"/, "", rest)
+        sub(/["},].*$/, "", rest)
+        return rest
+    }
+    /"ns_per_op"/ {
+        if (FNR == NR) {
+            before[field($0, "name")] = field($0, "ns_per_op")
+        } else {
+            names[++count] = field($0, "name")
+            after[names[count]] = field($0, "ns_per_op")
+        }
+    }
+    END {
+        printf "%-40s %12s %12s %9s\n", "benchmark", "before ns/op", "after ns/op", "change"
+        for (i = 1; i <= count; i++) {
+            name = names[i]
+            if (!(name in before)) continue
+            printf "%-40s %12.2f %12.2f %+8.1f%%\n", name, before[name], after[name], (after[name] - before[name]) * 100 / before[name]
+        }
+    }
+' "$1" "$2"
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "bench.hpp"
+
+#include <iomanip>
+
+// Where consume() puts its values
+volatile float sink;
+
+void bench::consume(float val)
+{
+    sink = val;
+}
+
+void bench::print(const bench::result_t &result, std::ostream &out)
+{
+    out << std::left << std::setw(32) << result.name << std::right
+        << std::fixed << std::setprecision(2)
+        << std::setw(12) << result.nsPerOp << " ns/op"
+        << std::setw(16) << std::setprecision(0) << result.opsPerSec << " op/s"
+        << std::defaultfloat << std::endl;
+}
+
+void bench::printJson(const std::vector<bench::result_t> &results, std::ostream &out)
+{
+    bench::printJson(results, {}, out);
+}
+
+void bench::printJson(const std::vector<bench::result_t> &results, const std::vector<bench::metric_t> &metrics, std::ostream &out)
+{
+    out << "{\"benchmarks\":[" << std::endl;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const bench::result_t &r = results[i];
+        out << "  {\"name\":\"" << r.name << "\",\"ops\":" << r.ops
+            << ",\"ns_per_op\":" << r.nsPerOp
+            << ",\"ops_per_sec\":" << r.opsPerSec << "}"
+            << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    out << "]";
+    if (!metrics.empty())
+    {
+        out << ",\"metrics\":[" << std::endl;
+        for (size_t i = 0; i < metrics.size(); i++)
+        {
+            out << "  {\"name\":\"" << metrics[i].name << "\",\"value\":" << metrics[i].value << "}"
+                << (i + 1 < metrics.size() ? "," : "") << std::endl;
+        }
+        out << "]";
+    }
+    out << "}" << std::endl;
+}
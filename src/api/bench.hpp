@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_BENCH_HPP
+#define DIT639_2023_GROUP_13_BENCH_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * Helpers shared by the microbenchmarks of the microservices.
+ *
+ * A benchmark times a function over a fixed number of
+ * operations and reports nanoseconds per operation and
+ * operations per second, both readable and as JSON so
+ * results of two builds can be diffed.
+ */
+namespace bench {
+
+    /**
+     * The result of one benchmark
+     *
+     * @param name the name of the benchmark
+     * @param ops the number of operations that were timed
+     * @param nsPerOp the mean time per operation in nanoseconds
+     * @param opsPerSec the number of operations per second
+     */
+    struct result_t {
+        std::string name;
+        uint64_t ops;
+        double nsPerOp;
+        double opsPerSec;
+    };
+
+    /**
+     * A value measured by a benchmark that isn't a time,
+     * e.g. an accuracy or a number of allocations
+     *
+     * @param name the name of the value
+     * @param value the value
+     */
+    struct metric_t {
+        std::string name;
+        double value;
+    };
+
+    /**
+     * Consumes a value so that the compiler can't optimise
+     * away the computation that produced it
+     *
+     * @param val the value to consume
+     */
+    void consume(float val);
+
+    /**
+     * Times a function over a number of operations. The
+     * function is called once per operation with the index
+     * of the operation, after an untimed warm-up pass over
+     * the first tenth of the operations.
+     *
+     * @param name the name of the benchmark
+     * @param ops the number of operations to time
+     * @param fn the function to time, called as fn(i)
+     * @return the result of the benchmark
+     */
+    template <typename F>
+    result_t measure(const std::string &name, uint64_t ops, F fn)
+    {
+        for (uint64_t i = 0; i < ops / 10; i++)
+        {
+            fn(i);
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < ops; i++)
+        {
+            fn(i);
+        }
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        return {name, ops, ns / (double) ops, (double) ops * 1e9 / ns};
+    }
+
+    /**
+     * Prints the result of a benchmark in a readable form
+     *
+     * @param result the result to print
+     * @param out the stream to print to
+     */
+    void print(const result_t &result, std::ostream &out);
+
+    /**
+     * Prints results as a JSON document
+     *
+     * @param results the results to print
+     * @param out the stream to print to
+     */
+    void printJson(const std::vector<result_t> &results, std::ostream &out);
+
+    /**
+     * Prints results and other measured values as a JSON document
+     *
+     * @param results the results to print
+     * @param metrics the other values to print
+     * @param out the stream to print to
+     */
+    void printJson(const std::vector<result_t> &results, const std::vector<metric_t> &metrics, std::ostream &out);
+} // !namespace bench
+
+#endif // !DIT639_2023_GROUP_13_BENCH_HPP
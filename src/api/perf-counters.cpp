@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "perf-counters.hpp"
+
+// For perf_event_open, which glibc has no wrapper for
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * The group of the counters as read, with PERF_FORMAT_GROUP,
+ * PERF_FORMAT_TOTAL_TIME_ENABLED and PERF_FORMAT_TOTAL_TIME_RUNNING
+ *
+ * @param count the number of counters of the group
+ * @param enabled the nanoseconds the group was enabled
+ * @param running the nanoseconds the group was on the PMU
+ * @param values the values, in the order the counters were opened
+ */
+struct group_read_t {
+    uint64_t count;
+    uint64_t enabled;
+    uint64_t running;
+    uint64_t values[perf_counters::COUNTER_COUNT];
+};
+
+// The type and configuration of every counter, in the order of Counter
+const uint32_t COUNTER_TYPES[perf_counters::COUNTER_COUNT] = {
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HW_CACHE
+};
+const uint64_t COUNTER_CONFIGS[perf_counters::COUNTER_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+};
+
+void perf_counters::accumulate(perf_counters::counts_t &sum, const perf_counters::counts_t &start, const perf_counters::counts_t &end)
+{
+    for (int32_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        sum.values[i] += end.values[i] - start.values[i];
+    }
+}
+
+perf_counters::Counters::Counters()
+    : m_fds(), m_slots(), m_opened(0)
+{
+    // The first counter that opens leads the group
+    int leader = -1;
+    for (int32_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = COUNTER_TYPES[i];
+        attr.config = COUNTER_CONFIGS[i];
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.disabled = leader < 0 ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        m_fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        m_slots[i] = -1;
+        if (m_fds[i] >= 0)
+        {
+            m_slots[i] = m_opened++;
+            if (leader < 0)
+            {
+                leader = m_fds[i];
+            }
+        }
+    }
+
+    if (leader >= 0)
+    {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+perf_counters::Counters::~Counters()
+{
+    // The leader goes last, as the group goes with it
+    for (int32_t i = COUNTER_COUNT - 1; i >= 0; i--)
+    {
+        if (m_fds[i] >= 0)
+        {
+            close(m_fds[i]);
+        }
+    }
+}
+
+bool perf_counters::Counters::available(perf_counters::Counter counter) const
+{
+    return m_fds[counter] >= 0;
+}
+
+bool perf_counters::Counters::any() const
+{
+    return m_opened > 0;
+}
+
+perf_counters::counts_t perf_counters::Counters::read() const
+{
+    counts_t counts{};
+    if (m_opened == 0)
+    {
+        return counts;
+    }
+
+    // Reading the leader reads the whole group
+    int leader = -1;
+    for (int32_t i = 0; i < COUNTER_COUNT && leader < 0; i++)
+    {
+        leader = m_fds[i];
+    }
+    group_read_t group{};
+    if (::read(leader, &group, sizeof(group)) <= 0 || group.count != (uint64_t) m_opened)
+    {
+        return counts;
+    }
+
+    for (int32_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        if (m_slots[i] < 0) continue;
+
+        uint64_t value = group.values[m_slots[i]];
+        if (group.running > 0 && group.running < group.enabled)
+        {
+            value = (uint64_t) ((double) value * (double) group.enabled / (double) group.running);
+        }
+        counts.values[i] = value;
+    }
+    return counts;
+}
+
+void perf_counters::Counters::print(const std::string &name, const perf_counters::counts_t &counts, uint64_t passes, std::ostream &out) const
+{
+    out << name << ":";
+    if (m_opened == 0 || passes == 0)
+    {
+        out << " not counted" << std::endl;
+        return;
+    }
+    for (int32_t i = 0; i < COUNTER_COUNT; i++)
+    {
+        if (m_slots[i] < 0) continue;
+        out << " " << COUNTER_NAMES[i] << " " << (double) counts.values[i] / (double) passes;
+    }
+    if (available(CYCLES) && available(INSTRUCTIONS) && counts.values[CYCLES] > 0)
+    {
+        out << " ipc " << (double) counts.values[INSTRUCTIONS] / (double) counts.values[CYCLES];
+    }
+    out << std::endl;
+}
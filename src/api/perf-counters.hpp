@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_PERF_COUNTERS_HPP
+#define DIT639_2023_GROUP_13_PERF_COUNTERS_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+
+#include <iostream>
+#include <string>
+
+/*
+ * The hardware performance counters of the CPU, read through
+ * perf_event_open, to tell whether a stage is bound by memory
+ * or by computation, which the time alone doesn't.
+ *
+ * The counters count the thread that opened them, in user
+ * space only. Containers usually can't open them (Docker's
+ * seccomp profile blocks perf_event_open), and neither can
+ * VMs without a virtual PMU, in which case the counters that
+ * couldn't be opened are left out and read as 0, so the code
+ * that reads them runs the same either way.
+ *
+ * The API includes:
+ * - Counter:    the counters
+ *
+ * - counts_t:   the values of the counters
+ *
+ * - accumulate: adds the counts between two reads
+ *
+ * - Counters:   the counters of the calling thread
+ */
+namespace perf_counters {
+
+    /*
+     * The counters
+     */
+    enum Counter {
+        // The cycles of the core
+        CYCLES,
+
+        // The instructions that were retired
+        INSTRUCTIONS,
+
+        // The references that missed the last level cache
+        CACHE_MISSES,
+
+        // The branches that were mispredicted
+        BRANCH_MISSES,
+
+        // The reads that missed the data TLB
+        DTLB_MISSES,
+
+        // The number of counters
+        COUNTER_COUNT
+    };
+
+    // The names of the counters, in the order of Counter
+    const char *const COUNTER_NAMES[COUNTER_COUNT] = {
+        "cycles",
+        "instructions",
+        "cache_misses",
+        "branch_misses",
+        "dtlb_misses"
+    };
+
+    /**
+     * The values of the counters
+     *
+     * @param values the value of every counter, by Counter
+     */
+    struct counts_t {
+        uint64_t values[COUNTER_COUNT];
+    };
+
+    /**
+     * Adds the counts between two reads of the counters
+     *
+     * @param sum the counts to add to
+     * @param start the counts of the first read
+     * @param end the counts of the second read
+     */
+    void accumulate(counts_t &sum, const counts_t &start, const counts_t &end);
+
+    /*
+     * The counters of the calling thread, opened as one group so
+     * that all of them are read with one system call and count
+     * the same instructions
+     */
+    class Counters {
+       public:
+        /**
+         * Opens and starts the counters of the calling thread.
+         * The ones that can't be opened are left out
+         */
+        Counters();
+        ~Counters();
+
+        Counters(const Counters &) = delete;
+        Counters &operator=(const Counters &) = delete;
+
+        /**
+         * Checks whether a counter could be opened
+         *
+         * @param counter the counter
+         * @return whether it's counted
+         */
+        bool available(Counter counter) const;
+
+        /**
+         * Checks whether any counter could be opened
+         *
+         * @return whether anything is counted
+         */
+        bool any() const;
+
+        /**
+         * Reads the counters. The counts are scaled up by the
+         * share of the time the kernel had them on the PMU,
+         * if it had to share it with other counters
+         *
+         * @return the counts since the counters were opened,
+         * 0 for the ones that aren't counted
+         */
+        counts_t read() const;
+
+        /**
+         * Prints the mean of some counts per pass, of the
+         * counters that are counted, with the instructions
+         * per cycle if both are
+         *
+         * @param name the name of what was counted
+         * @param counts the summed counts
+         * @param passes the number of passes they're summed over
+         * @param out the stream to print to
+         */
+        void print(const std::string &name, const counts_t &counts, uint64_t passes, std::ostream &out) const;
+
+       private:
+        // The file descriptors of the counters, -1 if not counted
+        int m_fds[COUNTER_COUNT];
+        // The position of every counter in the group, in the order
+        // they were opened, which is the order they're read in
+        int32_t m_slots[COUNTER_COUNT];
+        int32_t m_opened;
+    };
+} // !namespace perf_counters
+
+#endif // !DIT639_2023_GROUP_13_PERF_COUNTERS_HPP
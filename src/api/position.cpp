@@ -20,117 +20,74 @@
 // The header to implement
 #include "position.hpp"
 
-// Name of the shared memory region
-#define MEM_NAME "position"
-
-// The shared memory "singleton" that is used
-cluon::SharedMemory *mem;
-// Boolean to keep track of whether the shared memory
-// has been instantiated 
-bool created = false;
-// Boolean to keep track of whether the shared memory
-// is a producer or not
-bool producer = false;
-
-void pos_api::create()
-{
-    // Throw exception if the API already has been created
-    if (created)
-    {
-        throw pos_api::APIException::CREATED;
-    }
+// The channel of the functions, nullptr until one is created
+// or attached to
+pos_api::Channel *channel = nullptr;
 
-    // Throw exception if the API has been created elsewhere
-    mem = new cluon::SharedMemory(MEM_NAME);
-    if (mem->valid())
-    {
-        throw pos_api::APIException::CREATED;
-    }
-    // Free the test memory
-    free(mem);
-
-    // Instantiate a shared memory for the API
-    mem = new cluon::SharedMemory(MEM_NAME, sizeof (data_t));
-    created = true;
-    producer = true;
-    std::clog << "Created shared memory " << mem->name() << " (" << mem->size() << " bytes)." << std::endl;
-}
-
-void pos_api::attach()
+pos_api::Channel::Channel(const std::string &name, bool producer)
+    : m_name(name), m_mem(nullptr), m_producer(producer)
 {
-    // Throw exception if the API already has been created
-    if (created)
+    if (producer)
     {
-        throw pos_api::APIException::CREATED;
-    }
-
-    // Attach to an existing API if it exists
-    mem = new cluon::SharedMemory(MEM_NAME);
+        // Throw exception if the channel has been created elsewhere
+        cluon::SharedMemory existing(name);
+        if (existing.valid())
+        {
+            throw pos_api::APIException::CREATED;
+        }
 
-    // Throw exception if unable to attach
-    if (!mem->valid())
-    {
-        throw pos_api::APIException::EMPTY;
+        // Instantiate a shared memory for the channel
+        m_mem = new cluon::SharedMemory(name, sizeof (data_t));
+        std::clog << "Created shared memory " << m_mem->name() << " (" << m_mem->size() << " bytes)." << std::endl;
     }
-
-    created = true;
-    std::clog << "Attached to shared memory " << mem->name() << " (" << mem->size() << " bytes)." << std::endl;
-}
-
-void pos_api::clear()
-{
-    // Clear only if created
-    if (created)
+    else
     {
-        // Destruct if the application is the producer
-        if (producer) {
-            mem->~SharedMemory();
+        // Attach to an existing channel if it exists
+        m_mem = new cluon::SharedMemory(name);
+
+        // Throw exception if unable to attach
+        if (!m_mem->valid())
+        {
+            delete m_mem;
+            throw pos_api::APIException::EMPTY;
         }
-        // Free the dynamically allocated memory
-        free((void *) mem);
-        created = false;
-        producer = false;
+        std::clog << "Attached to shared memory " << m_mem->name() << " (" << m_mem->size() << " bytes)." << std::endl;
     }
 }
 
-void pos_api::put(pos_api::data_t data)
+pos_api::Channel::~Channel()
 {
-    // Throw exception if there is no API to interact with
-    if (!created)
-    {
-        throw pos_api::APIException::EMPTY;
-    }
+    // The producer's shared memory is destroyed with it,
+    // a consumer only detaches
+    delete m_mem;
+}
 
+void pos_api::Channel::put(pos_api::data_t data)
+{
     // Throw exception if not producer
     // Only the producer is allowed to put data
-    if (!producer)
+    if (!m_producer)
     {
         throw pos_api::APIException::IS_CONSUMER;
     }
 
     // Get exclusive access to the shared memory
-    mem->lock();
+    m_mem->lock();
     {
         // Copy the data that was provided
         // into the shared memory
-        pos_api::data_t *d = (pos_api::data_t *) mem->data();
+        pos_api::data_t *d = (pos_api::data_t *) m_mem->data();
         // memcpy because &pos_api::data_t::operator=
         // is a deleted function(???)
         memcpy(d, &data, sizeof (pos_api::data_t));
     }
     // Unlock the memory and notify all consumers
-    mem->unlock();
-    mem->notifyAll();
+    m_mem->unlock();
+    m_mem->notifyAll();
 }
 
-pos_api::data_t pos_api::get()
+pos_api::data_t pos_api::Channel::get()
 {
-    // Throw exception if there is no API to interact with
-    if (!created)
-    {
-        throw pos_api::APIException::EMPTY;
-    }
-
     // The data read from the shared memory
     pos_api::data_t d{};
 
@@ -138,20 +95,88 @@ pos_api::data_t pos_api::get()
     // struct doesn't have a default constructor(???)
 
     // Wait for an update
-    mem->wait();
+    m_mem->wait();
     // Get exclusive access to the shared memory
-    mem->lock();
+    m_mem->lock();
     {
         // Copy the data from the shared memory
         // memcpy because &pos_api::data_t::operator=
         // is a deleted function(???)
-        memcpy(&d, mem->data(), sizeof (pos_api::data_t));
+        memcpy(&d, m_mem->data(), sizeof (pos_api::data_t));
     }
     // Unlock the shared memory
-    mem->unlock();
+    m_mem->unlock();
     return d;
 }
 
+void pos_api::Channel::wake()
+{
+    m_mem->notifyAll();
+}
+
+const std::string &pos_api::Channel::name() const
+{
+    return m_name;
+}
+
+void pos_api::create(const std::string &name)
+{
+    // Throw exception if the API already has been created
+    if (channel != nullptr)
+    {
+        throw pos_api::APIException::CREATED;
+    }
+    channel = new pos_api::Channel(name, true);
+}
+
+void pos_api::attach(const std::string &name)
+{
+    // Throw exception if the API already has been created
+    if (channel != nullptr)
+    {
+        throw pos_api::APIException::CREATED;
+    }
+    channel = new pos_api::Channel(name, false);
+}
+
+void pos_api::clear()
+{
+    // Destroys the shared memory if this is its producer,
+    // nothing is deleted if the API wasn't created
+    delete channel;
+    channel = nullptr;
+}
+
+void pos_api::put(pos_api::data_t data)
+{
+    // Throw exception if there is no API to interact with
+    if (channel == nullptr)
+    {
+        throw pos_api::APIException::EMPTY;
+    }
+    channel->put(data);
+}
+
+pos_api::data_t pos_api::get()
+{
+    // Throw exception if there is no API to interact with
+    if (channel == nullptr)
+    {
+        throw pos_api::APIException::EMPTY;
+    }
+    return channel->get();
+}
+
+void pos_api::wake()
+{
+    // Throw exception if there is no API to interact with
+    if (channel == nullptr)
+    {
+        throw pos_api::APIException::EMPTY;
+    }
+    channel->wake();
+}
+
 bool pos_api::isEqual(const pos_api::cone_t c1, const pos_api::cone_t c2)
 {
     return c1.posX == c2.posX && c1.posY == c2.posY;
@@ -21,6 +21,8 @@
 // Include the standard int types of C
 #include <cstdint>
 
+#include <string>
+
 // Include cluon to create a wrapper for the shared memory
 #include "../cone-detection/cluon-complete-v0.0.127.hpp"
 
@@ -47,6 +49,10 @@
  *                 represent exceptions related to
  *                 the API
  * 
+ * - Channel:      a class for one shared memory of
+ *                 the API, for a producer that puts
+ *                 the cones of several cameras
+ * 
  * - create:       a function that initiates the API
  * 
  * - attach:       a function that attaches to an
@@ -58,6 +64,8 @@
  * 
  * - get:          reads data from the shared memory
  * 
+ * - wake:         wakes the consumers without data
+ * 
  * Author: Bao Quan Lindgren (2023)
  */
 namespace pos_api {
@@ -143,27 +151,97 @@ namespace pos_api {
         EMPTY
     };
 
+    // The name of the shared memory used unless another
+    // channel is given, the one of the first camera
+    const std::string DEFAULT_CHANNEL{"position"};
+
+    /*
+     * One channel of the API, i.e. one shared memory region
+     * that one producer puts the cones of one camera into.
+     * The functions below use a single channel of their own,
+     * a producer of several cameras creates a Channel for
+     * each of them instead
+     */
+    class Channel {
+       public:
+        /**
+         * Creates the shared memory region of a channel, or
+         * attaches to it
+         * 
+         * @param name the name of the shared memory region
+         * @param producer whether to create the region, or
+         * to attach to one that a producer has created
+         * @throws APIException::CREATED if a producer's region
+         * has already been created elsewhere
+         * @throws APIException::EMPTY if there is no region for
+         * a consumer to attach to
+         */
+        Channel(const std::string &name, bool producer);
+
+        /**
+         * Destroys the shared memory region if this is its
+         * producer, or detaches from it
+         */
+        ~Channel();
+
+        Channel(const Channel &) = delete;
+        Channel &operator=(const Channel &) = delete;
+
+        /**
+         * Writes data to the shared memory for consumers to read
+         * 
+         * @param data the data to write into the shared memory
+         * @throws APIException::IS_CONSUMER if this is a consumer
+         */
+        void put(data_t data);
+
+        /**
+         * Waits for a producer to write data and reads it
+         * 
+         * @returns the cone data from a producer
+         */
+        data_t get();
+
+        /**
+         * Wakes the consumers waiting for data without writing
+         * any, which read the last data again
+         */
+        void wake();
+
+        /**
+         * @returns the name of the shared memory region
+         */
+        const std::string &name() const;
+
+       private:
+        std::string m_name;
+        cluon::SharedMemory *m_mem;
+        bool m_producer;
+    };
+
     /**
      * Instantiates a shared memory region to act as
      * an API for communication regarding cone position
      * 
      * Only 1 producer can be created at any given time
      * 
+     * @param channel the name of the shared memory region
      * @throws APIException::CREATED if an API has already
      * been instansiated
      */
-    void create();
+    void create(const std::string &channel = DEFAULT_CHANNEL);
 
     /**
      * Attaches to a shared memory region for communication
      * regarding cone position
      * 
+     * @param channel the name of the shared memory region
      * @throws APIException::CREATED if an API has already
      * been instansiated
      * @throws APIException::EMPTY if the is no API to
      * attach to
      */
-    void attach();
+    void attach(const std::string &channel = DEFAULT_CHANNEL);
 
     /**
      * Cleans up after the API by destroying the shared
@@ -187,6 +265,15 @@ namespace pos_api {
      */
     data_t get();
 
+    /**
+     * Wakes the consumers waiting for data without writing
+     * any, e.g. for the one of this process to notice that
+     * it's to stop. They read the last data again
+     * 
+     * @throws APIException::EMPTY if there is no API to wake
+     */
+    void wake();
+
     /**
      * Checks if two cones are equal in terms of position
      * 
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "realtime.hpp"
+
+// For pthread_setaffinity_np and pthread_setschedparam
+#include <pthread.h>
+#include <sched.h>
+// For mlockall
+#include <sys/mman.h>
+// For getrusage, of RUSAGE_THREAD
+#include <sys/resource.h>
+
+// The bytes of stack that are faulted in, more than a frame takes
+#define STACK_PREFAULT (512 * 1024)
+
+// Whether the steady state of the thread has started
+thread_local bool steadyStarted = false;
+// The page faults of the thread when its steady state started
+thread_local struct rusage steadyUsage;
+
+/**
+ * Writes to every page of a block of the stack, so that the stack
+ * of the calling thread is faulted in down to that depth. It must
+ * not be inlined, or the block would be in the caller's frame
+ */
+__attribute__((noinline)) void prefaultStack()
+{
+    volatile uint8_t block[STACK_PREFAULT];
+    for (uint32_t i = 0; i < STACK_PREFAULT; i += 4096)
+    {
+        block[i] = 0;
+    }
+    // Read back, so the writes aren't reported as unused
+    (void) block[0];
+}
+
+void realtime::pin(int32_t core)
+{
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    if (core < 0 || core >= CPU_SETSIZE)
+    {
+        throw realtime::RealtimeException::CORE;
+    }
+    CPU_SET(core, &cores);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores) != 0)
+    {
+        throw realtime::RealtimeException::CORE;
+    }
+}
+
+void realtime::enter(const realtime::config_t &config)
+{
+    if (config.core >= 0)
+    {
+        realtime::pin(config.core);
+    }
+
+    sched_param param{};
+    param.sched_priority = config.priority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+    {
+        throw realtime::RealtimeException::SCHEDULER;
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+    {
+        throw realtime::RealtimeException::MEMORY;
+    }
+    prefaultStack();
+}
+
+void realtime::markSteady()
+{
+    if (!steadyStarted)
+    {
+        getrusage(RUSAGE_THREAD, &steadyUsage);
+        steadyStarted = true;
+    }
+}
+
+realtime::faults_t realtime::faults()
+{
+    if (!steadyStarted)
+    {
+        return {false, 0, 0};
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return {true, usage.ru_majflt - steadyUsage.ru_majflt, usage.ru_minflt - steadyUsage.ru_minflt};
+}
+
+void realtime::printFaults(const realtime::faults_t &faults, std::ostream &out)
+{
+    if (!faults.steady)
+    {
+        out << "No page faults counted, the steady state wasn't reached" << std::endl;
+        return;
+    }
+    out << "Page faults of the pipeline thread in the steady state: " << faults.major << " major, "
+        << faults.minor << " minor" << std::endl;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_REALTIME_HPP
+#define DIT639_2023_GROUP_13_REALTIME_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+
+#include <iostream>
+
+/*
+ * The real-time mode of the microservices, which keeps the
+ * scheduler and page faults out of the latency of a frame.
+ *
+ * The thread that runs the pipeline is pinned to a core and
+ * scheduled with SCHED_FIFO, so no time-shared thread can
+ * preempt it, and all memory of the process is locked into
+ * RAM. Locking it faults in everything that is mapped at the
+ * time, i.e. the frame buffers and shared memory segments,
+ * and everything that's mapped later as it's mapped, so a
+ * frame should never wait for a page. The page faults of
+ * the pipeline thread in the steady state are counted to
+ * check that it doesn't, apart from the faults of any other
+ * thread of the process.
+ *
+ * The API includes:
+ * - config_t:          the core and priority to run with
+ *
+ * - faults_t:          the page faults of a thread in the
+ *                      steady state
+ *
+ * - RealtimeException: the parts of the mode that can't
+ *                      be entered
+ *
+ * - pin:               a function that pins the calling
+ *                      thread to a core
+ *
+ * - enter:             a function that puts the calling
+ *                      thread and the process into the mode
+ *
+ * - markSteady:        a function that marks the start of
+ *                      the steady state of the calling thread
+ *
+ * - faults:            a function that gets the page faults
+ *                      of the calling thread's steady state
+ *
+ * - printFaults:       prints the page faults of a steady
+ *                      state
+ */
+namespace realtime {
+
+    /**
+     * The configuration of the real-time mode
+     *
+     * @param core the core to pin the thread to, or -1 to
+     * leave it on any core
+     * @param priority the SCHED_FIFO priority, from 1 to 99
+     */
+    struct config_t {
+        int32_t core;
+        int32_t priority;
+    };
+
+    /**
+     * The page faults of a thread since its steady state started
+     *
+     * @param steady whether the steady state was reached
+     * @param major the major page faults
+     * @param minor the minor page faults
+     */
+    struct faults_t {
+        bool steady;
+        int64_t major;
+        int64_t minor;
+    };
+
+    // The priority the pipeline runs with, unless configured
+    const int32_t DEFAULT_PRIORITY{50};
+
+    /*
+     * The parts of the real-time mode that can fail. SCHED_FIFO
+     * and locking the memory need the CAP_SYS_NICE and
+     * CAP_IPC_LOCK capabilities or high enough rtprio and
+     * memlock limits, e.g. `docker run --cap-add=SYS_NICE
+     * --ulimit rtprio=99 --ulimit memlock=-1`
+     */
+    enum RealtimeException {
+        // The thread couldn't be pinned to the core
+        CORE,
+
+        // The thread couldn't be scheduled with SCHED_FIFO
+        SCHEDULER,
+
+        // The memory of the process couldn't be locked
+        MEMORY
+    };
+
+    /**
+     * Pins the calling thread to a core, without the rest of
+     * the mode, e.g. to keep the threads of several pipelines
+     * on cores of their own
+     *
+     * @param core the core to pin the thread to
+     * @throws RealtimeException::CORE if it couldn't be pinned
+     */
+    void pin(int32_t core);
+
+    /**
+     * Pins the calling thread to the configured core, schedules
+     * it with SCHED_FIFO, locks all current and future memory of
+     * the process and prefaults the stack of the thread. Threads
+     * that the calling thread starts afterwards inherit its core
+     * and scheduling, so it should be called once everything else
+     * has been started and allocated, right before the loop.
+     *
+     * @param config the core and priority to run with
+     * @throws RealtimeException for the first part that failed
+     */
+    void enter(const config_t &config);
+
+    /**
+     * Marks the start of the steady state of the calling thread,
+     * from where on its page faults are counted. Only the first
+     * call of a thread counts, so it can be called after every
+     * frame, as the first frame may still allocate
+     */
+    void markSteady();
+
+    /**
+     * Gets the major and minor page faults of the calling thread
+     * since it marked its steady state. The faults of the other
+     * threads of the process aren't counted
+     *
+     * @return the page faults of the calling thread
+     */
+    faults_t faults();
+
+    /**
+     * Prints the major and minor page faults of a pipeline's
+     * thread in its steady state
+     *
+     * @param faults the page faults of the thread
+     * @param out the stream to print to
+     */
+    void printFaults(const faults_t &faults, std::ostream &out);
+} // !namespace realtime
+
+#endif // !DIT639_2023_GROUP_13_REALTIME_HPP
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "shared-segment.hpp"
+
+#include <cstring>
+
+// For the POSIX shared memory
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// How many times a reader tries to copy the contents before giving up
+#define READ_ATTEMPTS 64
+
+/**
+ * Gets the path of a segment for shm_open
+ *
+ * @param name the name of the segment, in /dev/shm
+ * @return the path
+ */
+std::string segmentPath(const std::string &name)
+{
+    return "/" + name;
+}
+
+uint8_t *shared_segment::create(const std::string &name, size_t size)
+{
+    int fd = shm_open(segmentPath(name).c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        throw shared_segment::SegmentException::CREATE;
+    }
+    void *data = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+    {
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        shm_unlink(segmentPath(name).c_str());
+        throw shared_segment::SegmentException::CREATE;
+    }
+    return static_cast<uint8_t *>(data);
+}
+
+const uint8_t *shared_segment::attach(const std::string &name, size_t size)
+{
+    int fd = shm_open(segmentPath(name).c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        throw shared_segment::SegmentException::ATTACH;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) != size)
+    {
+        close(fd);
+        throw shared_segment::SegmentException::SIZE;
+    }
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        throw shared_segment::SegmentException::ATTACH;
+    }
+    return static_cast<const uint8_t *>(data);
+}
+
+void shared_segment::unmap(const uint8_t *data, size_t size)
+{
+    munmap(const_cast<uint8_t *>(data), size);
+}
+
+void shared_segment::unlink(const std::string &name)
+{
+    shm_unlink(segmentPath(name).c_str());
+}
+
+uint32_t shared_segment::beginWrite(std::atomic<uint32_t> &sequence)
+{
+    uint32_t before = sequence.load(std::memory_order_relaxed);
+    sequence.store(before + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return before;
+}
+
+void shared_segment::endWrite(std::atomic<uint32_t> &sequence, uint32_t before)
+{
+    sequence.store(before + 2, std::memory_order_release);
+}
+
+bool shared_segment::read(const std::atomic<uint32_t> &sequence, const void *data, void *copy, size_t size)
+{
+    for (int32_t attempt = 0; attempt < READ_ATTEMPTS; attempt++)
+    {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            sched_yield();
+            continue;
+        }
+
+        // The copy may be torn, in which case the sequence changed
+        std::memcpy(copy, data, size);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+        {
+            return true;
+        }
+    }
+    return false;
+}
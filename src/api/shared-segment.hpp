@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_SHARED_SEGMENT_HPP
+#define DIT639_2023_GROUP_13_SHARED_SEGMENT_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+#include <cstddef>
+
+#include <atomic>
+#include <string>
+
+/*
+ * Named POSIX shared memory segments that one process writes and
+ * others map read-only, which cluon's shared memory can't do, and
+ * the sequence lock their contents are written and copied under.
+ *
+ * The writer makes the sequence odd, writes, and makes it even
+ * again. Readers copy the contents and retry if the sequence was
+ * odd or changed meanwhile, so the writer never waits for them
+ * and they never write to the segment.
+ *
+ * The API includes:
+ * - SegmentException: exceptions related to the segments
+ *
+ * - create:           creates a segment, mapped read-write
+ *
+ * - attach:           maps another process' segment read-only
+ *
+ * - unmap:            unmaps a segment
+ *
+ * - unlink:           removes the name of a segment
+ *
+ * - beginWrite:       makes a sequence odd before writing
+ *
+ * - endWrite:         makes a sequence even after writing
+ *
+ * - read:             copies contents under a sequence
+ */
+namespace shared_segment {
+
+    /*
+     * Exception enumerations tied to the segments
+     */
+    enum SegmentException {
+        /*
+         * An exception that is thrown when a segment can't be
+         * created and mapped
+         */
+        CREATE,
+
+        /*
+         * An exception that is thrown when there is no segment
+         * to attach to, or it can't be mapped
+         */
+        ATTACH,
+
+        /*
+         * An exception that is thrown when a segment is of
+         * another size, so it's laid out differently
+         */
+        SIZE
+    };
+
+    /**
+     * Creates a segment and maps it read-write. A segment left
+     * behind by a process that wrote one of the same name is
+     * taken over, with whatever it wrote still in it
+     *
+     * @param name the name of the segment, in /dev/shm
+     * @param size the size of the segment in bytes
+     * @return the first byte of the segment
+     * @throws SegmentException::CREATE if it can't be created
+     */
+    uint8_t *create(const std::string &name, size_t size);
+
+    /**
+     * Maps another process' segment read-only
+     *
+     * @param name the name of the segment, in /dev/shm
+     * @param size the size the segment has to be, in bytes
+     * @return the first byte of the segment
+     * @throws SegmentException::ATTACH if there is none
+     * @throws SegmentException::SIZE if it's of another size
+     */
+    const uint8_t *attach(const std::string &name, size_t size);
+
+    /**
+     * Unmaps a segment that was created or attached to
+     *
+     * @param data the first byte of the segment
+     * @param size the size of the segment in bytes
+     */
+    void unmap(const uint8_t *data, size_t size);
+
+    /**
+     * Removes the name of a segment, so no more processes can
+     * attach to it. The ones that did keep their mapping
+     *
+     * @param name the name of the segment, in /dev/shm
+     */
+    void unlink(const std::string &name);
+
+    /**
+     * Makes a sequence odd before the contents it guards are
+     * written. Only one thread may write under a sequence
+     *
+     * @param sequence the sequence
+     * @return the sequence before, to hand to endWrite
+     */
+    uint32_t beginWrite(std::atomic<uint32_t> &sequence);
+
+    /**
+     * Makes a sequence even again once the contents it guards
+     * are written
+     *
+     * @param sequence the sequence
+     * @param before what beginWrite returned
+     */
+    void endWrite(std::atomic<uint32_t> &sequence, uint32_t before);
+
+    /**
+     * Copies contents guarded by a sequence, a few times over if
+     * they're written meanwhile
+     *
+     * @param sequence the sequence
+     * @param data the contents
+     * @param copy the copy to write to
+     * @param size the size of the contents in bytes
+     * @return whether the contents were copied whole, false if
+     * they kept being written while it was tried
+     */
+    bool read(const std::atomic<uint32_t> &sequence, const void *data, void *copy, size_t size);
+} // !namespace shared_segment
+
+#endif // !DIT639_2023_GROUP_13_SHARED_SEGMENT_HPP
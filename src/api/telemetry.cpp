@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "telemetry.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+// For the CPU time of the process
+#include <time.h>
+#include <unistd.h>
+
+// The segment, which readers map read-only
+#include "shared-segment.hpp"
+
+// The sequence comes first, padded to keep the snapshot 8-byte aligned
+#define SNAPSHOT_OFFSET 8
+#define SEGMENT_SIZE (SNAPSHOT_OFFSET + sizeof(telemetry::snapshot_t))
+
+// How often the CPU time is read, in microseconds
+#define CPU_INTERVAL 100000
+
+/**
+ * Gets the name of a segment in /dev/shm
+ *
+ * @param name the name of the segment, after telemetry::PREFIX
+ * @return the name in /dev/shm
+ */
+std::string segmentName(const std::string &name)
+{
+    return telemetry::PREFIX + name;
+}
+
+uint32_t telemetry::bucket(int64_t micros)
+{
+    // The first four buckets count one microsecond each
+    if (micros < 4)
+    {
+        return micros < 0 ? 0 : (uint32_t) micros;
+    }
+
+    // Then every power of two is split into four buckets,
+    // by the two bits below the highest one
+    uint32_t msb = 63 - (uint32_t) __builtin_clzll((uint64_t) micros);
+    uint32_t b = (msb - 1) * 4 + (uint32_t) ((micros >> (msb - 2)) & 3);
+    return std::min(b, BUCKET_COUNT - 1);
+}
+
+int64_t telemetry::bucketLimit(uint32_t bucket)
+{
+    if (bucket < 4)
+    {
+        return bucket;
+    }
+
+    uint32_t shift = bucket / 4 - 1;
+    int64_t lowest = (int64_t) (4 + bucket % 4) << shift;
+    return lowest + ((int64_t) 1 << shift) - 1;
+}
+
+int64_t telemetry::percentile(const telemetry::stage_t &now, const telemetry::stage_t &before, double fraction)
+{
+    uint64_t passes = now.passes - before.passes;
+    if (passes == 0)
+    {
+        return 0;
+    }
+
+    // The pass the percentile falls on, counting from 1
+    uint64_t target = std::max((uint64_t) ((double) passes * fraction + 0.999999), (uint64_t) 1);
+    uint64_t counted = 0;
+    for (uint32_t b = 0; b < BUCKET_COUNT; b++)
+    {
+        counted += now.buckets[b] - before.buckets[b];
+        if (counted >= target)
+        {
+            // No pass was longer than the longest one
+            return std::min(bucketLimit(b), now.max);
+        }
+    }
+    return now.max;
+}
+
+telemetry::Publisher::Publisher(const std::string &name, const std::string &binary)
+    : m_name(name), m_snapshot(nullptr), m_sequence(nullptr), m_pending(), m_lastTimestamp(0), m_period(0),
+      m_cpuRead(0), m_qosLevel(-1), m_qosName(""), m_qos(), m_removed(false)
+{
+    // A segment left behind by a binary of the same name is taken over
+    uint8_t *data = nullptr;
+    try
+    {
+        data = shared_segment::create(segmentName(name), SEGMENT_SIZE);
+    }
+    catch (const shared_segment::SegmentException &)
+    {
+        throw telemetry::TelemetryException::CREATE;
+    }
+
+    // The sequence stays odd until the snapshot is set up,
+    // so readers don't copy it half-written
+    m_sequence = new (data) std::atomic<uint32_t>{1};
+    m_snapshot = reinterpret_cast<telemetry::snapshot_t *>(data + SNAPSHOT_OFFSET);
+    std::memset(m_snapshot, 0, sizeof(telemetry::snapshot_t));
+    m_snapshot->magic = MAGIC;
+    m_snapshot->version = VERSION;
+    m_snapshot->pid = getpid();
+    m_snapshot->qosLevel = -1;
+    std::strncpy(m_snapshot->binary, binary.c_str(), sizeof(m_snapshot->binary) - 1);
+    m_snapshot->started = trace::now();
+    m_snapshot->updated = m_snapshot->started;
+    m_sequence->store(2, std::memory_order_release);
+
+    std::fill(m_pending, m_pending + trace::STAGE_COUNT, -1);
+}
+
+telemetry::Publisher::~Publisher()
+{
+    remove();
+    shared_segment::unmap(reinterpret_cast<uint8_t *>(m_snapshot) - SNAPSHOT_OFFSET, SEGMENT_SIZE);
+}
+
+void telemetry::Publisher::record(trace::Stage stage, int64_t micros)
+{
+    m_pending[stage] = micros;
+}
+
+void telemetry::Publisher::setQos(int32_t level, const char *name)
+{
+    m_qosLevel = level;
+    m_qosName = name;
+}
+
+void telemetry::Publisher::setQosTime(uint32_t level, const char *name, uint64_t frames, int64_t micros)
+{
+    if (level >= QOS_LEVELS) return;
+
+    telemetry::qos_t &qos = m_qos[level];
+    if (qos.name[0] == '\0')
+    {
+        std::strncpy(qos.name, name, sizeof(qos.name) - 1);
+    }
+    qos.frames = frames;
+    qos.micros = micros;
+}
+
+void telemetry::Publisher::frame(int64_t timestamp, int64_t woke, int64_t done)
+{
+    // A gap of more than one and a half intervals is a frame that never
+    // arrived, otherwise the interval adds to the usual one
+    uint64_t drops = 0;
+    if (m_lastTimestamp != 0 && timestamp > m_lastTimestamp)
+    {
+        int64_t interval = timestamp - m_lastTimestamp;
+        if (m_period > 0 && interval > m_period * 3 / 2)
+        {
+            drops = (uint64_t) ((interval + m_period / 2) / m_period - 1);
+        }
+        else
+        {
+            m_period = m_period == 0 ? interval : (m_period * 7 + interval) / 8;
+        }
+    }
+    m_lastTimestamp = std::max(m_lastTimestamp, timestamp);
+
+    // The frames that arrived while this one was being done
+    uint32_t queued = m_period > 0 ? (uint32_t) std::max((done - woke) / m_period, (int64_t) 0) : 0;
+
+    int64_t cpuMicros = -1;
+    if (done - m_cpuRead >= CPU_INTERVAL)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+        cpuMicros = (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+        m_cpuRead = done;
+    }
+
+    uint32_t sequence = shared_segment::beginWrite(*m_sequence);
+
+    telemetry::snapshot_t &s = *m_snapshot;
+    s.frames++;
+    s.drops += drops;
+    s.queueDepth = queued;
+    s.maxQueueDepth = std::max(s.maxQueueDepth, queued);
+    s.updated = done;
+    if (cpuMicros >= 0)
+    {
+        s.cpuMicros = cpuMicros;
+    }
+    if (s.qosLevel != m_qosLevel)
+    {
+        s.qosLevel = m_qosLevel;
+        std::strncpy(s.qosName, m_qosName, sizeof(s.qosName) - 1);
+    }
+    std::memcpy(s.qos, m_qos, sizeof(s.qos));
+    for (uint8_t i = 0; i < trace::STAGE_COUNT; i++)
+    {
+        if (m_pending[i] < 0) continue;
+
+        telemetry::stage_t &stage = s.stages[i];
+        stage.passes++;
+        stage.max = std::max(stage.max, m_pending[i]);
+        stage.buckets[bucket(m_pending[i])]++;
+        m_pending[i] = -1;
+    }
+
+    shared_segment::endWrite(*m_sequence, sequence);
+}
+
+void telemetry::Publisher::remove()
+{
+    if (!m_removed)
+    {
+        shared_segment::unlink(segmentName(m_name));
+        m_removed = true;
+    }
+}
+
+const std::string &telemetry::Publisher::name() const
+{
+    return m_name;
+}
+
+telemetry::Reader::Reader(const std::string &name)
+    : m_data(nullptr), m_size(0)
+{
+    try
+    {
+        m_data = shared_segment::attach(segmentName(name), SEGMENT_SIZE);
+    }
+    catch (const shared_segment::SegmentException &e)
+    {
+        // A segment of another size is laid out differently
+        throw e == shared_segment::SegmentException::SIZE ? telemetry::TelemetryException::FORMAT
+                                                          : telemetry::TelemetryException::ATTACH;
+    }
+    m_size = SEGMENT_SIZE;
+
+    const telemetry::snapshot_t *snapshot = reinterpret_cast<const telemetry::snapshot_t *>(m_data + SNAPSHOT_OFFSET);
+    if (snapshot->magic == MAGIC && snapshot->version != VERSION)
+    {
+        shared_segment::unmap(m_data, m_size);
+        throw telemetry::TelemetryException::FORMAT;
+    }
+}
+
+telemetry::Reader::~Reader()
+{
+    shared_segment::unmap(m_data, m_size);
+}
+
+bool telemetry::Reader::read(telemetry::snapshot_t &snapshot) const
+{
+    const std::atomic<uint32_t> *sequence = reinterpret_cast<const std::atomic<uint32_t> *>(m_data);
+    return shared_segment::read(*sequence, m_data + SNAPSHOT_OFFSET, &snapshot, sizeof(telemetry::snapshot_t)) &&
+           snapshot.magic == MAGIC;
+}
@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_TELEMETRY_HPP
+#define DIT639_2023_GROUP_13_TELEMETRY_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+
+#include <atomic>
+#include <string>
+
+// The stages the latencies are counted of
+#include "trace.hpp"
+
+/*
+ * The statistics of a running binary, published in a shared
+ * memory segment of a fixed layout so that pipeline-top can
+ * show them live without any network or the binary having
+ * to print anything.
+ *
+ * The publisher updates the segment once per frame under the
+ * sequence lock of shared_segment, so it never waits for the
+ * readers and they only need to map the segment read-only.
+ *
+ * The latencies of every stage are counted in a histogram of
+ * logarithmic buckets instead of being kept, so publishing
+ * them costs a few increments and the percentiles are worked
+ * out by the reader, over any interval between two copies.
+ *
+ * The API includes:
+ * - BUCKET_COUNT:       the number of buckets of the histograms
+ *
+ * - bucket:             the bucket of a latency
+ *
+ * - bucketLimit:        the largest latency of a bucket
+ *
+ * - stage_t:            the latencies of one stage
+ *
+ * - qos_t:              the frames and time at one quality level
+ *
+ * - snapshot_t:         the statistics of a binary
+ *
+ * - percentile:         a percentile of a stage between two copies
+ *
+ * - TelemetryException: exceptions related to the segments
+ *
+ * - Publisher:          publishes the statistics of a binary
+ *
+ * - Reader:             reads the statistics of another binary
+ */
+namespace telemetry {
+
+    // The first bytes of every segment, "TLM1", and the version of its layout
+    const uint32_t MAGIC{0x314d4c54};
+    const uint32_t VERSION{2};
+
+    // The prefix of the names of the segments, in /dev/shm
+    const char *const PREFIX{"telemetry."};
+
+    // Four buckets for every power of two, up to half a minute
+    const uint32_t BUCKET_COUNT{96};
+
+    // The most quality levels the frames and time are published of
+    const uint32_t QOS_LEVELS{8};
+
+    /**
+     * Gets the bucket a latency is counted in
+     *
+     * @param micros the latency in microseconds
+     * @return the bucket, the last one for anything above half a minute
+     */
+    uint32_t bucket(int64_t micros);
+
+    /**
+     * Gets the largest latency a bucket counts
+     *
+     * @param bucket the bucket
+     * @return the latency in microseconds
+     */
+    int64_t bucketLimit(uint32_t bucket);
+
+    /**
+     * The latencies of one stage since the binary started
+     *
+     * @param passes the number of passes through the stage
+     * @param max the longest pass in microseconds
+     * @param buckets the number of passes in every bucket
+     */
+    struct stage_t {
+        uint64_t passes;
+        int64_t max;
+        uint64_t buckets[BUCKET_COUNT];
+    };
+
+    /**
+     * The frames done at one quality level of the detection since
+     * the binary started, and the time they took
+     *
+     * @param name the name of the quality level, empty if unused
+     * @param frames the number of frames done at the level
+     * @param micros the time the frames took in microseconds
+     */
+    struct qos_t {
+        char name[16];
+        uint64_t frames;
+        int64_t micros;
+    };
+
+    /**
+     * The statistics of a binary, as laid out in its segment
+     *
+     * @param magic MAGIC once the segment is set up
+     * @param version VERSION
+     * @param pid the process ID of the binary
+     * @param qosLevel the quality level of the detection, -1 without a deadline
+     * @param binary the name of the binary
+     * @param qosName the name of the quality level
+     * @param started the UNIX timestamp in microseconds the binary started at
+     * @param updated the UNIX timestamp in microseconds of the last frame
+     * @param frames the number of frames done
+     * @param drops the number of frames missing from the stream it got
+     * @param queueDepth the frames that arrived while the last one was done
+     * @param maxQueueDepth the most that ever arrived while one was done
+     * @param cpuMicros the CPU time of the process in microseconds
+     * @param qos the frames and time at every quality level, by level
+     * @param stages the latencies of every stage, by trace::Stage
+     */
+    struct snapshot_t {
+        uint32_t magic;
+        uint32_t version;
+        int32_t pid;
+        int32_t qosLevel;
+        char binary[32];
+        char qosName[16];
+        int64_t started;
+        int64_t updated;
+        uint64_t frames;
+        uint64_t drops;
+        uint32_t queueDepth;
+        uint32_t maxQueueDepth;
+        int64_t cpuMicros;
+        qos_t qos[QOS_LEVELS];
+        stage_t stages[trace::STAGE_COUNT];
+    };
+
+    /**
+     * Gets a percentile of the latencies of a stage between two
+     * copies of it
+     *
+     * @param now the later copy
+     * @param before the earlier copy, all zero for since the start
+     * @param fraction the fraction of the passes, e.g. 0.99
+     * @return the largest latency of the bucket the percentile is
+     * in, in microseconds, 0 if there were no passes
+     */
+    int64_t percentile(const stage_t &now, const stage_t &before, double fraction);
+
+    /*
+     * Exception enumerations tied to the segments
+     */
+    enum TelemetryException {
+        /*
+         * An exception that is thrown when a segment can't be
+         * created and mapped
+         */
+        CREATE,
+
+        /*
+         * An exception that is thrown when there is no segment
+         * to attach to
+         */
+        ATTACH,
+
+        /*
+         * An exception that is thrown when a segment isn't
+         * laid out as this version's
+         */
+        FORMAT
+    };
+
+    /*
+     * Publishes the statistics of a binary in a segment of its name.
+     * It's only used by the thread that runs the frames.
+     */
+    class Publisher {
+       public:
+        /**
+         * Creates the segment, or takes over one that a binary of
+         * the same name left behind
+         *
+         * @param name the name of the segment, after PREFIX
+         * @param binary the name of the binary to show
+         * @throws TelemetryException::CREATE if it can't be created
+         */
+        Publisher(const std::string &name, const std::string &binary);
+        ~Publisher();
+
+        Publisher(const Publisher &) = delete;
+        Publisher &operator=(const Publisher &) = delete;
+
+        /**
+         * Registers the duration of the current frame's pass through
+         * a stage, published with the frame
+         *
+         * @param stage the stage that was passed
+         * @param micros the time spent in the stage in microseconds
+         */
+        void record(trace::Stage stage, int64_t micros);
+
+        /**
+         * Sets the quality level of the detection, published with
+         * the next frame
+         *
+         * @param level the quality level
+         * @param name the name of the quality level
+         */
+        void setQos(int32_t level, const char *name);
+
+        /**
+         * Sets the frames done at a quality level and the time they
+         * took, published with the next frame
+         *
+         * @param level the quality level, below QOS_LEVELS
+         * @param name the name of the quality level
+         * @param frames the number of frames done at the level
+         * @param micros the time the frames took in microseconds
+         */
+        void setQosTime(uint32_t level, const char *name, uint64_t frames, int64_t micros);
+
+        /**
+         * Publishes a frame along with the stages recorded since the
+         * previous one. Gaps in the timestamps of the frames longer
+         * than their usual interval are counted as drops
+         *
+         * @param timestamp the timestamp of the frame in the stream
+         * in microseconds
+         * @param woke the UNIX timestamp in microseconds it arrived at
+         * @param done the UNIX timestamp in microseconds it was done at
+         */
+        void frame(int64_t timestamp, int64_t woke, int64_t done);
+
+        /**
+         * Removes the name of the segment, so no more readers can
+         * attach. The ones that did keep their copy of the last
+         * frame
+         */
+        void remove();
+
+        /**
+         * Gets the name of the segment
+         *
+         * @return the name, after PREFIX
+         */
+        const std::string &name() const;
+
+       private:
+        std::string m_name;
+        snapshot_t *m_snapshot;
+        std::atomic<uint32_t> *m_sequence;
+        // The durations of the current frame, -1 if not recorded
+        int64_t m_pending[trace::STAGE_COUNT];
+        int64_t m_lastTimestamp;
+        // The usual interval between the frames, in microseconds
+        int64_t m_period;
+        // When the CPU time was last read, as it takes a system call
+        int64_t m_cpuRead;
+        int32_t m_qosLevel;
+        const char *m_qosName;
+        qos_t m_qos[QOS_LEVELS];
+        bool m_removed;
+    };
+
+    /*
+     * Reads the statistics another binary publishes, through a
+     * read-only mapping of its segment
+     */
+    class Reader {
+       public:
+        /**
+         * Attaches to a segment
+         *
+         * @param name the name of the segment, after PREFIX
+         * @throws TelemetryException::ATTACH if there is none
+         * @throws TelemetryException::FORMAT if it isn't this version's
+         */
+        explicit Reader(const std::string &name);
+        ~Reader();
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        /**
+         * Copies the statistics of the last frame that was published
+         *
+         * @param snapshot the copy to write to
+         * @return whether a whole frame was copied, false if the
+         * publisher kept writing while it was tried a few times
+         */
+        bool read(snapshot_t &snapshot) const;
+
+       private:
+        const uint8_t *m_data;
+        size_t m_size;
+    };
+} // !namespace telemetry
+
+#endif // !DIT639_2023_GROUP_13_TELEMETRY_HPP
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "trace.hpp"
+
+// For gettimeofday, the clock cluon::time::now() reads as well
+#include <sys/time.h>
+
+/**
+ * The accumulated durations of one stage
+ *
+ * @param passes the number of recorded passes
+ * @param total the sum of all durations in microseconds
+ * @param min the shortest duration in microseconds
+ * @param max the longest duration in microseconds
+ */
+struct stage_stats_t {
+    uint64_t passes;
+    int64_t total;
+    int64_t min;
+    int64_t max;
+};
+
+// The accumulated durations of every stage
+stage_stats_t stages[trace::STAGE_COUNT] = {};
+
+int64_t trace::now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+void trace::record(trace::Stage stage, int64_t micros)
+{
+    stage_stats_t &s = stages[stage];
+
+    if (s.passes == 0 || micros < s.min)
+    {
+        s.min = micros;
+    }
+    if (s.passes == 0 || micros > s.max)
+    {
+        s.max = micros;
+    }
+    s.total += micros;
+    s.passes++;
+}
+
+void trace::printStages(std::ostream &out)
+{
+    const std::string SEP = "----------";
+
+    // The sum of the mean durations of all recorded stages
+    double sum = 0.0;
+
+    out << SEP << std::endl;
+    out << "Stage latency (us): passes / mean / min / max" << std::endl;
+    out << SEP << std::endl;
+    for (uint8_t i = 0; i < trace::STAGE_COUNT; i++)
+    {
+        const stage_stats_t &s = stages[i];
+
+        // Skip stages that this binary doesn't run
+        if (s.passes == 0) continue;
+
+        double mean = (double) s.total / (double) s.passes;
+        sum += mean;
+        out << trace::STAGE_NAMES[i] << ": " << s.passes << " / " << mean
+            << " / " << s.min << " / " << s.max << std::endl;
+    }
+    out << "Sum of means: " << sum << std::endl;
+    out << SEP << std::endl;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_TRACE_HPP
+#define DIT639_2023_GROUP_13_TRACE_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+
+#include <iostream>
+
+/*
+ * Per-stage latency tracing shared by the microservices.
+ *
+ * Every stage that a frame passes through between the
+ * decoder's shared memory and the steering value has its
+ * own slot. A binary records the stages it runs, so the
+ * two-process setup and the fused binary report the same
+ * stages and can be compared directly.
+ *
+ * All timestamps are UNIX timestamps in microseconds, i.e.
+ * the same clock as pos_api::data_t::now, so durations can
+ * be measured across process boundaries.
+ */
+namespace trace {
+
+    /*
+     * The stages of the pipeline, in the order a frame
+     * passes through them
+     */
+    enum Stage {
+        // Waiting for and copying the frame out of the
+        // decoder's shared memory
+        CAPTURE,
+
+        // Finding the cones in the frame
+        DETECT,
+
+        // Handing the cone data over to the steering
+        // calculation. Across processes this is the time
+        // from pos_api::put until the consumer woke up
+        HANDOFF,
+
+        // Calculating the steering value
+        STEER,
+
+        // The number of stages
+        STAGE_COUNT
+    };
+
+    // The names of the stages, in the order of Stage
+    const char *const STAGE_NAMES[STAGE_COUNT] = {
+        "capture",
+        "detect",
+        "handoff",
+        "steer"
+    };
+
+    /**
+     * Gets the current UNIX timestamp
+     *
+     * @return the UNIX timestamp in microseconds
+     */
+    int64_t now();
+
+    /**
+     * Registers the duration of one pass through a stage
+     *
+     * @param stage the stage that was passed
+     * @param micros the time spent in the stage in microseconds
+     */
+    void record(Stage stage, int64_t micros);
+
+    /**
+     * Prints the number of passes and the mean, minimum
+     * and maximum duration of every stage that has been
+     * recorded, followed by their sum
+     *
+     * @param out the stream to print to
+     */
+    void printStages(std::ostream &out);
+} // !namespace trace
+
+#endif // !DIT639_2023_GROUP_13_TRACE_HPP
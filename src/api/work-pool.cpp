@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "work-pool.hpp"
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * The share of the items a worker hasn't done yet
+ *
+ * @param lock guards next and end, taken by the owner and thieves
+ * @param next the next item to do
+ * @param end the item after the last item of the share
+ */
+struct share_t {
+    std::mutex lock{};
+    uint64_t next{0};
+    uint64_t end{0};
+};
+
+/**
+ * Takes the next item of a worker's own share
+ *
+ * @param share the share of the worker
+ * @param item set to the item that was taken
+ * @return whether there was an item left
+ */
+bool take(share_t &share, uint64_t &item);
+
+/**
+ * Moves the back half of another worker's share into
+ * the thief's own, empty share
+ *
+ * @param shares the shares of all workers
+ * @param workers the number of workers
+ * @param thief the number of the worker that steals
+ * @return whether there was anything left to steal
+ */
+bool steal(share_t *shares, uint32_t workers, uint32_t thief);
+
+uint32_t work_pool::run(uint64_t items, uint32_t workers, const std::function<void(uint32_t, uint64_t)> &job)
+{
+    if (workers == 0)
+    {
+        workers = std::thread::hardware_concurrency();
+    }
+    // No more workers than items, but at least one
+    if (workers > items)
+    {
+        workers = (uint32_t) items;
+    }
+    if (workers == 0)
+    {
+        return 0;
+    }
+
+    // Hand out even, contiguous shares, which keeps the
+    // items of a worker close together in memory
+    std::unique_ptr<share_t[]> shares(new share_t[workers]);
+    for (uint32_t w = 0; w < workers; w++)
+    {
+        shares[w].next = items * w / workers;
+        shares[w].end = items * (w + 1) / workers;
+    }
+
+    auto work = [&](uint32_t worker) {
+        uint64_t item;
+        do
+        {
+            while (take(shares[worker], item))
+            {
+                job(worker, item);
+            }
+        } while (steal(shares.get(), workers, worker));
+    };
+
+    // The calling thread is a worker as well
+    std::vector<std::thread> threads;
+    for (uint32_t w = 1; w < workers; w++)
+    {
+        threads.emplace_back(work, w);
+    }
+    work(0);
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    return workers;
+}
+
+bool take(share_t &share, uint64_t &item)
+{
+    std::lock_guard<std::mutex> guard(share.lock);
+    if (share.next == share.end)
+    {
+        return false;
+    }
+    item = share.next++;
+    return true;
+}
+
+bool steal(share_t *shares, uint32_t workers, uint32_t thief)
+{
+    // Start with the next worker, so the thieves
+    // don't all go for the same victim
+    for (uint32_t i = 1; i < workers; i++)
+    {
+        share_t &victim = shares[(thief + i) % workers];
+        uint64_t begin;
+        uint64_t end;
+        {
+            std::lock_guard<std::mutex> guard(victim.lock);
+            uint64_t left = victim.end - victim.next;
+            if (left == 0) continue;
+
+            // Leave the victim the front half, which it's working on.
+            // A single item left is taken whole
+            end = victim.end;
+            victim.end -= (left + 1) / 2;
+            begin = victim.end;
+        }
+
+        // Only the owner takes from its share otherwise, and it's empty
+        std::lock_guard<std::mutex> guard(shares[thief].lock);
+        shares[thief].next = begin;
+        shares[thief].end = end;
+        return true;
+    }
+    // The items are never added to, so once every share
+    // is empty all of them have been taken
+    return false;
+}
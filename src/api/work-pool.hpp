@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_WORK_POOL_HPP
+#define DIT639_2023_GROUP_13_WORK_POOL_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+
+#include <functional>
+
+/*
+ * A work-stealing pool for running a job over a number of
+ * independent items, e.g. the frames of a recording.
+ *
+ * Every worker starts with an even share of the items and
+ * works through it front to back. A worker that runs out
+ * steals the back half of the share of another worker, so
+ * all workers stay busy even when some items take longer
+ * than others.
+ */
+namespace work_pool {
+
+    /**
+     * Runs a job for every item and returns when all of them
+     * are done. The job is called from the worker threads, with
+     * the number of the worker, so it can use buffers of its own.
+     *
+     * @param items the number of items, numbered from 0
+     * @param workers the number of worker threads, 0 for one
+     * per hardware thread
+     * @param job the job to run, called with the number of the
+     * worker (below workers) and the number of the item
+     * @return the number of workers that were used
+     */
+    uint32_t run(uint64_t items, uint32_t workers, const std::function<void(uint32_t, uint64_t)> &job);
+} // !namespace work_pool
+
+#endif // !DIT639_2023_GROUP_13_WORK_POOL_HPP
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "bit-mask.hpp"
+// The variants of the passes for every instruction set
+#include "isa.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * Runs one horizontal pass of a dilation or erosion over
+ * every row. Shifting a word left moves its pixels to the
+ * right, so the bits shifted in come from the word before.
+ *
+ * @param src the mask to read
+ * @param dst the mask to write
+ * @param radius the number of pixels to each side
+ * @param erode whether to AND (erode) instead of OR (dilate)
+ */
+ISA_INLINE void horizontalPass(const bit_mask::BitMask &src, bit_mask::BitMask &dst, uint32_t radius, bool erode)
+{
+    const uint32_t WORDS = src.wordsPerRow();
+    const uint64_t LAST = src.lastWordMask();
+
+    // The pixels outside of the mask, see the header
+    const uint64_t OUTSIDE = erode ? ~0ULL : 0;
+
+    for (uint32_t y = 0; y < src.height(); y++)
+    {
+        const uint64_t *in = src.row(y);
+        uint64_t *out = dst.row(y);
+        for (uint32_t w = 0; w < WORDS; w++)
+        {
+            // The padding of the last word is outside of the mask too
+            uint64_t word = w + 1 == WORDS ? (in[w] & LAST) | (OUTSIDE & ~LAST) : in[w];
+            uint64_t before = w > 0 ? in[w - 1] : OUTSIDE;
+            uint64_t after = w + 1 < WORDS ? (w + 2 == WORDS ? (in[w + 1] & LAST) | (OUTSIDE & ~LAST) : in[w + 1]) : OUTSIDE;
+
+            uint64_t result = word;
+            for (uint32_t k = 1; k <= radius; k++)
+            {
+                // The pixel k to the left and k to the right
+                uint64_t left = (word << k) | (before >> (64 - k));
+                uint64_t right = (word >> k) | (after << (64 - k));
+                result = erode ? result & left & right : result | left | right;
+            }
+            out[w] = w + 1 == WORDS ? result & LAST : result;
+        }
+    }
+}
+
+/**
+ * Runs one vertical pass of a dilation or erosion over
+ * every row, a whole word at a time
+ *
+ * @param src the mask to read
+ * @param dst the mask to write
+ * @param radius the number of rows above and below
+ * @param erode whether to AND (erode) instead of OR (dilate)
+ */
+ISA_INLINE void verticalPass(const bit_mask::BitMask &src, bit_mask::BitMask &dst, uint32_t radius, bool erode)
+{
+    const uint32_t WORDS = src.wordsPerRow();
+    const int32_t HEIGHT = (int32_t) src.height();
+
+    for (int32_t y = 0; y < HEIGHT; y++)
+    {
+        uint64_t *out = dst.row((uint32_t) y);
+        std::memcpy(out, src.row((uint32_t) y), WORDS * sizeof (uint64_t));
+
+        // The rows outside of the mask don't change anything, they're
+        // unset when dilating and set when eroding
+        const int32_t FIRST = std::max(y - (int32_t) radius, 0);
+        const int32_t LAST = std::min(y + (int32_t) radius, HEIGHT - 1);
+        for (int32_t r = FIRST; r <= LAST; r++)
+        {
+            if (r == y) continue;
+            const uint64_t *in = src.row((uint32_t) r);
+            for (uint32_t w = 0; w < WORDS; w++)
+            {
+                out[w] = erode ? out[w] & in[w] : out[w] | in[w];
+            }
+        }
+    }
+}
+
+// The passes, compiled for every instruction set
+ISA_KERNEL(horizontal, horizontalPass,
+           (const bit_mask::BitMask &src, bit_mask::BitMask &dst, uint32_t radius, bool erode),
+           (src, dst, radius, erode))
+ISA_KERNEL(vertical, verticalPass,
+           (const bit_mask::BitMask &src, bit_mask::BitMask &dst, uint32_t radius, bool erode),
+           (src, dst, radius, erode))
+
+bit_mask::BitMask::BitMask(uint32_t width, uint32_t height)
+    : m_width(width), m_height(height), m_wordsPerRow((width + 63) / 64),
+      m_words((size_t) m_wordsPerRow * height, 0)
+{
+}
+
+uint32_t bit_mask::BitMask::width() const
+{
+    return m_width;
+}
+
+uint32_t bit_mask::BitMask::height() const
+{
+    return m_height;
+}
+
+uint32_t bit_mask::BitMask::wordsPerRow() const
+{
+    return m_wordsPerRow;
+}
+
+uint64_t *bit_mask::BitMask::row(uint32_t y)
+{
+    return &m_words[(size_t) y * m_wordsPerRow];
+}
+
+const uint64_t *bit_mask::BitMask::row(uint32_t y) const
+{
+    return &m_words[(size_t) y * m_wordsPerRow];
+}
+
+uint64_t bit_mask::BitMask::lastWordMask() const
+{
+    return m_width % 64 == 0 ? ~0ULL : (1ULL << (m_width % 64)) - 1;
+}
+
+void bit_mask::BitMask::resize(uint32_t width, uint32_t height)
+{
+    m_width = width;
+    m_height = height;
+    m_wordsPerRow = (width + 63) / 64;
+    m_words.resize((size_t) m_wordsPerRow * height);
+}
+
+void bit_mask::BitMask::clear()
+{
+    std::fill(m_words.begin(), m_words.end(), 0);
+}
+
+void bit_mask::BitMask::unpack(uint8_t *pixels, size_t stride, uint8_t on) const
+{
+    for (uint32_t y = 0; y < m_height; y++)
+    {
+        const uint64_t *words = row(y);
+        uint8_t *out = pixels + y * stride;
+        for (uint32_t x = 0; x < m_width; x++)
+        {
+            out[x] = (words[x / 64] >> (x % 64)) & 1 ? on : 0;
+        }
+    }
+}
+
+void bit_mask::dilate(const bit_mask::BitMask &src, bit_mask::BitMask &dst, bit_mask::BitMask &tmp, uint32_t width, uint32_t height)
+{
+    horizontal(src, tmp, width / 2, false);
+    vertical(tmp, dst, height / 2, false);
+}
+
+void bit_mask::erode(const bit_mask::BitMask &src, bit_mask::BitMask &dst, bit_mask::BitMask &tmp, uint32_t width, uint32_t height)
+{
+    horizontal(src, tmp, width / 2, true);
+    vertical(tmp, dst, height / 2, true);
+}
+
+void bit_mask::close(bit_mask::BitMask &mask, bit_mask::BitMask &tmp, bit_mask::BitMask &tmp2, uint32_t width, uint32_t height)
+{
+    bit_mask::dilate(mask, tmp2, tmp, width, height);
+    bit_mask::erode(tmp2, mask, tmp, width, height);
+}
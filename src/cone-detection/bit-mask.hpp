@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_BIT_MASK_HPP
+#define DIT639_2023_GROUP_13_BIT_MASK_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+ * Binary masks with one bit per pixel, and the morphology
+ * on them.
+ *
+ * Every row is a whole number of 64-bit words and bit i of
+ * word w is pixel w * 64 + i, so a row of 640 pixels is 10
+ * words instead of 640 bytes. A rectangular dilation or
+ * erosion is separable: horizontally it ORs or ANDs a word
+ * with itself shifted by up to the radius, carrying the bits
+ * over from the neighbouring words, and vertically it ORs
+ * or ANDs whole words of the rows above and below. Either
+ * way 64 pixels are done per instruction.
+ *
+ * Pixels outside of the mask are treated like OpenCV does by
+ * default: as unset when dilating and as set when eroding,
+ * so the edges of the mask don't erode.
+ *
+ * - MAX_WIDTH: the widest rectangle
+ *
+ * - BitMask:   a binary mask with one bit per pixel
+ *
+ * - dilate:    dilates a mask with a rectangle
+ *
+ * - erode:     erodes a mask with a rectangle
+ *
+ * - close:     closes a mask with a rectangle
+ */
+namespace bit_mask {
+
+    // The widest rectangle: the bits of a pixel's neighbours are
+    // only carried over from the word on each side of its word, so
+    // the radius has to be less than the 64 pixels of a word
+    const uint32_t MAX_WIDTH{127};
+
+    /*
+     * A binary mask with one bit per pixel. The bits past the
+     * width in the last word of a row are always unset.
+     */
+    class BitMask {
+       public:
+        /**
+         * Creates a mask with every pixel unset
+         *
+         * @param width the width of the mask in pixels
+         * @param height the height of the mask in pixels
+         */
+        BitMask(uint32_t width, uint32_t height);
+
+        /**
+         * Gets the width of the mask
+         *
+         * @return the width in pixels
+         */
+        uint32_t width() const;
+
+        /**
+         * Gets the height of the mask
+         *
+         * @return the height in pixels
+         */
+        uint32_t height() const;
+
+        /**
+         * Gets the number of words of every row
+         *
+         * @return the number of words
+         */
+        uint32_t wordsPerRow() const;
+
+        /**
+         * Gets the words of a row
+         *
+         * @param y the row
+         * @return the first word of the row
+         */
+        uint64_t *row(uint32_t y);
+        const uint64_t *row(uint32_t y) const;
+
+        /**
+         * Gets the mask of the bits of the last word of
+         * a row that are pixels
+         *
+         * @return the mask, with all bits set if the width
+         * is a multiple of 64
+         */
+        uint64_t lastWordMask() const;
+
+        /**
+         * Changes the size of the mask, without allocating if it
+         * isn't bigger than it was created with. The pixels are
+         * undefined until the mask is cleared.
+         *
+         * @param width the width of the mask in pixels
+         * @param height the height of the mask in pixels
+         */
+        void resize(uint32_t width, uint32_t height);
+
+        /**
+         * Unsets every pixel
+         */
+        void clear();
+
+        /**
+         * Writes the mask as one byte per pixel
+         *
+         * @param pixels the first byte of the first row
+         * @param stride the number of bytes from one row to the next
+         * @param on the value of the set pixels, the unset ones are 0
+         */
+        void unpack(uint8_t *pixels, size_t stride, uint8_t on) const;
+
+       private:
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_wordsPerRow;
+        std::vector<uint64_t> m_words;
+    };
+
+    /**
+     * Dilates a mask with a rectangle
+     *
+     * @param src the mask to dilate
+     * @param dst the dilated mask, of the same size as src
+     * @param tmp a mask of the same size for the horizontal pass
+     * @param width the width of the rectangle, odd and at most
+     * MAX_WIDTH
+     * @param height the height of the rectangle, odd
+     */
+    void dilate(const BitMask &src, BitMask &dst, BitMask &tmp, uint32_t width, uint32_t height);
+
+    /**
+     * Erodes a mask with a rectangle
+     *
+     * @param src the mask to erode
+     * @param dst the eroded mask, of the same size as src
+     * @param tmp a mask of the same size for the horizontal pass
+     * @param width the width of the rectangle, odd and at most
+     * MAX_WIDTH
+     * @param height the height of the rectangle, odd
+     */
+    void erode(const BitMask &src, BitMask &dst, BitMask &tmp, uint32_t width, uint32_t height);
+
+    /**
+     * Closes a mask with a rectangle, i.e. dilates and then erodes
+     * it, which fills the gaps and holes smaller than the rectangle
+     *
+     * @param mask the mask to close, in place
+     * @param tmp a mask of the same size
+     * @param tmp2 another mask of the same size
+     * @param width the width of the rectangle, odd and at most
+     * MAX_WIDTH
+     * @param height the height of the rectangle, odd
+     */
+    void close(BitMask &mask, BitMask &tmp, BitMask &tmp2, uint32_t width, uint32_t height);
+} // !namespace bit_mask
+
+#endif // !DIT639_2023_GROUP_13_BIT_MASK_HPP
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "blobs.hpp"
+
+#include <algorithm>
+
+// The runs reserved, more than a frame of cones has
+#define RESERVED_RUNS 1024
+
+/**
+ * Finds the next set or unset pixel of a row
+ *
+ * @param row the words of the row
+ * @param words the number of words of the row
+ * @param width the width of the row in pixels
+ * @param from the first column to look at
+ * @param set whether to look for a set pixel instead of an unset one
+ * @return the column of the pixel, or width if there is none
+ */
+uint32_t findPixel(const uint64_t *row, uint32_t words, uint32_t width, uint32_t from, bool set);
+
+blobs::BlobExtractor::BlobExtractor()
+    : m_runs(), m_parents(), m_labels()
+{
+    m_runs.reserve(RESERVED_RUNS);
+    m_parents.reserve(RESERVED_RUNS);
+    m_labels.reserve(RESERVED_RUNS);
+}
+
+void blobs::BlobExtractor::extract(const bit_mask::BitMask &mask, std::vector<blobs::blob_t> &blobs)
+{
+    const uint32_t WIDTH = mask.width();
+    const uint32_t WORDS = mask.wordsPerRow();
+    m_runs.clear();
+    m_parents.clear();
+    blobs.clear();
+
+    // The runs of the row above, which the runs of the row are joined with
+    uint32_t aboveBegin = 0;
+    uint32_t aboveEnd = 0;
+    for (uint32_t y = 0; y < mask.height(); y++)
+    {
+        const uint64_t *row = mask.row(y);
+        const uint32_t ROW_BEGIN = (uint32_t) m_runs.size();
+        uint32_t above = aboveBegin;
+
+        uint32_t x = findPixel(row, WORDS, WIDTH, 0, true);
+        while (x < WIDTH)
+        {
+            const uint32_t END = findPixel(row, WORDS, WIDTH, x, false);
+            const uint32_t RUN = (uint32_t) m_runs.size();
+            m_runs.push_back({y, x, END});
+            m_parents.push_back(RUN);
+
+            // The runs above touch this one, diagonally too, if they end at
+            // or after its first column and begin at or before its end. The
+            // ones that end before it can't touch the next runs either.
+            while (above < aboveEnd && m_runs[above].end < x)
+            {
+                above++;
+            }
+            for (uint32_t a = above; a < aboveEnd && m_runs[a].begin <= END; a++)
+            {
+                join(a, RUN);
+            }
+
+            x = findPixel(row, WORDS, WIDTH, END, true);
+        }
+
+        aboveBegin = ROW_BEGIN;
+        aboveEnd = (uint32_t) m_runs.size();
+    }
+
+    // The runs are joined to the first run of their blob, which
+    // comes before all the others, so it has its label first
+    m_labels.resize(m_runs.size());
+    for (uint32_t r = 0; r < m_runs.size(); r++)
+    {
+        const blobs::run_t &run = m_runs[r];
+        const uint32_t ROOT = find(r);
+        if (ROOT == r)
+        {
+            m_labels[r] = (uint32_t) blobs.size();
+            blobs.push_back({0, run.begin, run.y, run.end, run.y + 1, 0, 0});
+        }
+        blobs::blob_t &blob = blobs[m_labels[ROOT]];
+
+        // The sum of the columns begin to end - 1, and of the row per pixel
+        const uint32_t LENGTH = run.end - run.begin;
+        blob.area += LENGTH;
+        blob.sumX += (uint64_t) (run.begin + run.end - 1) * LENGTH / 2;
+        blob.sumY += (uint64_t) run.y * LENGTH;
+        blob.left = std::min(blob.left, run.begin);
+        blob.right = std::max(blob.right, run.end);
+        blob.bottom = run.y + 1;
+    }
+}
+
+uint32_t blobs::BlobExtractor::find(uint32_t run)
+{
+    while (m_parents[run] != run)
+    {
+        m_parents[run] = m_parents[m_parents[run]];
+        run = m_parents[run];
+    }
+    return run;
+}
+
+void blobs::BlobExtractor::join(uint32_t a, uint32_t b)
+{
+    a = find(a);
+    b = find(b);
+
+    // The first run stays the root, so it's the first of the blob
+    if (a < b)
+    {
+        m_parents[b] = a;
+    }
+    else if (b < a)
+    {
+        m_parents[a] = b;
+    }
+}
+
+uint32_t findPixel(const uint64_t *row, uint32_t words, uint32_t width, uint32_t from, bool set)
+{
+    uint32_t w = from / 64;
+    if (w >= words) return width;
+
+    // Unset pixels are searched for as the set bits of the inverted words.
+    // The padding of the last word is unset, so a run ends at the width.
+    const uint64_t INVERT = set ? 0 : ~0ULL;
+    uint64_t word = (row[w] ^ INVERT) & (~0ULL << (from % 64));
+    while (word == 0)
+    {
+        if (++w == words) return width;
+        word = row[w] ^ INVERT;
+    }
+    return std::min(w * 64 + (uint32_t) __builtin_ctzll(word), width);
+}
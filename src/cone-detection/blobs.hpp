@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_BLOBS_HPP
+#define DIT639_2023_GROUP_13_BLOBS_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+#include <vector>
+
+// The masks the blobs are found in
+#include "bit-mask.hpp"
+
+/*
+ * Finds the blobs of a bit-packed mask, i.e. its sets of
+ * 8-connected pixels, from the runs of set pixels in each
+ * row instead of from every pixel.
+ *
+ * The runs of a row are found a word at a time by counting
+ * the zeros before the next set or unset bit, and every run
+ * is joined with the runs of the row above that touch it
+ * with union-find. The area, bounding box and centroid of a
+ * blob are then summed over its runs, so the work depends on
+ * the number of runs, not of pixels, which is small when
+ * there are only a few cones in view.
+ *
+ * - run_t:         a run of set pixels in a row
+ *
+ * - blob_t:        a blob of the mask
+ *
+ * - BlobExtractor: finds the blobs of masks
+ */
+namespace blobs {
+
+    /**
+     * A run of set pixels in a row of a mask
+     *
+     * @param y the row
+     * @param begin the first column of the run
+     * @param end the column after the last column
+     */
+    struct run_t {
+        uint32_t y;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    /**
+     * A blob of a mask. The centroid of the blob is sumX / area
+     * and sumY / area.
+     *
+     * @param area the number of pixels of the blob
+     * @param left the first column of the blob
+     * @param top the first row of the blob
+     * @param right the column after the last column
+     * @param bottom the row after the last row
+     * @param sumX the sum of the x coordinates of the pixels
+     * @param sumY the sum of the y coordinates of the pixels
+     */
+    struct blob_t {
+        uint32_t area;
+        uint32_t left;
+        uint32_t top;
+        uint32_t right;
+        uint32_t bottom;
+        uint64_t sumX;
+        uint64_t sumY;
+    };
+
+    /*
+     * Finds the blobs of masks. The extractor keeps its runs
+     * and labels from one mask to the next, so it only
+     * allocates when a mask has more runs than any before.
+     */
+    class BlobExtractor {
+       public:
+        BlobExtractor();
+
+        /**
+         * Finds the blobs of a mask
+         *
+         * @param mask the mask
+         * @param blobs set to the blobs, in the order of their
+         * first run, i.e. top to bottom and left to right
+         */
+        void extract(const bit_mask::BitMask &mask, std::vector<blob_t> &blobs);
+
+       private:
+        /**
+         * Finds the run a run has been joined with, halving the
+         * path to it on the way
+         *
+         * @param run the run
+         * @return the first run of the runs joined with it
+         */
+        uint32_t find(uint32_t run);
+
+        /**
+         * Joins the blobs of two runs
+         *
+         * @param a one run
+         * @param b the other run
+         */
+        void join(uint32_t a, uint32_t b);
+
+        std::vector<run_t> m_runs;
+        // The run each run was joined with, or itself
+        std::vector<uint32_t> m_parents;
+        // The blob of each run that is the first of its blob
+        std::vector<uint32_t> m_labels;
+    };
+} // !namespace blobs
+
+#endif // !DIT639_2023_GROUP_13_BLOBS_HPP
@@ -0,0 +1,753 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "cone-detect.hpp"
+// The variants of the kernels for every instruction set
+#include "isa.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// The rows above and below the region that are converted along with it.
+// The edge detection and the closing read a few pixels past the edges of
+// the region, which have to be the same as when the whole frame is
+// converted, or cones cut by the edges would be found differently.
+#define CONTEXT_ROWS 8
+
+// The contours reserved per colour, more than a frame has
+#define RESERVED_CONTOURS 64
+
+// The tracked cones, the closest two of both colours
+#define TRACKS 4
+
+// The fixed point of OpenCV's 8-bit BGR to HSV conversion
+#define HSV_SHIFT 12
+
+/**
+ * The divisions of OpenCV's 8-bit BGR to HSV conversion, by the
+ * value and by the range of the channels, in fixed point
+ *
+ * @param saturation 255 / i for every i
+ * @param hue 180 / (6 * i) for every i
+ */
+struct hsv_tables_t {
+    int32_t saturation[256];
+    int32_t hue[256];
+};
+
+/**
+ * Calculates the divisions of the BGR to HSV conversion
+ *
+ * @return the tables, rounded like OpenCV's
+ */
+hsv_tables_t makeHsvTables();
+
+// The divisions of the BGR to HSV conversion
+const hsv_tables_t HSV_TABLES = makeHsvTables();
+
+/**
+ * Converts a BGR pixel to HSV exactly like cv::cvtColor with
+ * cv::COLOR_BGR2HSV, so a pixel can be converted without the
+ * rest of its image
+ *
+ * @param bgr the blue, green and red of the pixel
+ * @param hsv set to the hue, saturation and value of the pixel
+ */
+ISA_INLINE void bgrToHsv(const uint8_t *bgr, uint8_t *hsv)
+{
+    const int32_t B = bgr[0];
+    const int32_t G = bgr[1];
+    const int32_t R = bgr[2];
+    const int32_t V = std::max(B, std::max(G, R));
+    const int32_t DIFF = V - std::min(B, std::min(G, R));
+    const int32_t VR = V == R ? -1 : 0;
+    const int32_t VG = V == G ? -1 : 0;
+
+    const int32_t S = (DIFF * HSV_TABLES.saturation[V] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+    int32_t h = (VR & (G - B)) + (~VR & ((VG & (B - R + 2 * DIFF)) + (~VG & (R - G + 4 * DIFF))));
+    h = (h * HSV_TABLES.hue[DIFF] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+    h += h < 0 ? 180 : 0;
+
+    hsv[0] = (uint8_t) h;
+    hsv[1] = (uint8_t) S;
+    hsv[2] = (uint8_t) V;
+}
+
+/**
+ * Converts a YUV pixel to BGR with the BT.601 limited range
+ * coefficients, which the decoder converts its frames with too
+ * (up to rounding)
+ *
+ * @param y the luma of the pixel
+ * @param u the blue chroma of the pixel
+ * @param v the red chroma of the pixel
+ * @param bgr set to the blue, green and red of the pixel
+ */
+inline void yuvToBgr(int32_t y, int32_t u, int32_t v, uint8_t *bgr)
+{
+    const int32_t C = 298 * (y - 16) + 128;
+    const int32_t D = u - 128;
+    const int32_t E = v - 128;
+    bgr[0] = (uint8_t) std::min(std::max((C + 516 * D) >> 8, 0), 255);
+    bgr[1] = (uint8_t) std::min(std::max((C - 100 * D - 208 * E) >> 8, 0), 255);
+    bgr[2] = (uint8_t) std::min(std::max((C + 409 * E) >> 8, 0), 255);
+}
+
+/**
+ * Checks whether an HSV pixel is within a range, like cv::inRange.
+ * The bounds are compared without branches, which noisy pixels would
+ * mispredict, and the bounds of a profile known at compile time are
+ * constants, or folded away if they're 0 or 255.
+ *
+ * @param hsv the hue, saturation and value of the pixel
+ * @param range the range
+ * @return whether every channel is within the range
+ */
+ISA_INLINE bool withinRange(const uint8_t *hsv, const cone_detect::hsv_range_t &range)
+{
+    return (hsv[0] >= range.minH) & (hsv[0] <= range.maxH) &
+           (hsv[1] >= range.minS) & (hsv[1] <= range.maxS) &
+           (hsv[2] >= range.minV) & (hsv[2] <= range.maxV);
+}
+
+/**
+ * Checks whether two HSV ranges are the same
+ *
+ * @param a one range
+ * @param b the other range
+ * @return whether every bound is the same
+ */
+inline bool sameRange(const cone_detect::hsv_range_t &a, const cone_detect::hsv_range_t &b)
+{
+    return a.minH == b.minH && a.minS == b.minS && a.minV == b.minV &&
+           a.maxH == b.maxH && a.maxS == b.maxS && a.maxV == b.maxV;
+}
+
+/**
+ * Where the pixels of the packed masks are in a frame
+ *
+ * @param left the column of the first column of the masks
+ * @param top the row of the first row of the masks
+ * @param stepX the columns from one pixel of the masks to the next
+ * @param stepY the rows from one row of the masks to the next
+ */
+struct sampling_t {
+    uint32_t left;
+    uint32_t top;
+    uint32_t stepX;
+    uint32_t stepY;
+};
+
+/**
+ * Filters a rectangle of a BGRA frame into the bit-packed
+ * masks of both colours, in one pass
+ *
+ * @param bgra the first byte of the frame
+ * @param stride the number of bytes from one row to the next
+ * @param sampling where the pixels of the masks are in the frame
+ * @param window the rectangle, in the pixels of the masks
+ * @param profile the HSV ranges of the colours
+ * @param blue the mask of the blue cones
+ * @param yellow the mask of the yellow cones
+ */
+template <typename Profile>
+ISA_INLINE void packBgraRows(const uint8_t *bgra, size_t stride, const sampling_t &sampling, const cv::Rect &window,
+                             const Profile &profile, bit_mask::BitMask &blue, bit_mask::BitMask &yellow)
+{
+    const uint32_t LEFT = (uint32_t) window.x;
+    const uint32_t RIGHT = (uint32_t) (window.x + window.width);
+    const size_t STEP = sampling.stepX * 4;
+
+    for (uint32_t y = (uint32_t) window.y; y < (uint32_t) (window.y + window.height); y++)
+    {
+        const uint8_t *pixel = bgra + (sampling.top + y * sampling.stepY) * stride + (sampling.left + LEFT * sampling.stepX) * 4;
+        uint64_t *blueRow = blue.row(y);
+        uint64_t *yellowRow = yellow.row(y);
+        uint32_t x = LEFT;
+        while (x < RIGHT)
+        {
+            // The pixels of a word are set without branches. The words are
+            // ORed in, as the windows can share them
+            const uint32_t WORD = x / 64;
+            const uint32_t END = std::min(RIGHT, (WORD + 1) * 64);
+            uint64_t blueWord = 0;
+            uint64_t yellowWord = 0;
+            for (; x < END; x++, pixel += STEP)
+            {
+                uint8_t hsv[3];
+                bgrToHsv(pixel, hsv);
+                blueWord |= (uint64_t) withinRange(hsv, profile.blue()) << (x % 64);
+                yellowWord |= (uint64_t) withinRange(hsv, profile.yellow()) << (x % 64);
+            }
+            blueRow[WORD] |= blueWord;
+            yellowRow[WORD] |= yellowWord;
+        }
+    }
+}
+
+/**
+ * Filters a rectangle of an I420 frame into the bit-packed
+ * masks of both colours, like packBgraRows. Only the rows of
+ * the rectangle are read from the three planes.
+ *
+ * @param i420 the first byte of the frame's Y plane
+ * @param stride the number of bytes from one row of the Y plane to the next
+ * @param height the number of rows of the frame
+ * @param sampling where the pixels of the masks are in the frame
+ * @param window the rectangle, in the pixels of the masks
+ * @param bounds the luma bounds of the colours, by U << 8 | V
+ * @param blue the mask of the blue cones
+ * @param yellow the mask of the yellow cones
+ */
+ISA_INLINE void packI420Rows(const uint8_t *i420, size_t stride, uint32_t height, const sampling_t &sampling, const cv::Rect &window,
+                             const cone_detect::luma_bounds_t *bounds, bit_mask::BitMask &blue, bit_mask::BitMask &yellow)
+{
+    const uint32_t LEFT = (uint32_t) window.x;
+    const uint32_t RIGHT = (uint32_t) (window.x + window.width);
+
+    // Every chroma is shared by two columns of two rows
+    const size_t CHROMA_STRIDE = (stride + 1) / 2;
+    const uint8_t *uPlane = i420 + stride * height;
+    const uint8_t *vPlane = uPlane + CHROMA_STRIDE * ((height + 1) / 2);
+
+    for (uint32_t y = (uint32_t) window.y; y < (uint32_t) (window.y + window.height); y++)
+    {
+        const uint32_t ROW = sampling.top + y * sampling.stepY;
+        const uint8_t *luma = i420 + ROW * stride;
+        const uint8_t *u = uPlane + (ROW / 2) * CHROMA_STRIDE;
+        const uint8_t *v = vPlane + (ROW / 2) * CHROMA_STRIDE;
+        uint64_t *blueRow = blue.row(y);
+        uint64_t *yellowRow = yellow.row(y);
+        uint32_t x = LEFT;
+        while (x < RIGHT)
+        {
+            const uint32_t WORD = x / 64;
+            const uint32_t END = std::min(RIGHT, (WORD + 1) * 64);
+            uint64_t blueWord = 0;
+            uint64_t yellowWord = 0;
+            for (; x < END; x++)
+            {
+                const uint32_t COL = sampling.left + x * sampling.stepX;
+                const cone_detect::luma_bounds_t &chroma = bounds[(uint32_t) u[COL / 2] << 8 | v[COL / 2]];
+                const uint8_t LUMA = luma[COL];
+                blueWord |= (uint64_t) ((LUMA >= chroma.blueMin) & (LUMA <= chroma.blueMax)) << (x % 64);
+                yellowWord |= (uint64_t) ((LUMA >= chroma.yellowMin) & (LUMA <= chroma.yellowMax)) << (x % 64);
+            }
+            blueRow[WORD] |= blueWord;
+            yellowRow[WORD] |= yellowWord;
+        }
+    }
+}
+
+// The filters of the packed masks, compiled for every instruction set
+ISA_KERNEL(packBgraDeployed, packBgraRows,
+           (const uint8_t *bgra, size_t stride, const sampling_t &sampling, const cv::Rect &window,
+            const cone_detect::deployed_profile_t &profile, bit_mask::BitMask &blue, bit_mask::BitMask &yellow),
+           (bgra, stride, sampling, window, profile, blue, yellow))
+ISA_KERNEL(packBgraRuntime, packBgraRows,
+           (const uint8_t *bgra, size_t stride, const sampling_t &sampling, const cv::Rect &window,
+            const cone_detect::runtime_profile_t &profile, bit_mask::BitMask &blue, bit_mask::BitMask &yellow),
+           (bgra, stride, sampling, window, profile, blue, yellow))
+ISA_KERNEL(packI420, packI420Rows,
+           (const uint8_t *i420, size_t stride, uint32_t height, const sampling_t &sampling, const cv::Rect &window,
+            const cone_detect::luma_bounds_t *bounds, bit_mask::BitMask &blue, bit_mask::BitMask &yellow),
+           (i420, stride, height, sampling, window, bounds, blue, yellow))
+
+cone_detect::ConeDetector::ConeDetector(const cone_detect::config_t &config,
+                                        std::shared_ptr<const std::vector<luma_bounds_t>> lumaBounds)
+    : m_config(config),
+      m_contextTop(config.roiTop > CONTEXT_ROWS ? config.roiTop - CONTEXT_ROWS : 0),
+      m_contextBottom(std::min(config.roiBottom + CONTEXT_ROWS, config.height)),
+      m_roiRows((int) (config.roiTop - m_contextTop), (int) (config.roiBottom - m_contextTop)),
+      m_roiCols((int) config.roiLeft, (int) config.roiRight),
+      m_kernel(cv::getStructuringElement(cv::MORPH_RECT, cv::Size(config.closeSize, config.closeSize))),
+      m_pool(),
+      m_hsv(),
+      m_blue(),
+      m_yellow(),
+      m_bitsTmp(config.roiRight - config.roiLeft, config.roiBottom - config.roiTop),
+      m_bitsTmp2(config.roiRight - config.roiLeft, config.roiBottom - config.roiTop),
+      m_blobExtractor(),
+      m_tracks(TRACKS, cone_track::Track{config.track}),
+      m_windows(),
+      m_framesSinceScan(0),
+      m_rescan(true),
+      m_quality(FULL),
+      m_stepX(1),
+      m_stepY(1),
+      m_offsetY(0),
+      m_deployed(!config.generic &&
+                 sameRange(config.blue, deployed_profile_t::blue()) &&
+                 sameRange(config.yellow, deployed_profile_t::yellow())),
+      m_lumaBounds(std::move(lumaBounds)),
+      m_profile(nullptr),
+      m_lap(),
+      m_lapCounts()
+{
+    // The windows are only looked for in the packed masks
+    m_config.packed = config.packed || config.tracking || config.i420;
+
+    // The images are only used to find the edges, never with the packed masks
+    const int ROWS = (int) (m_contextBottom - m_contextTop);
+    const int COLS = (int) config.width;
+    if (!m_config.packed && config.hugePages != huge_pages::NONE)
+    {
+        // The HSV image and the mask, masked and gray images of both colours
+        const size_t PIXELS = (size_t) ROWS * (size_t) COLS;
+        m_pool.reset(new huge_pages::Pool(PIXELS * (3 + 2 * (1 + 3 + 1)) + 7 * 64, config.hugePages));
+    }
+    if (!m_config.packed)
+    {
+        m_hsv = image(ROWS, COLS, CV_8UC3);
+    }
+    m_config.downscale = std::max(config.downscale, 1u);
+    // The packed masks can't be closed with a wider square
+    m_config.closeSize = std::min(config.closeSize, (int32_t) bit_mask::MAX_WIDTH);
+    m_windows.reserve(TRACKS);
+    setQuality(FULL);
+
+    m_blue.lower = cv::Scalar(config.blue.minH, config.blue.minS, config.blue.minV);
+    m_blue.upper = cv::Scalar(config.blue.maxH, config.blue.maxS, config.blue.maxV);
+    m_yellow.lower = cv::Scalar(config.yellow.minH, config.yellow.minS, config.yellow.minV);
+    m_yellow.upper = cv::Scalar(config.yellow.maxH, config.yellow.maxS, config.yellow.maxV);
+
+    for (colour_t *colour : {&m_blue, &m_yellow})
+    {
+        if (!m_config.packed)
+        {
+            colour->mask = image(ROWS, COLS, CV_8UC1);
+            colour->masked = image(ROWS, COLS, CV_8UC3);
+            colour->gray = image(ROWS, COLS, CV_8UC1);
+        }
+        colour->contours.reserve(RESERVED_CONTOURS);
+        colour->areas.reserve(RESERVED_CONTOURS);
+        colour->bits = bit_mask::BitMask(config.roiRight - config.roiLeft, config.roiBottom - config.roiTop);
+        colour->blobsFound.reserve(RESERVED_CONTOURS);
+        colour->spareBoxes.reserve(RESERVED_CONTOURS);
+    }
+
+    if (config.i420 && !m_lumaBounds)
+    {
+        m_lumaBounds = boundLumas();
+    }
+}
+
+void cone_detect::ConeDetector::detect(const uint8_t *frame, size_t stride, cone_detect::detections_t &detections)
+{
+    if (m_profile != nullptr)
+    {
+        m_profile->frames++;
+        m_lap = std::chrono::steady_clock::now();
+        if (m_profile->counters != nullptr)
+        {
+            m_lapCounts = m_profile->counters->read();
+        }
+    }
+
+    // The edges are only found in the whole region at full resolution
+    if (!m_config.packed && m_config.scanlines == 0 && m_stepX == 1 && m_stepY == 1)
+    {
+        // Only the region and the rows around it are converted, the
+        // rest of the frame is never looked at
+        const cv::Mat context((int) (m_contextBottom - m_contextTop), (int) m_config.width, CV_8UC4,
+                              const_cast<uint8_t *>(frame + m_contextTop * stride), stride);
+        cv::cvtColor(context, m_hsv, cv::COLOR_BGR2HSV);
+        lap(CONVERT);
+
+        detectColour(m_blue, detections.blue);
+        detectColour(m_yellow, detections.yellow);
+        return;
+    }
+    lap(CONVERT);
+
+    // The masks have a pixel for every sampled pixel of the region
+    const uint32_t WIDTH = (m_config.roiRight - m_config.roiLeft + m_stepX - 1) / m_stepX;
+    const uint32_t HEIGHT = (m_config.roiBottom - m_config.roiTop - m_offsetY + m_stepY - 1) / m_stepY;
+    for (bit_mask::BitMask *mask : {&m_blue.bits, &m_yellow.bits, &m_bitsTmp, &m_bitsTmp2})
+    {
+        mask->resize(WIDTH, HEIGHT);
+    }
+    m_blue.bits.clear();
+    m_yellow.bits.clear();
+
+    // A tracking detector only looks at the windows around the tracked
+    // cones, and at the whole region every so often or when it lost one
+    const bool TRACKING = m_config.tracking || m_quality == WINDOWS;
+    if (TRACKING && !scanDue())
+    {
+        predictWindows();
+        for (const cv::Rect &window : m_windows)
+        {
+            pack(frame, stride, window);
+        }
+        m_framesSinceScan++;
+    }
+    else
+    {
+        pack(frame, stride, cv::Rect(0, 0, (int) WIDTH, (int) HEIGHT));
+        m_framesSinceScan = 0;
+        m_rescan = false;
+    }
+    lap(MASK);
+    detectPacked(m_blue, detections.blue);
+    detectPacked(m_yellow, detections.yellow);
+
+    if (TRACKING)
+    {
+        track(detections);
+    }
+}
+
+const std::vector<std::vector<cv::Point>> &cone_detect::ConeDetector::blueContours() const
+{
+    return m_blue.contours;
+}
+
+const std::vector<std::vector<cv::Point>> &cone_detect::ConeDetector::yellowContours() const
+{
+    return m_yellow.contours;
+}
+
+void cone_detect::ConeDetector::setProfile(cone_detect::profile_t *profile)
+{
+    m_profile = profile;
+}
+
+void cone_detect::ConeDetector::setQuality(cone_detect::Quality quality)
+{
+    // The tracks of a detector that only tracks in WINDOWS would be
+    // stale by the time it gets back to it
+    if (!m_config.tracking && m_quality == WINDOWS && quality != WINDOWS)
+    {
+        for (cone_track::Track &cone : m_tracks)
+        {
+            cone = cone_track::Track{m_config.track};
+        }
+    }
+
+    const uint32_t STEPS_X[QUALITY_COUNT] = {1, 2, 2, 2};
+    const uint32_t STEPS_Y[QUALITY_COUNT] = {1, 2, 4, 4};
+    m_quality = quality;
+    m_stepX = std::max(STEPS_X[quality], m_config.downscale);
+    m_stepY = std::max(STEPS_Y[quality], m_config.downscale);
+    m_offsetY = 0;
+
+    // The scanlines are the rows, each in the middle of its band of the region
+    if (m_config.scanlines > 0)
+    {
+        m_stepY = std::max((m_config.roiBottom - m_config.roiTop) / m_config.scanlines, 1u);
+        m_offsetY = m_stepY / 2;
+    }
+}
+
+cone_detect::Quality cone_detect::ConeDetector::quality() const
+{
+    return m_quality;
+}
+
+huge_pages::Backing cone_detect::ConeDetector::hugePages() const
+{
+    return m_pool ? m_pool->backing() : huge_pages::NONE;
+}
+
+std::shared_ptr<const std::vector<cone_detect::luma_bounds_t>> cone_detect::ConeDetector::lumaBounds() const
+{
+    return m_lumaBounds;
+}
+
+void cone_detect::ConeDetector::lap(cone_detect::Stage stage)
+{
+    if (m_profile == nullptr) return;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    m_profile->nanos[stage] += (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_lap).count();
+    m_lap = now;
+    if (m_profile->counters != nullptr)
+    {
+        perf_counters::counts_t counts = m_profile->counters->read();
+        perf_counters::accumulate(m_profile->counts[stage], m_lapCounts, counts);
+        m_lapCounts = counts;
+    }
+}
+
+cv::Mat cone_detect::ConeDetector::image(int rows, int cols, int type)
+{
+    uint8_t *data = m_pool ? m_pool->take((size_t) rows * (size_t) cols * CV_ELEM_SIZE(type)) : nullptr;
+    if (data != nullptr)
+    {
+        return cv::Mat(rows, cols, type, data);
+    }
+    return cv::Mat(rows, cols, type);
+}
+
+void cone_detect::ConeDetector::detectColour(colour_t &colour, cone_detect::side_t &side)
+{
+    // Keep the pixels within the range. The masked image is reused, so the
+    // pixels outside of the mask, which bitwise_and leaves as they are,
+    // are cleared first
+    cv::inRange(m_hsv, colour.lower, colour.upper, colour.mask);
+    colour.masked.setTo(cv::Scalar::all(0));
+    cv::bitwise_and(m_hsv, m_hsv, colour.masked, colour.mask);
+    cv::cvtColor(colour.masked, colour.gray, cv::COLOR_BGR2GRAY);
+    lap(MASK);
+
+    // Find the edges in the region and close the gaps between them
+    cv::Mat roi = colour.gray(m_roiRows, m_roiCols);
+    cv::Canny(roi, roi, m_config.cannyLow, m_config.cannyHigh);
+    lap(EDGES);
+    cv::morphologyEx(roi, roi, cv::MORPH_CLOSE, m_kernel);
+    lap(CLOSE);
+    findCones(roi, colour, side);
+}
+
+void cone_detect::ConeDetector::pack(const uint8_t *frame, size_t stride, const cv::Rect &window)
+{
+    const sampling_t SAMPLING{m_config.roiLeft, m_config.roiTop + m_offsetY, m_stepX, m_stepY};
+    if (m_config.i420)
+    {
+        packI420(frame, stride, m_config.height, SAMPLING, window, m_lumaBounds->data(), m_blue.bits, m_yellow.bits);
+    }
+    else if (m_deployed)
+    {
+        packBgraDeployed(frame, stride, SAMPLING, window, deployed_profile_t{}, m_blue.bits, m_yellow.bits);
+    }
+    else
+    {
+        packBgraRuntime(frame, stride, SAMPLING, window, runtime_profile_t{m_config.blue, m_config.yellow}, m_blue.bits, m_yellow.bits);
+    }
+}
+
+std::shared_ptr<const std::vector<cone_detect::luma_bounds_t>> cone_detect::ConeDetector::boundLumas() const
+{
+    // The hue of a chroma hardly changes with the luma, its saturation falls
+    // and its value rises, so the lumas within a range are (but for a few
+    // rounded away at the edges) one interval, from the lowest to the highest
+    std::shared_ptr<std::vector<luma_bounds_t>> lumaBounds = std::make_shared<std::vector<luma_bounds_t>>(256 * 256, luma_bounds_t{255, 0, 255, 0});
+    for (uint32_t chroma = 0; chroma < 256 * 256; chroma++)
+    {
+        luma_bounds_t &bounds = (*lumaBounds)[chroma];
+        for (int32_t y = 0; y < 256; y++)
+        {
+            uint8_t bgr[3];
+            uint8_t hsv[3];
+            yuvToBgr(y, (int32_t) (chroma >> 8), (int32_t) (chroma & 0xff), bgr);
+            bgrToHsv(bgr, hsv);
+            if (withinRange(hsv, m_config.blue))
+            {
+                bounds.blueMin = std::min(bounds.blueMin, (uint8_t) y);
+                bounds.blueMax = (uint8_t) y;
+            }
+            if (withinRange(hsv, m_config.yellow))
+            {
+                bounds.yellowMin = std::min(bounds.yellowMin, (uint8_t) y);
+                bounds.yellowMax = (uint8_t) y;
+            }
+        }
+    }
+    return lumaBounds;
+}
+
+bool cone_detect::ConeDetector::scanDue() const
+{
+    // Only tracking is all there's time for in WINDOWS
+    if (m_quality != WINDOWS && (m_rescan || m_framesSinceScan + 1 >= m_config.scanInterval)) return true;
+
+    // Without any tracked cones there are no windows to look in
+    for (const cone_track::Track &cone : m_tracks)
+    {
+        if (cone.valid()) return false;
+    }
+    return true;
+}
+
+void cone_detect::ConeDetector::predictWindows()
+{
+    const int WIDTH = (int) m_blue.bits.width();
+    const int HEIGHT = (int) m_blue.bits.height();
+    const int RADIUS = (int) m_config.trackWindow;
+
+    m_windows.clear();
+    for (const cone_track::Track &cone : m_tracks)
+    {
+        if (!cone.valid()) continue;
+
+        float x;
+        float y;
+        cone.predict(x, y);
+        const int LEFT = std::max((int) x - RADIUS, 0) / (int) m_stepX;
+        const int TOP = std::max((int) y - RADIUS - (int) m_offsetY, 0) / (int) m_stepY;
+        const int RIGHT = std::min(((int) x + RADIUS) / (int) m_stepX + 1, WIDTH);
+        const int BOTTOM = std::min(std::max((int) y + RADIUS - (int) m_offsetY, 0) / (int) m_stepY + 1, HEIGHT);
+        if (LEFT < RIGHT && TOP < BOTTOM)
+        {
+            m_windows.push_back(cv::Rect(LEFT, TOP, RIGHT - LEFT, BOTTOM - TOP));
+        }
+    }
+}
+
+void cone_detect::ConeDetector::track(cone_detect::detections_t &detections)
+{
+    cone_detect::side_t *sides[2] = {&detections.blue, &detections.yellow};
+    for (size_t s = 0; s < 2; s++)
+    {
+        cone_detect::side_t &side = *sides[s];
+        centroid_t *found[2] = {&side.close, &side.far};
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            cone_track::Track &cone = m_tracks[s * 2 + i];
+            if (side.count > i)
+            {
+                // A cone that jumped is another one, the windows may miss the tracked one
+                m_rescan = !cone.update(found[i]->x, found[i]->y) || m_rescan;
+            }
+            else
+            {
+                // A lost cone may have left its window
+                m_rescan = cone.valid() || m_rescan;
+                cone.miss();
+            }
+            if (cone.valid())
+            {
+                found[i]->x = cone.x();
+                found[i]->y = cone.y();
+            }
+        }
+
+        // A cone that wasn't found for a frame or two is still there
+        const uint32_t TRACKED = m_tracks[s * 2].valid() ? (m_tracks[s * 2 + 1].valid() ? 2 : 1) : 0;
+        side.count = std::max(side.count, TRACKED);
+    }
+}
+
+void cone_detect::ConeDetector::detectPacked(colour_t &colour, cone_detect::side_t &side)
+{
+    // The closing fills the gaps within the cones, e.g. the stripes,
+    // so a cone is one blob of the mask instead of edges around it
+    // The square shrinks with the sampling, keeping its size odd. Scanlines
+    // are further apart than it's high, so they're only closed along them
+    bit_mask::close(colour.bits, m_bitsTmp, m_bitsTmp2,
+                    ((uint32_t) m_config.closeSize / m_stepX) | 1, ((uint32_t) m_config.closeSize / m_stepY) | 1);
+    lap(CLOSE);
+
+    // The blobs are the cones, biggest first. Equal areas are ordered top
+    // to bottom, so the order doesn't depend on the sort
+    std::vector<blobs::blob_t> &found = colour.blobsFound;
+    m_blobExtractor.extract(colour.bits, found);
+    std::sort(found.begin(), found.end(), [](const blobs::blob_t &a, const blobs::blob_t &b) {
+        return a.area != b.area ? a.area > b.area : (a.top != b.top ? a.top < b.top : a.left < b.left);
+    });
+
+    // Their bounding boxes stand in for the contours, to be drawn. Like the
+    // centroids, they're scaled back from the sampled pixels to the region
+    // The boxes no longer found are set aside rather than freed, and taken
+    // back when there are more again, so their points aren't reallocated
+    const int STEP_X = (int) m_stepX;
+    const int STEP_Y = (int) m_stepY;
+    while (colour.contours.size() > found.size())
+    {
+        colour.spareBoxes.push_back(std::move(colour.contours.back()));
+        colour.contours.pop_back();
+    }
+    while (colour.contours.size() < found.size() && !colour.spareBoxes.empty())
+    {
+        colour.contours.push_back(std::move(colour.spareBoxes.back()));
+        colour.spareBoxes.pop_back();
+    }
+    colour.contours.resize(found.size());
+    for (size_t i = 0; i < found.size(); i++)
+    {
+        const int LEFT = (int) found[i].left * STEP_X;
+        const int TOP = (int) found[i].top * STEP_Y + (int) m_offsetY;
+        const int RIGHT = ((int) found[i].right - 1) * STEP_X;
+        const int BOTTOM = ((int) found[i].bottom - 1) * STEP_Y + (int) m_offsetY;
+        colour.contours[i].assign({cv::Point(LEFT, TOP), cv::Point(LEFT, BOTTOM), cv::Point(RIGHT, BOTTOM), cv::Point(RIGHT, TOP)});
+    }
+    lap(CONTOURS);
+
+    // The centroid of a blob is the mean of its pixels. The sampled pixels
+    // are every m_stepX column, so the mean of their columns times m_stepX
+    // is the mean of the columns of the region, to a fraction of a pixel
+    side.count = (uint32_t) found.size();
+    side.close = {0.0f, 0.0f};
+    side.far = {0.0f, 0.0f};
+    centroid_t *centroids[2] = {&side.close, &side.far};
+    for (size_t i = 0; i < std::min(found.size(), (size_t) 2); i++)
+    {
+        centroids[i]->x = (float) ((double) found[i].sumX * m_stepX / found[i].area);
+        centroids[i]->y = (float) ((double) found[i].sumY * m_stepY / found[i].area + m_offsetY);
+    }
+    lap(CENTROIDS);
+}
+
+void cone_detect::ConeDetector::findCones(cv::Mat &roi, colour_t &colour, cone_detect::side_t &side)
+{
+    cv::findContours(roi, colour.contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+    // Sort the contours by area, biggest first. The same selection sort
+    // as before, so equal areas end up in the same order, but every area
+    // is only calculated once and the contours are swapped, not copied
+    std::vector<std::vector<cv::Point>> &contours = colour.contours;
+    colour.areas.resize(contours.size());
+    for (size_t i = 0; i < contours.size(); i++)
+    {
+        colour.areas[i] = cv::contourArea(contours[i]);
+    }
+    for (size_t i = 0; i < contours.size(); i++)
+    {
+        size_t maxIndex = i;
+        for (size_t j = i + 1; j < contours.size(); j++)
+        {
+            if (colour.areas[j] > colour.areas[maxIndex])
+            {
+                maxIndex = j;
+            }
+        }
+        if (maxIndex != i)
+        {
+            std::swap(contours[i], contours[maxIndex]);
+            std::swap(colour.areas[i], colour.areas[maxIndex]);
+        }
+    }
+    lap(CONTOURS);
+
+    // Only the two biggest contours are used, so only their centroids are
+    // calculated. m10/m00 and m01/m00 are the mean x and y of the contour
+    side.count = (uint32_t) contours.size();
+    side.close = {0.0f, 0.0f};
+    side.far = {0.0f, 0.0f};
+    centroid_t *centroids[2] = {&side.close, &side.far};
+    for (size_t i = 0; i < std::min(contours.size(), (size_t) 2); i++)
+    {
+        cv::Moments moments = cv::moments(contours[i]);
+        centroids[i]->x = (float) (moments.m10 / moments.m00);
+        centroids[i]->y = (float) (moments.m01 / moments.m00);
+    }
+    lap(CENTROIDS);
+}
+
+hsv_tables_t makeHsvTables()
+{
+    hsv_tables_t tables{};
+    for (int32_t i = 1; i < 256; i++)
+    {
+        tables.saturation[i] = (int32_t) std::lround((255 << HSV_SHIFT) / (1.0 * i));
+        tables.hue[i] = (int32_t) std::lround((180 << HSV_SHIFT) / (6.0 * i));
+    }
+    return tables;
+}
@@ -0,0 +1,588 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_CONE_DETECT_HPP
+#define DIT639_2023_GROUP_13_CONE_DETECT_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// The bit-packed masks of the packed path and their blobs
+#include "bit-mask.hpp"
+#include "blobs.hpp"
+// The tracks of the cones between frames
+#include "cone-track.hpp"
+// The pools of huge pages the images can be taken from
+#include "huge-pages.hpp"
+// The hardware counters the stages can be counted with
+#include "../api/perf-counters.hpp"
+
+// Include the image processing header files from OpenCV
+#include <opencv2/imgproc/imgproc.hpp>
+
+/*
+ * The cone detection, from a BGRA or I420 frame to the positions
+ * of the two closest blue and yellow cones.
+ *
+ * A detector is configured once and then called for every
+ * frame. It has no global state and keeps all of its images
+ * from one frame to the next, so the live cone detector,
+ * the offline tools and the benchmarks all run the same
+ * code, and every thread can have a detector of its own.
+ *
+ * - hsv_range_t:  the HSV range a colour is filtered with
+ *
+ * - deployed_profile_t: the HSV ranges of both colours the
+ *                 detector is deployed with, at compile time
+ *
+ * - runtime_profile_t: any HSV ranges of both colours
+ *
+ * - luma_bounds_t: the lumas of a chroma within the HSV ranges
+ *
+ * - config_t:     the configuration of a detector
+ *
+ * - centroid_t:   the centroid of a cone
+ *
+ * - side_t:       the cones found of one colour
+ *
+ * - detections_t: the cones found in a frame
+ *
+ * - Stage:        the stages of the detection
+ *
+ * - profile_t:    the time spent in every stage
+ *
+ * - Quality:      the quality levels of the detection
+ *
+ * - ConeDetector: finds the cones in frames
+ */
+namespace cone_detect {
+
+    /**
+     * The range of HSV values a colour is filtered with,
+     * in OpenCV's ranges (H 0-180, S and V 0-255)
+     *
+     * @param minH the lowest hue
+     * @param minS the lowest saturation
+     * @param minV the lowest value
+     * @param maxH the highest hue
+     * @param maxS the highest saturation
+     * @param maxV the highest value
+     */
+    struct hsv_range_t {
+        uint8_t minH;
+        uint8_t minS;
+        uint8_t minV;
+        uint8_t maxH;
+        uint8_t maxS;
+        uint8_t maxV;
+    };
+
+    /*
+     * The HSV ranges the cone detector is deployed with, known at
+     * compile time. The packed masks of a detector with these ranges
+     * are filtered by a kernel of their own, which compares against
+     * constants instead of loading the ranges for every pixel.
+     */
+    struct deployed_profile_t {
+        static constexpr hsv_range_t blue()
+        {
+            return {90, 100, 23, 128, 179, 255};
+        }
+
+        static constexpr hsv_range_t yellow()
+        {
+            return {15, 100, 120, 35, 243, 255};
+        }
+    };
+
+    /*
+     * Any HSV ranges, known at run time, which the packed masks
+     * of the other detectors are filtered with
+     */
+    struct runtime_profile_t {
+        hsv_range_t blueRange;
+        hsv_range_t yellowRange;
+
+        hsv_range_t blue() const
+        {
+            return blueRange;
+        }
+
+        hsv_range_t yellow() const
+        {
+            return yellowRange;
+        }
+    };
+
+    /**
+     * The lumas of one chroma of an I420 frame that are within the
+     * HSV ranges of the colours, none if the lowest is above the
+     * highest
+     *
+     * @param blueMin the lowest luma of the blue range
+     * @param blueMax the highest luma of the blue range
+     * @param yellowMin the lowest luma of the yellow range
+     * @param yellowMax the highest luma of the yellow range
+     */
+    struct luma_bounds_t {
+        uint8_t blueMin;
+        uint8_t blueMax;
+        uint8_t yellowMin;
+        uint8_t yellowMax;
+    };
+
+    /**
+     * The configuration of a detector
+     *
+     * @param width the width of the frames in pixels
+     * @param height the number of rows of the frames
+     * @param roiLeft the first column the cones are looked for in
+     * @param roiRight the column after the last column
+     * @param roiTop the first row the cones are looked for in
+     * @param roiBottom the row after the last row
+     * @param blue the HSV range of the blue cones
+     * @param yellow the HSV range of the yellow cones
+     * @param cannyLow the lower threshold of the edge detection
+     * @param cannyHigh the upper threshold of the edge detection
+     * @param closeSize the size of the square that closes the
+     * gaps in the edges, in the packed masks at most
+     * bit_mask::MAX_WIDTH, which larger sizes are clamped to
+     * @param packed whether to find the cones in bit-packed masks
+     * of the colours, closed and without the edge detection,
+     * instead of in the edges of the masked images
+     * @param tracking whether to track the cones from frame to frame
+     * and only look for them around where they're predicted, which
+     * implies packed
+     * @param track the parameters of the tracks
+     * @param trackWindow the distance in pixels around a predicted
+     * cone it's looked for in
+     * @param scanInterval the frames after which the whole region is
+     * looked at again, to find the cones that aren't tracked yet
+     * @param downscale the columns and rows from one sampled pixel to
+     * the next at every quality level, e.g. 2 for half resolution,
+     * which finds the cones in the packed masks if above 1
+     * @param scanlines the number of evenly spaced rows of the region
+     * to only look at, or 0 to look at all of them (see downscale).
+     * The cones are put together from the runs of their colour on
+     * neighbouring lines, in the packed masks
+     * @param i420 whether the frames are in I420, which the decoder
+     * hands out as well, instead of BGRA. The colours are filtered by
+     * the lumas their HSV ranges have at every chroma, which implies
+     * packed
+     * @param generic whether to filter the packed masks with the
+     * kernel of any ranges even if they're a profile's, e.g. to
+     * compare the two
+     * @param hugePages the pages to back the images with, huge pages
+     * to miss the TLB less in the per-pixel kernels; unused when the
+     * masks are packed, which need no images
+     */
+    struct config_t {
+        uint32_t width;
+        uint32_t height;
+        uint32_t roiLeft;
+        uint32_t roiRight;
+        uint32_t roiTop;
+        uint32_t roiBottom;
+        hsv_range_t blue;
+        hsv_range_t yellow;
+        double cannyLow;
+        double cannyHigh;
+        int32_t closeSize;
+        bool packed;
+        bool tracking;
+        cone_track::filter_t track;
+        uint32_t trackWindow;
+        uint32_t scanInterval;
+        uint32_t downscale;
+        uint32_t scanlines;
+        bool i420;
+        bool generic;
+        huge_pages::Backing hugePages;
+    };
+
+    /**
+     * The centroid of a cone, relative to the top left
+     * corner of the region the cones are looked for in
+     *
+     * @param x the x coordinate in pixels
+     * @param y the y coordinate in pixels, growing downwards
+     */
+    struct centroid_t {
+        float x;
+        float y;
+    };
+
+    /**
+     * The cones found of one colour. The biggest one is
+     * taken to be the closest.
+     *
+     * @param count the number of cones found
+     * @param close the closest cone, if count is at least 1
+     * @param far the second closest cone, if count is at least 2
+     */
+    struct side_t {
+        uint32_t count;
+        centroid_t close;
+        centroid_t far;
+    };
+
+    /**
+     * The cones found in a frame
+     *
+     * @param blue the blue cones
+     * @param yellow the yellow cones
+     */
+    struct detections_t {
+        side_t blue;
+        side_t yellow;
+    };
+
+    /*
+     * The stages of the detection, in the order a frame
+     * passes through them
+     */
+    enum Stage {
+        // Converting the frame from BGR to HSV
+        CONVERT,
+
+        // Filtering the colour's HSV range into a mask. The
+        // packed masks are converted to HSV as they're filtered
+        MASK,
+
+        // Finding the edges in the mask
+        EDGES,
+
+        // Closing the gaps between the edges
+        CLOSE,
+
+        // Finding the contours, or the blobs of the packed
+        // masks, and sorting them by area
+        CONTOURS,
+
+        // Calculating the centroids of the closest cones
+        CENTROIDS,
+
+        // The number of stages
+        STAGE_COUNT
+    };
+
+    // The names of the stages, in the order of Stage
+    const char *const STAGE_NAMES[STAGE_COUNT] = {
+        "convert",
+        "mask",
+        "edges",
+        "close",
+        "contours",
+        "centroids"
+    };
+
+    /**
+     * The time spent in every stage, summed over frames
+     * and both colours, and what the hardware counted
+     *
+     * @param frames the number of frames
+     * @param nanos the time spent in each stage in nanoseconds
+     * @param counters the counters of the thread that detects, or
+     * nullptr to only time the stages
+     * @param counts the counts of each stage
+     */
+    struct profile_t {
+        uint64_t frames;
+        uint64_t nanos[STAGE_COUNT];
+        const perf_counters::Counters *counters;
+        perf_counters::counts_t counts[STAGE_COUNT];
+    };
+
+    /*
+     * The quality levels of the detection, from the best to the
+     * cheapest, which can be stepped through when the frames
+     * take too long. All but FULL find the cones in the packed
+     * masks, sampling the frame without resizing it first. A
+     * detector's downscale is the least sampling of every level.
+     */
+    enum Quality {
+        // The whole region at full resolution
+        FULL,
+
+        // Every other pixel of every other row
+        HALF,
+
+        // Every other pixel of every fourth row
+        ROWS,
+
+        // Like ROWS, but only in the windows around the tracked
+        // cones, unless there are none
+        WINDOWS,
+
+        // The number of levels
+        QUALITY_COUNT
+    };
+
+    // The names of the levels, in the order of Quality
+    const char *const QUALITY_NAMES[QUALITY_COUNT] = {
+        "full",
+        "half",
+        "rows",
+        "windows"
+    };
+
+    /*
+     * Finds the cones in frames. A detector is not thread
+     * safe, every thread needs a detector of its own. A
+     * detector that tracks the cones has to be given the
+     * frames in order.
+     */
+    class ConeDetector {
+       public:
+        /**
+         * Creates a detector and allocates all of its images
+         *
+         * @param config the configuration of the detector
+         * @param lumaBounds the luma bounds of the I420 frames
+         * of another detector with the same HSV ranges, which
+         * are shared instead of derived again, or nullptr
+         */
+        explicit ConeDetector(const config_t &config,
+                              std::shared_ptr<const std::vector<luma_bounds_t>> lumaBounds = nullptr);
+
+        ConeDetector(const ConeDetector &) = delete;
+        ConeDetector &operator=(const ConeDetector &) = delete;
+
+        /**
+         * Finds the cones in a frame
+         *
+         * @param frame the first byte of the frame, in BGRA, or of its
+         * Y plane in I420, followed by the U and V planes with half the
+         * rows and half the stride
+         * @param stride the number of bytes from one row to the next,
+         * of the Y plane in I420
+         * @param detections set to the cones that were found
+         */
+        void detect(const uint8_t *frame, size_t stride, detections_t &detections);
+
+        /**
+         * Gets the contours of the blue cones found by the last
+         * call to detect, biggest first, e.g. to draw them. The
+         * packed path has no contours, it has the bounding boxes
+         * of the blobs instead.
+         *
+         * @return the contours, relative to the region
+         */
+        const std::vector<std::vector<cv::Point>> &blueContours() const;
+
+        /**
+         * Gets the contours of the yellow cones found by the
+         * last call to detect, biggest first
+         *
+         * @return the contours, relative to the region
+         */
+        const std::vector<std::vector<cv::Point>> &yellowContours() const;
+
+        /**
+         * Sets where to add the time spent in every stage of
+         * the following calls to detect
+         *
+         * @param profile the profile to add to, or nullptr to
+         * stop timing the stages
+         */
+        void setProfile(profile_t *profile);
+
+        /**
+         * Sets the quality of the following calls to detect
+         *
+         * @param quality the quality level, FULL by default
+         */
+        void setQuality(Quality quality);
+
+        /**
+         * Gets the quality of the calls to detect
+         *
+         * @return the quality level
+         */
+        Quality quality() const;
+
+        /**
+         * Gets the pages the images are backed by, which may be
+         * less than configured if there are no huge pages free, and
+         * are the normal ones when the masks are packed, as there
+         * are no images then
+         *
+         * @return the backing of the images
+         */
+        huge_pages::Backing hugePages() const;
+
+        /**
+         * Gets the luma bounds of the I420 frames, to share them
+         * with the detectors of other cameras
+         *
+         * @return the luma bounds, or nullptr if the detector
+         * isn't configured for I420 frames
+         */
+        std::shared_ptr<const std::vector<luma_bounds_t>> lumaBounds() const;
+
+       private:
+        /*
+         * The images and vectors of one colour
+         */
+        struct colour_t {
+            cv::Scalar lower{};
+            cv::Scalar upper{};
+            cv::Mat mask{};
+            cv::Mat masked{};
+            cv::Mat gray{};
+            std::vector<std::vector<cv::Point>> contours{};
+            std::vector<double> areas{};
+            bit_mask::BitMask bits{0, 0};
+            std::vector<blobs::blob_t> blobsFound{};
+            std::vector<std::vector<cv::Point>> spareBoxes{};
+        };
+
+
+        /**
+         * Finds the cones of one colour in m_hsv
+         *
+         * @param colour the colour to find
+         * @param side set to the cones that were found
+         */
+        void detectColour(colour_t &colour, side_t &side);
+
+        /**
+         * Filters a rectangle of the region of a frame into the
+         * bit-packed masks of both colours, with the kernel of
+         * the frame's format and the colours' profile, for the
+         * selected instruction set
+         *
+         * @param frame the first byte of the frame, like detect
+         * @param stride the number of bytes from one row to the next
+         * @param window the rectangle, relative to the region and
+         * in the pixels of the masks, i.e. of every m_stepX column
+         * and m_stepY row
+         */
+        void pack(const uint8_t *frame, size_t stride, const cv::Rect &window);
+
+        /**
+         * Derives the lumas of every chroma that are within the
+         * HSV ranges of the colours
+         *
+         * @return the luma bounds, by U << 8 | V
+         */
+        std::shared_ptr<const std::vector<luma_bounds_t>> boundLumas() const;
+
+        /**
+         * Checks whether the whole region has to be looked at,
+         * or only the windows around the tracked cones
+         *
+         * @return whether the whole region has to be looked at
+         */
+        bool scanDue() const;
+
+        /**
+         * Sets m_windows to the windows around where the tracked
+         * cones are predicted, in the pixels of the masks
+         */
+        void predictWindows();
+
+        /**
+         * Updates the tracks with the cones found and replaces
+         * them with the tracked positions
+         *
+         * @param detections the cones found, set to the tracked ones
+         */
+        void track(detections_t &detections);
+
+        /**
+         * Finds the cones of one colour in its bit-packed mask
+         *
+         * @param colour the colour to find
+         * @param side set to the cones that were found
+         */
+        void detectPacked(colour_t &colour, side_t &side);
+
+        /**
+         * Finds the contours in the region of a colour's gray
+         * image and the centroids of the two biggest ones
+         *
+         * @param roi the region of the gray image, which is changed
+         * @param colour the colour to find
+         * @param side set to the cones that were found
+         */
+        void findCones(cv::Mat &roi, colour_t &colour, side_t &side);
+
+        /**
+         * Adds the time since the last lap to a stage, if
+         * the stages are timed
+         *
+         * @param stage the stage that has just been passed
+         */
+        void lap(Stage stage);
+
+        /**
+         * Creates an image, in the pool if there is one and it
+         * isn't used up
+         *
+         * @param rows the number of rows
+         * @param cols the number of columns
+         * @param type the type of the pixels
+         * @return the image
+         */
+        cv::Mat image(int rows, int cols, int type);
+
+        config_t m_config;
+        // The rows that are converted, the region and the rows around it
+        uint32_t m_contextTop;
+        uint32_t m_contextBottom;
+        cv::Range m_roiRows;
+        cv::Range m_roiCols;
+        cv::Mat m_kernel;
+        // The pool the images are taken from, if they're on huge pages
+        std::unique_ptr<huge_pages::Pool> m_pool;
+        cv::Mat m_hsv;
+        colour_t m_blue;
+        colour_t m_yellow;
+        // The masks the packed path closes the colours' masks with
+        bit_mask::BitMask m_bitsTmp;
+        bit_mask::BitMask m_bitsTmp2;
+        blobs::BlobExtractor m_blobExtractor;
+        // The tracks of bClose, bFar, yClose and yFar
+        std::vector<cone_track::Track> m_tracks;
+        // The windows of the tracked cones, relative to the region
+        std::vector<cv::Rect> m_windows;
+        uint32_t m_framesSinceScan;
+        // Set when a tracked cone was lost, to look at the whole region
+        bool m_rescan;
+        Quality m_quality;
+        // The columns and rows from one pixel of the packed masks to the
+        // next, and the row of the region of their first row
+        uint32_t m_stepX;
+        uint32_t m_stepY;
+        uint32_t m_offsetY;
+        // Whether the ranges are deployed_profile_t's
+        bool m_deployed;
+        // The luma bounds of the I420 frames, by U << 8 | V, which
+        // only ever are read, so detectors can share them
+        std::shared_ptr<const std::vector<luma_bounds_t>> m_lumaBounds;
+        profile_t *m_profile;
+        std::chrono::steady_clock::time_point m_lap;
+        perf_counters::counts_t m_lapCounts;
+    };
+} // !namespace cone_detect
+
+#endif // !DIT639_2023_GROUP_13_CONE_DETECT_HPP
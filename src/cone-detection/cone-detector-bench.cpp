@@ -0,0 +1,653 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Benchmarks the cone detection on captured or generated frames.
+// Generated frames have cones at known positions, so the accuracy
+// of the detection can be measured along with its speed, and how
+// it holds up against noise and dim lighting.
+
+// The cone detection to benchmark
+#include "cone-detect.hpp"
+// The frames captured with frame-capture
+#include "frame-store.hpp"
+
+// The selection of the instruction set of the kernels
+#include "isa.hpp"
+// The pools of huge pages the frames can be copied into
+#include "huge-pages.hpp"
+
+// The timing and reporting helpers
+#include "../api/bench.hpp"
+// The hardware counters
+#include "../api/perf-counters.hpp"
+
+// Include the single-file, header-only middleware libcluon for the command line parsing
+#include "../cluon-complete-v0.0.127.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+// The size of the frames the decoder hands out
+#define FRAME_WIDTH 640
+#define FRAME_HEIGHT 480
+
+// The region the cone detector looks for cones in
+#define ROI_LEFT 0
+#define ROI_RIGHT 640
+#define ROI_TOP 270
+#define ROI_BOTTOM 400
+
+// The colour of the asphalt, grey so it's outside of both HSV ranges
+#define ASPHALT 95
+
+/**
+ * A generated frame and where its cones are
+ *
+ * @param pixels the frame in BGRA
+ * @param blue the two closest blue cones and the number of them
+ * @param yellow the two closest yellow cones and the number of them
+ */
+struct generated_t {
+    cv::Mat pixels;
+    cone_detect::side_t blue;
+    cone_detect::side_t yellow;
+};
+
+/**
+ * The accuracy of the detection on generated frames
+ *
+ * @param sides the number of sides (a colour in a frame) checked
+ * @param hits the number of sides with their closest cones, up to
+ * two, found within the tolerance
+ * @param counted the number of sides with the right number of cones
+ * @param cones the number of cones of the sides that were hit
+ * @param errorSum the sum of the distances of those cones
+ * @param errorMax the largest distance of those cones
+ */
+struct accuracy_t {
+    uint64_t sides;
+    uint64_t hits;
+    uint64_t counted;
+    uint64_t cones;
+    double errorSum;
+    double errorMax;
+};
+
+// The number of allocations and the bytes allocated by
+// the process so far, counted by the malloc below
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> allocatedBytes{0};
+
+/**
+ * Generates a frame with cones at random positions
+ *
+ * @param cones the number of cones of each colour
+ * @param noise the standard deviation of the noise added to every channel
+ * @param light the factor the brightness of the frame is scaled by
+ * @param rng the random number generator to use
+ * @return the frame and where its cones are
+ */
+generated_t generate(uint32_t cones, double noise, double light, std::mt19937 &rng);
+
+/**
+ * Counts the detection of the cones of every frame once with the
+ * hardware counters
+ *
+ * @param detector the detector to detect the cones with
+ * @param inputs the frames
+ * @param stride the bytes from one row of a frame to the next
+ * @param counters the counters of this thread
+ * @return the counts of the whole pass
+ */
+perf_counters::counts_t countPass(cone_detect::ConeDetector &detector, const std::vector<const uint8_t *> &inputs, size_t stride,
+                                  const perf_counters::Counters &counters);
+
+/**
+ * Adds the counts per frame of the counters that are counted
+ *
+ * @param prefix the prefix of the names of the metrics
+ * @param counters the counters the counts are of
+ * @param counts the summed counts
+ * @param frames the number of frames they're summed over
+ * @param metrics the metrics to add to
+ */
+void addCounts(const std::string &prefix, const perf_counters::Counters &counters, const perf_counters::counts_t &counts,
+               uint64_t frames, std::vector<bench::metric_t> &metrics);
+
+/**
+ * Adds the metrics of an accuracy
+ *
+ * @param prefix the prefix of the names of the metrics
+ * @param accuracy the accuracy
+ * @param metrics the metrics to add to
+ */
+void addAccuracy(const std::string &prefix, const accuracy_t &accuracy, std::vector<bench::metric_t> &metrics);
+
+/**
+ * Checks the cones found of one colour against the generated ones,
+ * or the ones found by another detection
+ *
+ * @param found the cones that were found
+ * @param truth the cones that were generated
+ * @param tolerance the largest distance in pixels that counts as found
+ * @param accuracy the accuracy to add the result to
+ */
+void check(const cone_detect::side_t &found, const cone_detect::side_t &truth, double tolerance, accuracy_t &accuracy);
+
+// Main entry point
+int32_t main(int32_t argc, char **argv)
+{
+    auto cmdargs = cluon::getCommandlineArguments(argc, argv);
+    if (cmdargs.count("help"))
+    {
+        std::cerr << argv[0] << " benchmarks the cone detection on captured or generated frames." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " [--store=<frame store>] [--frames=<frames>] [--cones=<cones>] [--noise=<noise>] [--light=<light>]"
+                  << " [--tolerance=<pixels>] [--ops=<frames>] [--packed] [--track] [--quality=<level>] [--downscale=<1|2|4>] [--scanlines=<lines>] [--i420] [--generic] [--force-isa=<isa>] [--huge-pages=<pages>] [--json=<file>]" << std::endl;
+        std::cerr << "         --store: benchmark the frames of a frame store written by frame-capture, without accuracy" << std::endl;
+        std::cerr << "         --frames: number of frames to generate (int, default 32)" << std::endl;
+        std::cerr << "         --cones: number of cones of each colour per generated frame (int, default 4)" << std::endl;
+        std::cerr << "         --noise: standard deviation of the noise added to the generated frames (float, default 4)" << std::endl;
+        std::cerr << "         --light: factor the brightness of the generated frames is scaled by (float, default 1)" << std::endl;
+        std::cerr << "         --tolerance: largest distance in pixels of a found cone from a generated one (float, default 3)" << std::endl;
+        std::cerr << "         --ops: number of frames to time (int, default 2000)" << std::endl;
+        std::cerr << "         --packed: benchmark the detection in bit-packed masks" << std::endl;
+        std::cerr << "         --track: benchmark the detection with tracking, on the frames of a --store as the generated ones are unrelated" << std::endl;
+        std::cerr << "         --quality: benchmark the detection at one of the quality levels full, half, rows or windows (default: full)" << std::endl;
+        std::cerr << "         --downscale: benchmark the detection in every 2nd or 4th pixel of every 2nd or 4th row (default: 1)" << std::endl;
+        std::cerr << "         --scanlines: benchmark the detection on this many evenly spaced rows" << std::endl;
+        std::cerr << "         --i420: benchmark the detection on the frames converted to I420, like the decoder hands them out too" << std::endl;
+        std::cerr << "         --generic: benchmark the packed masks filtered with the kernel of any ranges instead of the deployed profile's" << std::endl;
+        std::cerr << "         --force-isa: benchmark the kernels compiled for generic, avx2 or neon instead of the best the CPU supports" << std::endl;
+        std::cerr << "         --huge-pages: benchmark the frames and images on transparent or explicit huge pages, against ordinary pages" << std::endl;
+        std::cerr << "         --json: file to write the results to as JSON" << std::endl;
+        std::cerr << "Example: " << argv[0] << " --cones=6 --noise=12 --light=0.6 --json=cone-detector.json" << std::endl;
+        return 1;
+    }
+
+    if (cmdargs.count("force-isa"))
+    {
+        try
+        {
+            isa::select(isa::parse(cmdargs["force-isa"]));
+        }
+        catch (const isa::IsaException &)
+        {
+            std::cerr << "The instruction set is unknown or unsupported" << std::endl;
+            return 1;
+        }
+    }
+    std::clog << "Running the " << isa::ISA_NAMES[isa::selected()] << " kernels" << std::endl;
+
+    huge_pages::Backing hugePages{huge_pages::NONE};
+    if (cmdargs.count("huge-pages"))
+    {
+        try
+        {
+            hugePages = huge_pages::parse(cmdargs["huge-pages"]);
+        }
+        catch (const huge_pages::HugePagesException &)
+        {
+            std::cerr << "The huge pages are unknown" << std::endl;
+            return 1;
+        }
+    }
+
+    // Every pixel, every 2nd or every 4th is sampled, and there can't be more scanlines than rows in the region
+    if (cmdargs.count("downscale"))
+    {
+        const int32_t DOWNSCALE{std::stoi(cmdargs["downscale"])};
+        if (DOWNSCALE != 1 && DOWNSCALE != 2 && DOWNSCALE != 4)
+        {
+            std::cerr << "Usage: --downscale=<1|2|4>, the step between the sampled pixels and rows" << std::endl;
+            return 1;
+        }
+    }
+    if (cmdargs.count("scanlines"))
+    {
+        const int32_t SCANLINES{std::stoi(cmdargs["scanlines"])};
+        if (SCANLINES < 0 || SCANLINES > ROI_BOTTOM - ROI_TOP)
+        {
+            std::cerr << "Usage: --scanlines=<lines>, 0 to " << ROI_BOTTOM - ROI_TOP << " rows of the region" << std::endl;
+            return 1;
+        }
+    }
+
+    const uint64_t OPS{cmdargs.count("ops") ? std::stoull(cmdargs["ops"]) : 2000};
+    const double TOLERANCE{cmdargs.count("tolerance") ? std::stod(cmdargs["tolerance"]) : 3.0};
+
+    // The frames to detect the cones in, as pointers so that
+    // captured frames are used straight from the store
+    std::vector<const uint8_t *> frames;
+    std::vector<generated_t> generated;
+    std::unique_ptr<frame_store::Reader> store;
+    cone_detect::config_t config{
+        FRAME_WIDTH, FRAME_HEIGHT,
+        ROI_LEFT, ROI_RIGHT, ROI_TOP, ROI_BOTTOM,
+        // The HSV ranges and thresholds the cone detector is deployed with
+        cone_detect::deployed_profile_t::blue(),
+        cone_detect::deployed_profile_t::yellow(),
+        50, 100, 5,
+        cmdargs.count("packed") != 0,
+        // The tracking the cone detector is deployed with
+        cmdargs.count("track") != 0,
+        {0.6f, 0.2f, 24.0f, 3},
+        40, 15,
+        cmdargs.count("downscale") ? (uint32_t) std::stoi(cmdargs["downscale"]) : 1,
+        cmdargs.count("scanlines") ? (uint32_t) std::stoi(cmdargs["scanlines"]) : 0,
+        cmdargs.count("i420") != 0,
+        cmdargs.count("generic") != 0,
+        hugePages
+    };
+
+    if (cmdargs.count("store"))
+    {
+        try
+        {
+            store.reset(new frame_store::Reader{cmdargs["store"]});
+        }
+        catch (const frame_store::StoreException &)
+        {
+            std::cerr << "Could not open the frame store" << std::endl;
+            return 1;
+        }
+        const frame_store::header_t &header = store->header();
+        if (header.frameCount == 0 || header.bytesPerPixel != 4 || header.rowBegin > ROI_TOP || header.rowEnd < ROI_BOTTOM)
+        {
+            std::cerr << "The frame store has no frames with rows " << ROI_TOP << " to " << ROI_BOTTOM << std::endl;
+            return 1;
+        }
+        config.width = header.width;
+        config.height = header.rowEnd - header.rowBegin;
+        config.roiTop = ROI_TOP - header.rowBegin;
+        config.roiBottom = ROI_BOTTOM - header.rowBegin;
+        for (uint64_t i = 0; i < header.frameCount; i++)
+        {
+            frames.push_back(store->frame(i));
+        }
+    }
+    else
+    {
+        const uint32_t FRAMES{cmdargs.count("frames") ? (uint32_t) std::stoi(cmdargs["frames"]) : 32};
+        const uint32_t CONES{cmdargs.count("cones") ? (uint32_t) std::stoi(cmdargs["cones"]) : 4};
+        const double NOISE{cmdargs.count("noise") ? std::stod(cmdargs["noise"]) : 4.0};
+        const double LIGHT{cmdargs.count("light") ? std::stod(cmdargs["light"]) : 1.0};
+
+        // Fixed seed, so every run times the same frames
+        std::mt19937 rng(13);
+        cv::theRNG().state = 13;
+        for (uint32_t i = 0; i < FRAMES; i++)
+        {
+            generated.push_back(generate(CONES, NOISE, LIGHT, rng));
+            frames.push_back(generated.back().pixels.data);
+        }
+    }
+
+    // The frames in I420, converted before anything is timed. The
+    // BGRA frames are still the ones at full resolution
+    std::vector<const uint8_t *> inputs = frames;
+    std::vector<cv::Mat> converted;
+    if (config.i420)
+    {
+        for (const uint8_t *&input : inputs)
+        {
+            cv::Mat i420;
+            cv::cvtColor(cv::Mat((int) config.height, (int) config.width, CV_8UC4, const_cast<uint8_t *>(input)), i420, cv::COLOR_BGRA2YUV_I420);
+            converted.push_back(i420);
+            input = i420.data;
+        }
+    }
+
+    const size_t STRIDE = config.i420 ? config.width : config.width * 4;
+    const uint64_t FRAME_COUNT = frames.size();
+
+    // The frames on huge pages too, copied before anything is timed. The
+    // ones on ordinary pages are kept to compare with
+    const size_t FRAME_BYTES = STRIDE * (config.i420 ? config.height * 3 / 2 : config.height);
+    std::vector<const uint8_t *> ordinaryInputs = inputs;
+    std::unique_ptr<huge_pages::Pool> framePool;
+    if (hugePages != huge_pages::NONE)
+    {
+        framePool.reset(new huge_pages::Pool{FRAME_BYTES * FRAME_COUNT + FRAME_COUNT * 64, hugePages});
+        for (const uint8_t *&input : inputs)
+        {
+            uint8_t *copy = framePool->take(FRAME_BYTES);
+            std::copy(input, input + FRAME_BYTES, copy);
+            input = copy;
+        }
+    }
+
+    cone_detect::ConeDetector detector{config};
+    if (hugePages != huge_pages::NONE)
+    {
+        std::clog << "The frames are on " << huge_pages::BACKING_NAMES[framePool->backing()] << " pages and the images on "
+                  << huge_pages::BACKING_NAMES[detector.hugePages()] << " pages" << std::endl;
+    }
+    for (uint8_t q = 0; q < cone_detect::QUALITY_COUNT; q++)
+    {
+        if (cmdargs.count("quality") && cmdargs["quality"] == cone_detect::QUALITY_NAMES[q])
+        {
+            detector.setQuality((cone_detect::Quality) q);
+        }
+    }
+    cone_detect::detections_t detections{};
+    std::vector<bench::result_t> results;
+    std::vector<bench::metric_t> metrics;
+
+    // The whole detection, frames per second is op/s
+    results.push_back(bench::measure("detect", OPS, [&](uint64_t i) {
+        detector.detect(inputs[i % FRAME_COUNT], STRIDE, detections);
+        bench::consume(detections.blue.close.x);
+    }));
+
+    // The allocations of one pass over the frames, once everything is warmed up
+    uint64_t allocationsBefore = allocations;
+    uint64_t bytesBefore = allocatedBytes;
+    for (uint64_t i = 0; i < FRAME_COUNT; i++)
+    {
+        detector.detect(inputs[i], STRIDE, detections);
+    }
+    metrics.push_back({"allocations_per_frame", (double) (allocations - allocationsBefore) / (double) FRAME_COUNT});
+    metrics.push_back({"allocated_bytes_per_frame", (double) (allocatedBytes - bytesBefore) / (double) FRAME_COUNT});
+
+    // What the hardware counts in the whole detection, and on huge pages how
+    // much of it there is on ordinary pages, along with the time it takes there
+    perf_counters::Counters counters;
+    if (!counters.any())
+    {
+        std::clog << "The hardware counters can't be read here" << std::endl;
+    }
+    addCounts("detect/", counters, countPass(detector, inputs, STRIDE, counters), FRAME_COUNT, metrics);
+    if (hugePages != huge_pages::NONE)
+    {
+        cone_detect::config_t ordinaryConfig = config;
+        ordinaryConfig.hugePages = huge_pages::NONE;
+        cone_detect::ConeDetector ordinary{ordinaryConfig};
+        results.push_back(bench::measure("detect/ordinary_pages", OPS, [&](uint64_t i) {
+            ordinary.detect(ordinaryInputs[i % FRAME_COUNT], STRIDE, detections);
+            bench::consume(detections.blue.close.x);
+        }));
+        addCounts("ordinary_pages/detect/", counters, countPass(ordinary, ordinaryInputs, STRIDE, counters), FRAME_COUNT, metrics);
+    }
+
+    // The time spent in every stage, timed separately so the
+    // timing of the stages doesn't add to the whole detection
+    cone_detect::profile_t profile{};
+    detector.setProfile(&profile);
+    for (uint64_t i = 0; i < OPS; i++)
+    {
+        detector.detect(inputs[i % FRAME_COUNT], STRIDE, detections);
+    }
+    detector.setProfile(nullptr);
+    for (uint8_t s = 0; s < cone_detect::STAGE_COUNT; s++)
+    {
+        double nsPerOp = (double) profile.nanos[s] / (double) profile.frames;
+        results.push_back({std::string("stage/") + cone_detect::STAGE_NAMES[s], profile.frames, nsPerOp, nsPerOp > 0 ? 1e9 / nsPerOp : 0});
+    }
+
+    // What the hardware counts in every stage, counted separately as reading
+    // the counters takes a system call, which would add to the times
+    if (counters.any())
+    {
+        cone_detect::profile_t counted{};
+        counted.counters = &counters;
+        detector.setProfile(&counted);
+        for (uint64_t i = 0; i < FRAME_COUNT; i++)
+        {
+            detector.detect(inputs[i], STRIDE, detections);
+        }
+        detector.setProfile(nullptr);
+        for (uint8_t s = 0; s < cone_detect::STAGE_COUNT; s++)
+        {
+            addCounts(std::string("stage/") + cone_detect::STAGE_NAMES[s] + "/", counters, counted.counts[s], counted.frames, metrics);
+        }
+    }
+
+    // The accuracy against the generated cones
+    if (!generated.empty())
+    {
+        accuracy_t accuracy{};
+        for (uint64_t i = 0; i < generated.size(); i++)
+        {
+            detector.detect(inputs[i], STRIDE, detections);
+            check(detections.blue, generated[i].blue, TOLERANCE, accuracy);
+            check(detections.yellow, generated[i].yellow, TOLERANCE, accuracy);
+        }
+        addAccuracy("accuracy/", accuracy, metrics);
+    }
+
+    // A cheaper detection is checked against the one at full resolution
+    // too, which works on captured frames as well as generated ones
+    if (config.downscale > 1 || config.scanlines > 0 || config.i420 || detector.quality() != cone_detect::FULL)
+    {
+        cone_detect::config_t fullConfig = config;
+        fullConfig.downscale = 1;
+        fullConfig.scanlines = 0;
+        fullConfig.i420 = false;
+        cone_detect::ConeDetector full{fullConfig};
+        cone_detect::detections_t expected{};
+        accuracy_t agreement{};
+        for (uint64_t i = 0; i < FRAME_COUNT; i++)
+        {
+            detector.detect(inputs[i], STRIDE, detections);
+            full.detect(frames[i], config.width * 4, expected);
+            check(detections.blue, expected.blue, TOLERANCE, agreement);
+            check(detections.yellow, expected.yellow, TOLERANCE, agreement);
+        }
+        addAccuracy("full_resolution/", agreement, metrics);
+    }
+
+    for (const bench::result_t &r : results)
+    {
+        bench::print(r, std::cout);
+    }
+    for (const bench::metric_t &m : metrics)
+    {
+        std::cout << m.name << ": " << m.value << std::endl;
+    }
+
+    if (cmdargs.count("json"))
+    {
+        std::ofstream json(cmdargs["json"]);
+        bench::printJson(results, metrics, json);
+    }
+    return 0;
+}
+
+generated_t generate(uint32_t cones, double noise, double light, std::mt19937 &rng)
+{
+    generated_t g{cv::Mat(FRAME_HEIGHT, FRAME_WIDTH, CV_8UC4, cv::Scalar(ASPHALT, ASPHALT, ASPHALT, 255)), {}, {}};
+
+    // A colour within each HSV range of the detector, converted to BGR
+    cv::Mat hsv(1, 2, CV_8UC3);
+    hsv.at<cv::Vec3b>(0, 0) = cv::Vec3b(110, 150, 180);
+    hsv.at<cv::Vec3b>(0, 1) = cv::Vec3b(25, 180, 220);
+    cv::Mat bgr;
+    cv::cvtColor(hsv, bgr, cv::COLOR_HSV2BGR);
+
+    // Every cone gets a band of rows of its own, so cones of a colour never
+    // overlap, and the closer (lower) a cone is the bigger it is
+    const double BAND = (double) (ROI_BOTTOM - ROI_TOP) / cones;
+    const double MAX_HEIGHT = BAND / 2 - 3;
+    for (uint8_t c = 0; c < 2; c++)
+    {
+        cone_detect::side_t &side = c == 0 ? g.blue : g.yellow;
+        const cv::Vec3b COLOUR = bgr.at<cv::Vec3b>(0, c);
+
+        // Blue cones on the left half, yellow cones on the right half
+        std::uniform_int_distribution<int> xDist(c == 0 ? 30 : FRAME_WIDTH / 2 + 30, c == 0 ? FRAME_WIDTH / 2 - 30 : FRAME_WIDTH - 30);
+        std::uniform_real_distribution<double> jitter(-0.15, 0.15);
+
+        double biggest = 0;
+        double second = 0;
+        for (uint32_t k = 0; k < cones; k++)
+        {
+            double y = ROI_TOP + BAND * (k + 0.5 + jitter(rng));
+            double closeness = (y - ROI_TOP) / (ROI_BOTTOM - ROI_TOP);
+            int height = std::max(3, (int) std::min(MAX_HEIGHT, 5 + 12 * closeness));
+            int width = std::max(3, height * 2 / 3);
+            cv::Point centre(xDist(rng), (int) y);
+            cv::ellipse(g.pixels, centre, cv::Size(width, height), 0, 0, 360,
+                        cv::Scalar(COLOUR[0], COLOUR[1], COLOUR[2], 255), -1, cv::LINE_8);
+
+            // The biggest cone is the closest one
+            double area = (double) width * height;
+            cone_detect::centroid_t centroid{(float) (centre.x - ROI_LEFT), (float) (centre.y - ROI_TOP)};
+            if (area > biggest)
+            {
+                side.far = side.close;
+                second = biggest;
+                side.close = centroid;
+                biggest = area;
+            }
+            else if (area > second)
+            {
+                side.far = centroid;
+                second = area;
+            }
+        }
+        side.count = cones;
+    }
+
+    // Dim or brighten the frame, then add the noise. The factor is
+    // compared with a tolerance only to keep -Wfloat-equal quiet
+    if (std::fabs(light - 1.0) > 1e-9)
+    {
+        g.pixels.convertTo(g.pixels, -1, light, 0);
+    }
+    if (noise > 0)
+    {
+        cv::Mat wide;
+        cv::Mat grain(g.pixels.size(), CV_16SC4);
+        cv::randn(grain, cv::Scalar::all(0), cv::Scalar::all(noise));
+        g.pixels.convertTo(wide, CV_16SC4);
+        wide += grain;
+        wide.convertTo(g.pixels, CV_8UC4);
+    }
+    return g;
+}
+
+perf_counters::counts_t countPass(cone_detect::ConeDetector &detector, const std::vector<const uint8_t *> &inputs, size_t stride,
+                                  const perf_counters::Counters &counters)
+{
+    cone_detect::detections_t detections{};
+    perf_counters::counts_t counts{};
+    perf_counters::counts_t start = counters.read();
+    for (const uint8_t *input : inputs)
+    {
+        detector.detect(input, stride, detections);
+    }
+    perf_counters::accumulate(counts, start, counters.read());
+    return counts;
+}
+
+void addCounts(const std::string &prefix, const perf_counters::Counters &counters, const perf_counters::counts_t &counts,
+               uint64_t frames, std::vector<bench::metric_t> &metrics)
+{
+    for (uint8_t c = 0; c < perf_counters::COUNTER_COUNT; c++)
+    {
+        if (counters.available((perf_counters::Counter) c) && frames > 0)
+        {
+            metrics.push_back({prefix + perf_counters::COUNTER_NAMES[c], (double) counts.values[c] / (double) frames});
+        }
+    }
+}
+
+void addAccuracy(const std::string &prefix, const accuracy_t &accuracy, std::vector<bench::metric_t> &metrics)
+{
+    metrics.push_back({prefix + "hit_rate", (double) accuracy.hits / (double) accuracy.sides});
+    metrics.push_back({prefix + "count_rate", (double) accuracy.counted / (double) accuracy.sides});
+    metrics.push_back({prefix + "mean_error_px", accuracy.cones > 0 ? accuracy.errorSum / (double) accuracy.cones : 0});
+    metrics.push_back({prefix + "max_error_px", accuracy.errorMax});
+}
+
+void check(const cone_detect::side_t &found, const cone_detect::side_t &truth, double tolerance, accuracy_t &accuracy)
+{
+    accuracy.sides++;
+    if (found.count == truth.count)
+    {
+        accuracy.counted++;
+    }
+
+    // Only the cones there are can be found, up to the two closest
+    const uint32_t CONES = std::min(truth.count, 2u);
+    if (found.count < CONES || (CONES == 0 && found.count > 0))
+    {
+        return;
+    }
+
+    const cone_detect::centroid_t *foundCones[2] = {&found.close, &found.far};
+    const cone_detect::centroid_t *truthCones[2] = {&truth.close, &truth.far};
+    double errors[2] = {0, 0};
+    for (uint32_t c = 0; c < CONES; c++)
+    {
+        errors[c] = std::hypot(foundCones[c]->x - truthCones[c]->x, foundCones[c]->y - truthCones[c]->y);
+        if (errors[c] > tolerance)
+        {
+            return;
+        }
+    }
+    accuracy.hits++;
+    accuracy.cones += CONES;
+    accuracy.errorSum += errors[0] + errors[1];
+    accuracy.errorMax = std::max(accuracy.errorMax, std::max(errors[0], errors[1]));
+}
+
+// Every allocation goes through malloc, OpenCV's included, so counting
+// them here catches all of them. The allocator of glibc does the work.
+extern "C" {
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *ptr, size_t size);
+    void *__libc_memalign(size_t alignment, size_t size);
+
+    void *malloc(size_t size)
+    {
+        allocations++;
+        allocatedBytes += size;
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        allocations++;
+        allocatedBytes += count * size;
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *ptr, size_t size)
+    {
+        allocations++;
+        allocatedBytes += size;
+        return __libc_realloc(ptr, size);
+    }
+
+    int posix_memalign(void **ptr, size_t alignment, size_t size)
+    {
+        allocations++;
+        allocatedBytes += size;
+        *ptr = __libc_memalign(alignment, size);
+        return *ptr == nullptr ? ENOMEM : 0;
+    }
+}
@@ -17,24 +17,66 @@
 
 //include section
 #include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <csignal>
 #include <ctime>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
 // Include the single-file, header-only middleware libcluon to create high-performance microservices
 #include "../cluon-complete-v0.0.127.hpp"
 // Include the OpenDLV Standard Message Set that contains messages that are usually exchanged for automotive or robotic applications 
 #include "opendlv-standard-message-set.hpp"
 // include pos-api header file
 #include "../api/position.hpp"
-
-// Include the GUI and image processing header files from OpenCV
-#include <opencv2/highgui/highgui.hpp>
+// include the per-stage latency tracing
+#include "../api/trace.hpp"
+// include the frame store frames are replayed from
+#include "frame-store.hpp"
+// include the work-stealing pool the batch mode runs on
+#include "../api/work-pool.hpp"
+// include the cone detection
+#include "cone-detect.hpp"
+// include the controller that steps the quality of the cone detection down under load
+#include "qos.hpp"
+// include the selection of the instruction set the kernels of the cone detection run with
+#include "isa.hpp"
+// include the real-time mode
+#include "../api/realtime.hpp"
+// include the pools of huge pages the frame buffer can be taken from
+#include "huge-pages.hpp"
+// include the hardware counters the stages can be sampled with
+#include "../api/perf-counters.hpp"
+// include the statistics published for pipeline-top
+#include "../api/telemetry.hpp"
+// include the stream of what was found in every frame, which cone-viewer draws
+#include "overlay.hpp"
+// The per-frame steps, shared by one and several cameras
+#include "pipeline.hpp"
+// The pipelines of several cameras in one process
+#include "multi-camera.hpp"
+
+// The fused pipeline hands the cones straight to the steering calculation
+// instead of publishing them through the pos_api shared memory
+#ifdef FUSED_PIPELINE
+#include "../angle-calculator/steering.hpp"
+#endif
+
+// Include the image processing header files from OpenCV
 #include <opencv2/imgproc/imgproc.hpp>
 
 
 // Define section
 
-/* These are the min and max values for HSV that is used when filtering for blue and yellow color */
+/* These are the min and max values for HSV that is used when filtering for blue and yellow color, the same as
+   cone_detect::deployed_profile_t so the packed masks are filtered with its kernel */
 // Min HSV values for blue
 #define B_MIN_H 90
 #define B_MIN_S 100
@@ -63,6 +105,31 @@
 /* Default setting is that the y value is 0 at the top left corner of the image, this value is to set y as 0 in the bottom left corner */
 #define Y_TOTAL 110
 
+/* Thresholds for the Canny method */
+#define CANNY_HIGH_THRESH 100
+#define CANNY_LOW_THRESH 50
+
+/* The size of the square that closes the gaps between the edges of a cone */
+#define CLOSE_SIZE 5
+
+/* The tracking of the cones between frames: how much of the distance to a found cone its position
+   and velocity are moved by, how far from its prediction it can be found, in how many frames in a
+   row it can be missing, how far around its prediction it's looked for, and every how many frames
+   the whole region is looked at */
+#define TRACK_ALPHA 0.6f
+#define TRACK_BETA 0.2f
+#define TRACK_GATE 24.0f
+#define TRACK_MAX_MISSES 3
+#define TRACK_WINDOW 40
+#define TRACK_SCAN_INTERVAL 15
+
+/* The quality of the cone detection under load: the fraction of the deadline a frame has to take at most to step
+   the quality up, after how many late frames in a row it's stepped down and after how many frames within the
+   fraction it's stepped up */
+#define QOS_HEADROOM 0.5
+#define QOS_DOWN_FRAMES 3
+#define QOS_UP_FRAMES 30
+
 // Namespaces
 using cv::Mat;
 using std::cout;
@@ -70,61 +137,86 @@ using std::size_t;
 using std::endl;
 
 // Vartiable declaration
-int hiThresh = 100;        // for Canny method 
-int lowThresh = 50;        // for Canny method  
+bool tracing = false;      // whether stage latencies are traced
+bool realtimeMode = false; // whether the pipeline runs in real-time mode
+perf_counters::Counters *hwCounters = nullptr;  // the hardware counters of the pipeline, if frames are sampled
+cone_detect::profile_t countedProfile{};        // the counts of the stages of the sampled frames
+perf_counters::counts_t steerCounts{};          // the counts of the steering calculation of the sampled frames
+qos::Controller *qosController = nullptr;  // the quality-of-service controller, if there is a deadline
+telemetry::Publisher *publisher = nullptr; // the publisher of the statistics, if the segment could be created
+overlay::Writer *overlayWriter = nullptr;  // the writer of the overlay stream, in verbose mode
+bool multiCamera = false;                   // whether a pipeline runs for each of several cameras
+std::atomic<bool> stopping{false};         // whether a termination signal has stopped the pipelines
+std::mutex frameMutex;                      // guards frameMemory
+cluon::SharedMemory *frameMemory = nullptr; // the shared memory the pipeline of one camera waits for frames in, while it runs
 
 // Function declaration
 /**
- * This method clears the memory upon all termination events, such as ctrl+C or closing the terminal window
- * @param sig the type of termination signal
+ * This method reports and clears the memory upon all termination events, such as ctrl+C or closing the terminal window,
+ * once the pipelines have stopped
+ * @param code the exit code of the programme
+*/
+void handleExit(int32_t code);
+
+/**
+ * Waits on a thread of its own for a termination signal, which every other thread blocks, and stops the pipelines upon
+ * it, so they report and clean up as normal code
+ * @param signals the termination signals
 */
-void handleExit(int sig);
+void waitForExit(sigset_t signals);
 
 /**
- * Create masks of the original image.
- * The resulting blue/yellow mask is a binary mask which will have 1's where the pixels fall in the range of lower_bound and upper_bound, 
- * meaning the pixels will be white there, and 0 where they don't,
- * which means the pixels will be black there. 
- * @param imgHSV the original image in HSV-format
- * @param lower_bound the lower limit for the color range
- * @param upper_bound the upper limit for the color range
- * @param img_mask the resulting mask
+ * Opens a frame store to replay and checks that it holds the region the cones are looked for in.
+ * @param path the path of the frame store
+ * @return the opened store, or nullptr if it can't be used, which has been reported on std::cerr
 */
-Mat maskImg(Mat imgHSV, cv::Scalar lower_bound, cv::Scalar upper_bound, Mat img_mask);
+frame_store::Reader *openStore(const std::string &path);
 
 /**
- * Sorts the vectors holding the contours in descending order using selection sort.
- * @param contours the vector of contours to be sorted
+ * Detects the cones in every frame of a frame store, spread over all cores, and writes them to a file in frame order.
+ * @param path the path of the frame store
+ * @param out the path of the file to write the detections to
+ * @param threads the number of threads to use, 0 for one per core
+ * @param arguments the command line parameters, for the options of the cone detection
+ * @return the exit code of the programme
 */
-void sortContours(std::vector<std::vector<cv::Point>>& contours);
+int32_t runBatch(const std::string &path, const std::string &out, uint32_t threads,
+                 const std::map<std::string, std::string> &arguments);
 
 /**
- * This method iterates through the contours twice, the first time to find the moments of each contour. The second time ot calculates 
- * the centroid of the contour. 
- * @param moms vector to store the moments
- * @param centroids vector to store the centroids
- * @param contours the vector of contours
+ * Runs a pipeline for each of several cameras in one process, with the options of the command line.
+ * @param names the names of the cameras' shared memory areas
+ * @param arguments the command line parameters
+ * @return the exit code of the programme
 */
-void findCentroids(std::vector<cv::Moments>& moments, std::vector<cv::Point2f>& centroids, std::vector<std::vector<cv::Point>>& contours);
+int32_t runCameras(const std::vector<std::string> &names, std::map<std::string, std::string> &arguments);
 
 /**
- * This method puts a rectangle on each cone and then draws a line between the two closest cones.
- * @param contours vector of contours
- * @param centroids the vector with the centroids of the contours
- * @param imgContours the img to draw the contours on
- * @param img the original image where the line and rectangles will be drawm
+ * Splits a comma-separated list of a command line parameter.
+ * @param list the list
+ * @return the items of the list
 */
-void drawPath(std::vector<std::vector<cv::Point>>& contours, std::vector<cv::Point2f>& centroids, Mat imgContours, Mat img);
+std::vector<std::string> splitList(const std::string &list);
 
+/**
+ * Creates the configuration of the cone detection for frames of a given size.
+ * @param width the width of the frames
+ * @param height the number of rows of the frames
+ * @param rowOffset the row of the whole frame that the first row of the frames is
+ * @param arguments the command line parameters, for the options of the cone detection
+ * @return the configuration with the HSV ranges, region and thresholds defined above
+*/
+cone_detect::config_t detectorConfig(uint32_t width, uint32_t height, int32_t rowOffset,
+                                     const std::map<std::string, std::string> &arguments);
 
 /**
- * This method will populate the cone structs with the x and y coordinates for the two closest cones on one side.
- * @param coneClose the cone closest to the car
- * @param coneFar the cone second closest to the car
- * @param centroids the vector with the centroids of the cones
- * @param contoursSize the size of the vector with the contours
+ * This method fills what was found of one colour into a record of the overlay stream, for cone-viewer to draw.
+ * @param colour the colour of the record to fill
+ * @param contours the contours, or boxes of the blobs, biggest first
+ * @param side the cones found from the contours
 */
-void fillConePositions(pos_api::cone_t& coneClose, pos_api::cone_t& coneFar, std::vector<cv::Point2f> centroids, int contoursSize); 
+void fillOverlay(overlay::colour_t& colour, const std::vector<std::vector<cv::Point>>& contours, const cone_detect::side_t& side);
+
 
 // main function
 int32_t main(int32_t argc, char **argv) {
@@ -132,41 +224,193 @@ int32_t main(int32_t argc, char **argv) {
     int32_t retCode{1};
     // Parse the command line parameters as we require the user to specify some mandatory information on startup.
     auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
-    if ( (0 == commandlineArguments.count("cid")) ||
-         (0 == commandlineArguments.count("name")) ||
-         (0 == commandlineArguments.count("width")) ||
-         (0 == commandlineArguments.count("height")) ) {
+
+    // The kernels run with the best instruction set the CPU has, unless another one is forced
+    if (commandlineArguments.count("force-isa")) {
+        try {
+            isa::select(isa::parse(commandlineArguments["force-isa"]));
+        } catch (const isa::IsaException& e) {
+            std::cerr << (e == isa::IsaException::UNKNOWN ? "Unknown" : "Unsupported") << " instruction set '" << commandlineArguments["force-isa"] << "'" << std::endl;
+            return retCode;
+        }
+    }
+    std::clog << argv[0] << ": Running the " << isa::ISA_NAMES[isa::selected()] << " kernels." << std::endl;
+
+    // The frame buffer and the images of the detection can be backed by huge pages
+    if (commandlineArguments.count("huge-pages")) {
+        try {
+            huge_pages::parse(commandlineArguments["huge-pages"]);
+        } catch (const huge_pages::HugePagesException&) {
+            std::cerr << "Unknown huge pages '" << commandlineArguments["huge-pages"] << "'" << std::endl;
+            return retCode;
+        }
+    }
+
+    // Every pixel, every 2nd or every 4th is sampled, and there can't be more scanlines than rows in the region
+    if (commandlineArguments.count("downscale")) {
+        const int32_t DOWNSCALE{std::stoi(commandlineArguments["downscale"])};
+        if (DOWNSCALE != 1 && DOWNSCALE != 2 && DOWNSCALE != 4) {
+            std::cerr << "Usage: --downscale=<1|2|4>, the step between the sampled pixels and rows" << std::endl;
+            return retCode;
+        }
+    }
+    if (commandlineArguments.count("scanlines")) {
+        const int32_t SCANLINES{std::stoi(commandlineArguments["scanlines"])};
+        if (SCANLINES < 0 || SCANLINES > IMG_HEIGHT_MAX - IMG_HEIGHT_MIN) {
+            std::cerr << "Usage: --scanlines=<lines>, 0 to " << IMG_HEIGHT_MAX - IMG_HEIGHT_MIN << " rows of the region" << std::endl;
+            return retCode;
+        }
+    }
+
+    // The batch mode only detects the cones, it doesn't need anything else
+    if (commandlineArguments.count("batch") && commandlineArguments.count("out")) {
+        // No more threads than cores, 0 is one per core
+        int32_t threads{0};
+        if (commandlineArguments.count("threads")) {
+            threads = std::stoi(commandlineArguments["threads"]);
+            if (threads < 0 || threads > static_cast<int32_t>(std::max(std::thread::hardware_concurrency(), 1u))) {
+                std::cerr << "Number of threads out of bounds" << std::endl;
+                return retCode;
+            }
+        }
+        return runBatch(commandlineArguments["batch"], commandlineArguments["out"], static_cast<uint32_t>(threads), commandlineArguments);
+    }
+
+    // A replayed frame store replaces the shared memory and the OD4 session
+    const bool REPLAY{commandlineArguments.count("replay") != 0};
+    // Several comma-separated shared memory areas are several cameras
+    const std::vector<std::string> CAMERAS{splitList(commandlineArguments.count("i420") ? commandlineArguments["i420"] : commandlineArguments["name"])};
+    if ( (!REPLAY && (0 == commandlineArguments.count("cid"))) ||
+         (!REPLAY && (0 == commandlineArguments.count("name")) && (0 == commandlineArguments.count("i420"))) ||
+         (!REPLAY && (0 == commandlineArguments.count("width"))) ||
+#ifdef FUSED_PIPELINE
+         (0 == commandlineArguments.count("z")) ||
+         (0 == commandlineArguments.count("m")) ||
+         (0 == commandlineArguments.count("y")) ||
+         (0 == commandlineArguments.count("l")) ||
+         (0 == commandlineArguments.count("b")) ||
+#endif
+         (!REPLAY && (0 == commandlineArguments.count("height"))) ) {
         std::cerr << argv[0] << " attaches to a shared memory area containing an ARGB image." << std::endl;
-        std::cerr << "Usage:   " << argv[0] << " --cid=<OD4 session> --name=<name of shared memory area> [--verbose]" << std::endl;
+#ifdef FUSED_PIPELINE
+        std::cerr << "It calculates the steering value in-process instead of publishing the cones to the angle calculator." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --cid=<OD4 session> --name=<name of shared memory area> --z=<threshold for non-zero values> --m=<threshold for max value>"
+                  << " --y=<origin y value offset> --l=<endpoint offset for default lines> --b=<angle calculation offset> [--verbose] [--fast] [--trace] [--packed] [--track] [--deadline=<us>] [--downscale=<1|2|4>] [--scanlines=<lines>] [--force-isa=<isa>] [--huge-pages=<pages>] [--counters=<frames>] [--i420=<name of I420 shared memory area>] [--realtime [--core=<core>] [--priority=<priority>]]" << std::endl;
+        std::cerr << "         " << argv[0] << " --replay=<frame store> --z=... --m=... --y=... --l=... --b=... [--unpaced] [--verbose] [--fast] [--trace] [--packed] [--track] [--deadline=<us>] [--downscale=<1|2|4>] [--scanlines=<lines>] [--force-isa=<isa>]" << std::endl;
+#else
+        std::cerr << "Usage:   " << argv[0] << " --cid=<OD4 session> --name=<name of shared memory area> [--verbose] [--trace] [--packed] [--track] [--deadline=<us>] [--downscale=<1|2|4>] [--scanlines=<lines>] [--force-isa=<isa>] [--huge-pages=<pages>] [--counters=<frames>] [--i420=<name of I420 shared memory area>] [--realtime [--core=<core>] [--priority=<priority>]]" << std::endl;
+        std::cerr << "         " << argv[0] << " --replay=<frame store> [--unpaced] [--verbose] [--trace] [--packed] [--track] [--deadline=<us>] [--downscale=<1|2|4>] [--scanlines=<lines>] [--force-isa=<isa>]" << std::endl;
+        std::cerr << "         " << argv[0] << " --cid=<OD4 session> --name=<name>,<name>... [--channels=<name>,<name>...] [--cores=<core>,<core>...] [--packed] [--track] [--deadline=<us>] [--downscale=<1|2|4>] [--scanlines=<lines>] [--force-isa=<isa>] [--huge-pages=<pages>] [--i420=<name>,<name>...] [--realtime [--priority=<priority>]]" << std::endl;
+#endif
+        std::cerr << "         " << argv[0] << " --batch=<frame store> --out=<file> [--threads=<number of threads>] [--packed] [--downscale=<1|2|4>] [--scanlines=<lines>] [--force-isa=<isa>]" << std::endl;
         std::cerr << "         --cid:    CID of the OD4Session to send and receive messages" << std::endl;
-        std::cerr << "         --name:   name of the shared memory area to attach" << std::endl;
+        std::cerr << "         --name:   name of the shared memory area to attach, or comma-separated names of several cameras to run a pipeline for each" << std::endl;
         std::cerr << "         --width:  width of the frame" << std::endl;
         std::cerr << "         --height: height of the frame" << std::endl;
+#ifdef FUSED_PIPELINE
+        std::cerr << "         --z: angle threshold for the algorithm to output non-zero values (float)" << std::endl;
+        std::cerr << "         --m: angle threshold for the algorithm to output the maximum value (float)" << std::endl;
+        std::cerr << "         --y: fraction to offset the origin's y value (float)" << std::endl;
+        std::cerr << "         --l: number of partitions to create from the frame to offset the default lines' ending point to (int)" << std::endl;
+        std::cerr << "         --b: angle to offset the angle calculation by (float)" << std::endl;
+        std::cerr << "         --fast: use the polynomial atan" << std::endl;
+#endif
+        std::cerr << "         --verbose: publish what was found in every frame for cone-viewer to draw" << std::endl;
+        std::cerr << "         --trace:  print the latency of each pipeline stage upon exiting" << std::endl;
+        std::cerr << "         --packed: find the cones as the blobs of closed bit-packed colour masks instead of in their edges" << std::endl;
+        std::cerr << "         --track:  track the cones between frames and mostly look for them around where they're predicted, implies --packed" << std::endl;
+        std::cerr << "         --deadline: time in microseconds a frame should take, the detection steps down to cheaper quality levels while frames are late" << std::endl;
+        std::cerr << "         --downscale: find the cones in every 2nd or 4th pixel of every 2nd or 4th row, implies --packed" << std::endl;
+        std::cerr << "         --scanlines: only look at this many evenly spaced rows and put the cones together from their runs" << std::endl;
+        std::cerr << "         --i420:   attach to the decoder's I420 image of this name (or those of several cameras) instead of --name and find the cones in YUV, implies --packed" << std::endl;
+        std::cerr << "         --force-isa: run the kernels compiled for generic, avx2 or neon instead of the best the CPU supports" << std::endl;
+        std::cerr << "         --huge-pages: back the frame buffer and the images of the detection with transparent or explicit huge pages" << std::endl;
+        std::cerr << "         --counters: count one in this many frames with the CPU's counters and print the counts of each stage upon exiting" << std::endl;
+        std::cerr << "         --realtime: run the pipeline with SCHED_FIFO and locked memory, and print the page faults upon exiting" << std::endl;
+        std::cerr << "         --core:   core to pin the pipeline to in real-time mode (default any)" << std::endl;
+        std::cerr << "         --priority: SCHED_FIFO priority in real-time mode (1 to 99, default 50)" << std::endl;
+        std::cerr << "         --channels: names of the pos_api shared memory of every camera (default position, position.1, position.2...)" << std::endl;
+        std::cerr << "         --cores:  cores to pin the pipelines of the cameras to, one each (default the first cores)" << std::endl;
+        std::cerr << "         --replay: read the frames from a frame store written by frame-capture instead" << std::endl;
+        std::cerr << "         --unpaced: replay the frames as fast as possible instead of at the recorded rate" << std::endl;
+        std::cerr << "         --batch:  detect the cones in every frame of a frame store on all cores and write them to --out" << std::endl;
+        std::cerr << "         --threads: number of threads of the batch mode, at most one per core (default: one per core)" << std::endl;
+#ifdef FUSED_PIPELINE
+        std::cerr << "Example: " << argv[0] << " --cid=253 --name=img --width=640 --height=480 --z=55 --m=75 --y=-0.5 --l=3 --b=0 --trace" << std::endl;
+#else
         std::cerr << "Example: " << argv[0] << " --cid=253 --name=img --width=640 --height=480 --verbose" << std::endl;
+#endif
         return retCode;
     }
 
-    // signal methods to handle termination events such as ctrl + C or closing the terminal window
-    signal(SIGINT, handleExit);
-    signal(SIGTERM, handleExit);
-    signal(SIGQUIT, handleExit);
-    signal(SIGHUP, handleExit);
+    // Termination events such as ctrl + C or closing the terminal window are taken by a thread of their own. The
+    // signals are blocked before any other thread is started, which inherit it, including the ones of the OD4 session
+    sigset_t exitSignals;
+    sigemptyset(&exitSignals);
+    for (int sig : {SIGINT, SIGTERM, SIGQUIT, SIGHUP}) {
+        sigaddset(&exitSignals, sig);
+    }
+    pthread_sigmask(SIG_BLOCK, &exitSignals, nullptr);
+    std::thread(waitForExit, exitSignals).detach();
+
+    // Every camera gets a pipeline of its own
+    if (!REPLAY && CAMERAS.size() > 1) {
+#ifdef FUSED_PIPELINE
+        std::cerr << argv[0] << " steers with the cones of one camera, run the cone detector for several" << std::endl;
+        return retCode;
+#else
+        return runCameras(CAMERAS, commandlineArguments);
+#endif
+    }
+
+    // Open the frame store to replay, its frames are used in place
+    std::unique_ptr<frame_store::Reader> store{REPLAY ? openStore(commandlineArguments["replay"]) : nullptr};
+    if (REPLAY && !store) {
+        return retCode;
+    }
 
     // Extract the values from the command line parameters
-    const std::string NAME{commandlineArguments["name"]};
-    const uint32_t WIDTH{static_cast<uint32_t>(std::stoi(commandlineArguments["width"]))};
-    const uint32_t HEIGHT{static_cast<uint32_t>(std::stoi(commandlineArguments["height"]))};
+    // The I420 image has less than half the bytes of the ARGB one to copy
+    const bool I420{!REPLAY && commandlineArguments.count("i420") != 0};
+    const std::string NAME{REPLAY ? commandlineArguments["replay"] : I420 ? commandlineArguments["i420"] : commandlineArguments["name"]};
+    const uint32_t WIDTH{REPLAY ? store->header().width : static_cast<uint32_t>(std::stoi(commandlineArguments["width"]))};
+    // A replayed frame only has the stored rows, starting at ROW_OFFSET
+    const uint32_t HEIGHT{REPLAY ? store->header().rowEnd - store->header().rowBegin : static_cast<uint32_t>(std::stoi(commandlineArguments["height"]))};
+    const int32_t ROW_OFFSET{REPLAY ? static_cast<int32_t>(store->header().rowBegin) : 0};
+    const bool PACED{commandlineArguments.count("unpaced") == 0};
     const bool VERBOSE{commandlineArguments.count("verbose") != 0};
-
-    // Attach to the shared memory.
-    std::unique_ptr<cluon::SharedMemory> sharedMemory{new cluon::SharedMemory{NAME}};
-    if (sharedMemory && sharedMemory->valid()) {
-        std::clog << argv[0] << ": Attached to shared memory '" << sharedMemory->name() << " (" << sharedMemory->size() << " bytes)." << std::endl;
+    tracing = commandlineArguments.count("trace") != 0;
+
+#ifdef FUSED_PIPELINE
+    // The steering calculation works on the cropped frame with the
+    // y axis flipped, i.e. the same frame the angle calculator gets
+    ang_calc::configure(
+        IMG_WIDTH_MAX - IMG_WIDTH_MIN,
+        Y_TOTAL,
+        std::stof(commandlineArguments["z"]),  // zeroThreshold
+        std::stof(commandlineArguments["m"]),  // maxThreshold
+        std::stof(commandlineArguments["y"]),  // originYOffset
+        std::stof(commandlineArguments["l"]),  // defaultLineOffset
+        std::stof(commandlineArguments["b"])   // angleBias
+    );
+    const bool FAST{commandlineArguments.count("fast") != 0};
+#endif
+
+    // Attach to the shared memory, unless the frames are replayed.
+    std::unique_ptr<cluon::SharedMemory> sharedMemory{REPLAY ? nullptr : new cluon::SharedMemory{NAME}};
+    if (REPLAY || (sharedMemory && sharedMemory->valid())) {
+        if (REPLAY) {
+            std::clog << argv[0] << ": Replaying " << store->header().frameCount << " frames from '" << NAME << "'." << std::endl;
+        } else {
+            std::clog << argv[0] << ": Attached to shared memory '" << sharedMemory->name() << " (" << sharedMemory->size() << " bytes)." << std::endl;
+        }
 
         // Interface to a running OpenDaVINCI session where network messages are exchanged.
         // The instance od4 allows you to send and receive messages.
-        cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))};
+        // A replay has no session, the ground steering is left at 0.
+        std::unique_ptr<cluon::OD4Session> od4{REPLAY ? nullptr : new cluon::OD4Session{static_cast<uint16_t>(std::stoi(commandlineArguments["cid"]))}};
 
+#ifndef FUSED_PIPELINE
         // We try to create a shared memory so the two microservices will be able to communicate
         // with eachother through shared memory
         try
@@ -185,9 +429,10 @@ int32_t main(int32_t argc, char **argv) {
             }
             handleExit(0);
         }
+#endif
 
         opendlv::proxy::GroundSteeringRequest gsr;
-        _Float32 gsrVal;
+        _Float32 gsrVal{0};
         std::mutex gsrMutex;
         auto onGroundSteeringRequest = [&gsr, &gsrMutex, &gsrVal](cluon::data::Envelope &&env){
             // The envelope data structure provide further details, such as sampleTimePoint as shown in this microseconds case:
@@ -200,182 +445,216 @@ int32_t main(int32_t argc, char **argv) {
         };
 
 
-        od4.dataTrigger(opendlv::proxy::GroundSteeringRequest::ID(), onGroundSteeringRequest);
-
-        // Endless loop; end the program by pressing Ctrl-C.
-        while (od4.isRunning()) {
+        if (od4) {
+            od4->dataTrigger(opendlv::proxy::GroundSteeringRequest::ID(), onGroundSteeringRequest);
+        }
 
-            // OpenCV data structure to hold an image.
-            Mat img;
-            //create a std::pair class template that stores a boolean and a timestamp
-            std::pair<bool, cluon::data::TimeStamp> sampleTimePoint;
+        // The cone detection, configured once for the size of the frames
+        cone_detect::config_t config{detectorConfig(WIDTH, HEIGHT, ROW_OFFSET, commandlineArguments)};
+        config.i420 = I420;
+        pipeline::camera_t camera{};
+        camera.name = NAME;
+        camera.region = {IMG_HEIGHT_MIN, IMG_HEIGHT_MAX, Y_TOTAL};
+        camera.sharedMemory = std::move(sharedMemory);
+        camera.detector.reset(new cone_detect::ConeDetector{config});
+
+        // The quality of the detection follows the load, if the frames have a deadline
+        if (commandlineArguments.count("deadline")) {
+            camera.controller.reset(new qos::Controller{{std::stoll(commandlineArguments["deadline"]), QOS_HEADROOM, QOS_DOWN_FRAMES, QOS_UP_FRAMES}});
+        }
+        qosController = camera.controller.get();
+
+        // One in every COUNTER_INTERVAL frames is counted with the hardware counters, of this thread
+        const uint64_t COUNTER_INTERVAL{commandlineArguments.count("counters") ? std::max(std::stoull(commandlineArguments["counters"]), 1ull) : 0};
+        std::unique_ptr<perf_counters::Counters> counters{COUNTER_INTERVAL > 0 ? new perf_counters::Counters{} : nullptr};
+        if (counters && !counters->any()) {
+            std::clog << argv[0] << ": The hardware counters can't be read here, no frames are counted." << std::endl;
+            counters.reset();
+        }
+        hwCounters = counters.get();
+        countedProfile.counters = hwCounters;
+        uint64_t frameNumber = 0;
+
+        // The frame copied out of the shared memory, allocated once and reused from frame to frame. An I420 frame has its three
+        // planes one after the other, as rows of bytes. The frame is on the same pages
+        // as the images of the detection
+        const int FRAME_ROWS{static_cast<int>(I420 ? HEIGHT * 3 / 2 : HEIGHT)};
+        const int FRAME_TYPE{I420 ? CV_8UC1 : CV_8UC4};
+        const size_t FRAME_BYTES{static_cast<size_t>(FRAME_ROWS) * WIDTH * CV_ELEM_SIZE(FRAME_TYPE)};
+        if (config.hugePages != huge_pages::NONE) {
+            camera.framePool.reset(new huge_pages::Pool{FRAME_BYTES, config.hugePages});
+        }
+        camera.frame = camera.framePool ? Mat(FRAME_ROWS, static_cast<int>(WIDTH), FRAME_TYPE, camera.framePool->take(FRAME_BYTES))
+                                        : Mat(FRAME_ROWS, static_cast<int>(WIDTH), FRAME_TYPE);
+        if (camera.framePool) {
+            std::clog << argv[0] << ": Backing the frame with " << huge_pages::BACKING_NAMES[camera.framePool->backing()] << " pages and the images of the detection with "
+                      << huge_pages::BACKING_NAMES[camera.detector->hugePages()] << " pages." << std::endl;
+        }
 
-            // Wait to receive a notification of a new frame.
-            sharedMemory->wait();
+        // Publish the statistics of every frame for pipeline-top, the pipeline runs the same without them
+        try {
+#ifdef FUSED_PIPELINE
+            camera.publisher.reset(new telemetry::Publisher{"angle-pilot", "angle-pilot"});
+#else
+            camera.publisher.reset(new telemetry::Publisher{"cone-detector", "cone-detector"});
+#endif
+            publisher = camera.publisher.get();
+        } catch (const telemetry::TelemetryException&) {
+            std::clog << argv[0] << ": Could not create the telemetry segment, no statistics are published." << std::endl;
+        }
 
-            // Lock the shared memory.
-            sharedMemory->lock();
-            {
-                // Copy the pixels from the shared memory into our own data structure.
-                // cv::Mat is a 2D matrix where HEIGHT is rows and WIDTH is columns, the pixeldata for the matrix is taken from
-                // the shared memory that has been created byt the decoder. so wrapped is a matrix that contains pixeldata of an image stored
-                // in a shared memory.
-                Mat wrapped(HEIGHT, WIDTH, CV_8UC4, sharedMemory->data());
-                // here a clone is made of the wrapped matrix, changes made to img will not affect wrapped and vice cersa
-                img = wrapped.clone();
-
-                // call getTimeSTamp method to get current timestamp returned as a std::pair
-                sampleTimePoint = sharedMemory->getTimeStamp();
+        // In verbose mode what was found in every frame is published for cone-viewer, which draws it
+        // on its own copy of the frame, so drawing and showing the frames doesn't slow the pipeline
+        std::unique_ptr<overlay::Writer> overlayStream;
+        if (VERBOSE) {
+            try {
+#ifdef FUSED_PIPELINE
+                overlayStream.reset(new overlay::Writer{"angle-pilot"});
+#else
+                overlayStream.reset(new overlay::Writer{"cone-detector"});
+#endif
+                overlayWriter = overlayStream.get();
+            } catch (const overlay::OverlayException&) {
+                std::clog << argv[0] << ": Could not create the overlay stream, nothing is published for cone-viewer." << std::endl;
             }
-            sharedMemory->unlock();
-        
-            // convert image to HSV format
-            Mat imgHSV;
-            cv::cvtColor(img, imgHSV, cv::COLOR_BGR2HSV);
-
-            // Crop original image
-            img = img(cv::Range(IMG_HEIGHT_MIN, IMG_HEIGHT_MAX), cv::Range(IMG_WIDTH_MIN, IMG_WIDTH_MAX));
-
-            // The ranges for blue and yellow filtering are set
-            cv::Scalar lower_blue = cv::Scalar(B_MIN_H, B_MIN_S, B_MIN_V);
-            cv::Scalar upper_blue = cv::Scalar(B_MAX_H, B_MAX_S, B_MAX_V);
-            cv::Scalar lower_yellow = cv::Scalar(Y_MIN_H, Y_MIN_S, Y_MIN_V);
-            cv::Scalar upper_yellow = cv::Scalar(Y_MAX_H, Y_MAX_S, Y_MAX_V);
-
-            // declare masks for blue and yellow
-            Mat blue_mask;
-            Mat yellow_mask;
-
-            // declare images that will hold the result of the masking operation
-            Mat result_blue, result_yellow; 
-
-            // create masks for blue and yellow
-            result_blue = maskImg(imgHSV, lower_blue, upper_blue, blue_mask);
-            result_yellow = maskImg(imgHSV, lower_yellow, upper_yellow, yellow_mask);
-
-            // create gray versions of the masked images
-            Mat result_blue_gray, result_yellow_gray;
-            cv::cvtColor(result_blue, result_blue_gray, cv::COLOR_BGR2GRAY);
-            cv::cvtColor(result_yellow, result_yellow_gray, cv::COLOR_BGR2GRAY);
-
-            // Crop images 
-            result_blue_gray = result_blue_gray(cv::Range(IMG_HEIGHT_MIN, IMG_HEIGHT_MAX), cv::Range(IMG_WIDTH_MIN, IMG_WIDTH_MAX));
-            result_yellow_gray = result_yellow_gray(cv::Range(IMG_HEIGHT_MIN, IMG_HEIGHT_MAX), cv::Range(IMG_WIDTH_MIN, IMG_WIDTH_MAX));
-                        
-            /** 
-             * The Canny method will find edges in an image using the Canny algorithm. It marks the edges and saves them in the gray masks Mat. 
-             * The thresholds are used for determining which edges to detect. 
-             * @param highThresh is used to identify "strong" edges in the image. Any edge with an intensity gradient magnitude above the threshold will be kept.
-             * @param lowThresh  is used to identify weak edges, any edges with an intensity gradient magnitude below loThresh will be discarded.
-             * Edges between low and high: any edge pixel that is connected to a strong edge pixel is also considered a strong edge pixel and is retained. 
-             */
-            cv::Canny(result_blue_gray, result_blue_gray, lowThresh, hiThresh);
-            cv::Canny(result_yellow_gray, result_yellow_gray, lowThresh, hiThresh);
-
-            // 2D dynamic arrays to store the points of the contours
-            std::vector<std::vector<cv::Point>> contours_blue;
-            std::vector<std::vector<cv::Point>> contours_yellow;
-            
-            // we create a structuring element 5x5 pixels large, with the shape of a rectangle. 
-            Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(5, 5));
-
-            /**
-             * This method is used to fill in gaps and holes of the contours in the image to make them more uniform.
-             * The structuring element performs this so called closing operation while 
-             * preserving the overall shape of the objects. 
-             * @param MORPH_CLOSE specifies that we want to do that kind of operation (i.e close the gaps) on the contours. 
-             * @param kernel the structuring element to be used
-             */
-            cv::morphologyEx(result_blue_gray, result_blue_gray, cv::MORPH_CLOSE, kernel);
-            cv::morphologyEx(result_yellow_gray, result_yellow_gray, cv::MORPH_CLOSE, kernel);
-
-
-            /** 
-             * Finds the contours of objects in the image. 
-             * @param RETR_EXTERNAL retrieves only the extreme outer contours. 
-             * @param CHAIN_APPROX_SIMPLE compresses horizontal, vertical, and diagonal segments and leaves only their end points. For example, an up-right rectangular contour is encoded with 4 points.
-             */
-            cv::findContours(result_blue_gray, contours_blue, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-            cv::findContours(result_yellow_gray, contours_yellow, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-            
-           // sort contours in descending order
-            sortContours(contours_blue);
-            sortContours(contours_yellow);
-
-            /** 
-             * Initializes the imgContours matrices to be the same size as their gray versions and with all pixels set to 0 i.e. black
-             * without doing this we get an error saying that the imgContours is not the right size
-             */
-            Mat imgContours_blue, imgContours_yellow;
-            imgContours_blue = Mat::zeros(result_blue_gray.size(), CV_8UC3);
-            imgContours_yellow = Mat::zeros(result_yellow_gray.size(), CV_8UC3);
-   
-            /**
-             * We define vectors of Moments called moms, the same size as the contours vectors.
-             * Moments are objects that will contain some information about each shape. We can use it to calculate area, orientation, size etc.,
-             * in our case we are interested in the centroid = geometric center of the object.
-             */ 
-             std::vector<cv::Moments> moms_blue(contours_blue.size());
-             std::vector<cv::Moments> moms_yellow(contours_yellow.size());
-             // declaration of vectors of Points to hold the centroids
-             std::vector<cv::Point2f> centroids_blue(contours_blue.size());
-             std::vector<cv::Point2f> centroids_yellow(contours_yellow.size());
-
-            // Calculate centroids of each blue and yellow shape
-            findCentroids(moms_blue, centroids_blue, contours_blue);
-            findCentroids(moms_yellow, centroids_yellow, contours_yellow);
-
-            // declare cone structs to hold the centroids x and y coordinate values of the cones
-            pos_api::cone_t bClose{};
-            pos_api::cone_t bFar{};
-            pos_api::cone_t yClose{};
-            pos_api::cone_t yFar{};
-            
-            // draw rectangles on top of cones as well as lines between them
-            drawPath(contours_blue, centroids_blue, imgContours_blue, img);
-            drawPath(contours_yellow, centroids_yellow, imgContours_yellow, img);
-
-            // extract x and y coordinate and populate the cone structs with them
-            fillConePositions(bClose, bFar, centroids_blue, contours_blue.size()); 
-            fillConePositions(yClose, yFar, centroids_yellow, contours_yellow.size()); 
-
-            // call the toMicroseconds function to get the timestamp converted to microseconds. 
-            int64_t microseconds = cluon::time::toMicroseconds(sampleTimePoint.second);
-
-            // Get the UNIX timestamp
-            int64_t t = cluon::time::toMicroseconds(cluon::time::now());
-
-            // Fill the struct with all the cordinates of the two closest yellow and blue cones, the UNIX timestamp, the video frame timestamp and
-            // the original ground steering values 
-            pos_api::data_t coneData {
-                bClose,
-                bFar,
-                yClose,
-                yFar,
-                {t},   
-                {microseconds},
-                gsrVal   
+        }
+
+        // The next frame to replay, and when the first one was replayed to pace the rest
+        uint64_t replayed = 0;
+        std::chrono::steady_clock::time_point replayStart;
+
+        // Everything is allocated and the session's threads are running, so the pipeline
+        // can enter the real-time mode, which also faults in the buffers and segments
+        if (commandlineArguments.count("realtime")) {
+            realtime::config_t rtConfig{
+                commandlineArguments.count("core") ? std::stoi(commandlineArguments["core"]) : -1,
+                commandlineArguments.count("priority") ? std::stoi(commandlineArguments["priority"]) : realtime::DEFAULT_PRIORITY
             };
+            try {
+                realtime::enter(rtConfig);
+            } catch (const realtime::RealtimeException& e) {
+                switch (e) {
+                    case realtime::RealtimeException::CORE:
+                        std::cerr << "Could not pin the pipeline to core " << rtConfig.core << std::endl;
+                        break;
+                    case realtime::RealtimeException::SCHEDULER:
+                        std::cerr << "Could not schedule the pipeline with SCHED_FIFO priority " << rtConfig.priority << std::endl;
+                        break;
+                    default:
+                        std::cerr << "Could not lock the memory" << std::endl;
+                }
+                pos_api::clear();
+                return retCode;
+            }
+            // OpenCV's threads would run on other cores without the pipeline's priority
+            cv::setNumThreads(0);
+            realtimeMode = true;
+            std::clog << argv[0] << ": Running in real-time mode." << std::endl;
+        }
 
+        // The cones of a frame are steered with in-process, or put into the shared memory for the angle calculator.
+        // A counted frame has the counts of its steering added to those of the stages
+        bool counted = false;
+#ifdef FUSED_PIPELINE
+        const std::function<void(const pos_api::data_t &)> HAND_OVER{[&counters, &counted, FAST](const pos_api::data_t &coneData) {
+            // hand the cone data straight to the steering calculation, there is no process to wake up
+            int64_t handedOver = trace::now();
+            perf_counters::counts_t steerStart{counted ? counters->read() : perf_counters::counts_t{}};
+            _Float32 outputVal = FAST ? ang_calc::calculateSteeringFast(coneData) : ang_calc::calculateSteering(coneData);
+            if (counted) {
+                perf_counters::accumulate(steerCounts, steerStart, counters->read());
+            }
+            int64_t steered = (tracing || publisher) ? trace::now() : 0;
+            if (tracing) {
+                trace::record(trace::HANDOFF, handedOver - coneData.now.micros);
+                trace::record(trace::STEER, steered - handedOver);
+            }
+            if (publisher) {
+                publisher->record(trace::HANDOFF, handedOver - coneData.now.micros);
+                publisher->record(trace::STEER, steered - handedOver);
+            }
+            std::cout << "group_13;" << coneData.vidTimestamp.micros << ";" << outputVal << std::endl;
+        }};
+#else
+        const std::function<void(const pos_api::data_t &)> HAND_OVER{[](const pos_api::data_t &coneData) {
             // put the cone data into the shared memory to be extracted by the steering calculator microservice
             pos_api::put(coneData);
-    //-------------------------------------------------^-----------------------------------------------------
+        }};
+#endif
 
-            // If you want to access the latest received ground steering, don't forget to lock the mutex:
-            {
-                std::lock_guard<std::mutex> lck(gsrMutex);
-                ////std::cout << "main: groundSteering = " << gsr.groundSteering() << std::endl;
+        // The pipeline is woken when it's stopped while it waits for a frame
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            frameMemory = camera.sharedMemory.get();
+        }
+
+        // Endless loop; end the program by pressing Ctrl-C. A replay ends after the last frame.
+        while (!stopping && (REPLAY ? replayed < store->header().frameCount : od4->isRunning())) {
+
+            // find the two closest cones of each colour, counting the stages of the sampled frames
+            counted = counters && frameNumber % COUNTER_INTERVAL == 0;
+            if (counted) {
+                camera.detector->setProfile(&countedProfile);
             }
 
-            // Display images on your screen.
-            if (VERBOSE) {
-                cv::imshow(sharedMemory->name().c_str(), img);
-                cv::waitKey(1);
-                cv::namedWindow("Blue", CV_WINDOW_AUTOSIZE);
-                cv::namedWindow("Yellow", CV_WINDOW_AUTOSIZE);
-                cv::imshow("Blue", imgContours_blue);
-                cv::imshow("Yellow", imgContours_yellow);
+            pipeline::times_t times;
+            if (REPLAY) {
+                // Wait until the frame is due, as it was when recorded
+                if (replayed == 0) {
+                    replayStart = std::chrono::steady_clock::now();
+                } else if (PACED) {
+                    std::this_thread::sleep_until(replayStart + std::chrono::microseconds(store->timestamp(replayed) - store->timestamp(0)));
+                }
+
+                // The detection only reads the frame, so it's used in place without a clone
+                times = pipeline::step(camera, trace::now(), store->frame(replayed), store->timestamp(replayed), gsrVal, HAND_OVER);
+                replayed++;
+            } else {
+                // Wait to receive a notification of a new frame.
+                camera.sharedMemory->wait();
+                if (stopping) {
+                    break;
+                }
+                times = pipeline::step(camera, trace::now(), nullptr, 0, gsrVal, HAND_OVER);
+            }
+
+            if (counted) {
+                camera.detector->setProfile(nullptr);
             }
+            if (tracing) {
+                trace::record(trace::CAPTURE, times.captured - times.woke);
+                trace::record(trace::DETECT, times.detected - times.captured);
+            }
+
+            // publish what was found for cone-viewer, after the cones have been handed on
+            if (overlayWriter) {
+                overlay::record_t record{};
+                record.frame = REPLAY ? replayed - 1 : frameNumber;
+                record.timestamp = times.timestamp;
+                record.left = IMG_WIDTH_MIN;
+                record.top = IMG_HEIGHT_MIN;
+                record.width = IMG_WIDTH_MAX - IMG_WIDTH_MIN;
+                record.height = IMG_HEIGHT_MAX - IMG_HEIGHT_MIN;
+                fillOverlay(record.blue, camera.detector->blueContours(), camera.detections.blue);
+                fillOverlay(record.yellow, camera.detector->yellowContours(), camera.detections.yellow);
+                overlayWriter->put(record);
+            }
+            frameNumber++;
+
+            // The first frame is done, the page faults are counted from here on
+            if (realtimeMode) {
+                realtime::markSteady();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            frameMemory = nullptr;
+        }
+
+        // The whole store was replayed or the pipeline was stopped, report as if interrupted
+        if (REPLAY || stopping) {
+            handleExit(0);
         }
     }
     retCode = 0;
@@ -385,111 +664,269 @@ int32_t main(int32_t argc, char **argv) {
     return retCode;
 }
 
-void handleExit(int sig)
+void handleExit(int32_t code)
 {
-    std::clog << std::endl << "Cleaning up..." << std::endl;
+    std::clog << std::endl;
+    if (tracing) {
+        trace::printStages(std::clog);
+    }
+    if (qosController != nullptr) {
+        qosController->print(std::clog);
+    }
+    // The pipelines have stopped, so none of them is still stepping its controller
+    if (multiCamera) {
+        multi_camera::print(std::clog);
+    }
+    // One camera runs on this thread, several cameras' faults are printed per camera
+    if (realtimeMode && !multiCamera) {
+        realtime::printFaults(realtime::faults(), std::clog);
+    }
+    if (hwCounters != nullptr) {
+        std::clog << "Hardware counts per counted frame, of " << countedProfile.frames << " frames:" << std::endl;
+        for (uint8_t s = 0; s < cone_detect::STAGE_COUNT; s++) {
+            hwCounters->print(cone_detect::STAGE_NAMES[s], countedProfile.counts[s], countedProfile.frames, std::clog);
+        }
+#ifdef FUSED_PIPELINE
+        hwCounters->print("steer", steerCounts, countedProfile.frames, std::clog);
+#endif
+    }
+    std::clog << "Cleaning up..." << std::endl;
+    if (publisher != nullptr) {
+        publisher->remove();
+    }
+    if (overlayWriter != nullptr) {
+        overlayWriter->remove();
+    }
+    if (multiCamera) {
+        multi_camera::remove();
+    }
     pos_api::clear();
     std::clog << "Exiting programme..." << std::endl;
-    exit(0);
+    exit(code);
 }
 
-Mat maskImg(Mat imgHSV, cv::Scalar lower_bound, cv::Scalar upper_bound, Mat img_mask)
-{   
-    Mat result;      // image to store the result of the operations
-    cv::inRange(imgHSV, lower_bound, upper_bound, img_mask);
-    
-    // comparing the masks to original images. We are using bitwise_and operation on the same images (imgHSV). However, we are including
-    // the blue and yellow mask, this means that only the pixels that are set to white in the blue or yellow mask will be evaluated in the coprresponding pixels of the 
-    // imgHSV by the bitwise_and operation, the rest of the pixels in the result will automatically be set to black.
-    cv::bitwise_and(imgHSV, imgHSV, result, img_mask);
-    return result;
-}
-
-void sortContours(std::vector<std::vector<cv::Point>>& contours) 
-{   
-    for(size_t i = 0; i < contours.size(); i++) {
-        size_t maxIndex = i;
-        double maxArea = cv::contourArea(contours[maxIndex]);
-        for(size_t j = i + 1; j < contours.size(); j++) {
-            double currentArea = cv::contourArea(contours[j]);
-            if(currentArea > maxArea) {
-                maxIndex = j;
-                maxArea = cv::contourArea(contours[j]);
+void waitForExit(sigset_t signals)
+{
+    int sig{0};
+    sigwait(&signals, &sig);
+    stopping = true;
+
+    // The pipelines of several cameras are stopped, the pipeline of one camera that waits for a frame is woken until
+    // it has left its loop, which also wakes the other readers of the camera once more. The notification may come
+    // before it waits, so it's repeated
+    multi_camera::stop();
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            if (frameMemory == nullptr) {
+                return;
             }
+            frameMemory->notifyAll();
         }
-        if(maxIndex != i) {
-            std::vector<cv::Point> temp = contours[i];
-            contours[i] = contours[maxIndex];
-            contours[maxIndex] = temp;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+frame_store::Reader *openStore(const std::string &path)
+{
+    frame_store::Reader *store;
+    try
+    {
+        store = new frame_store::Reader{path};
+    }
+    catch (const frame_store::StoreException& e)
+    {
+        switch (e)
+        {
+            case frame_store::StoreException::FORMAT:
+                std::cerr << "Not a frame store" << std::endl;
+                break;
+            default:
+                std::cerr << "Could not open the frame store" << std::endl;
         }
+        return nullptr;
+    }
+
+    // The store has to hold the whole region the cones are looked for in
+    const frame_store::header_t &header = store->header();
+    if (header.bytesPerPixel != 4 || header.width < IMG_WIDTH_MAX ||
+        header.rowBegin > IMG_HEIGHT_MIN || header.rowEnd < IMG_HEIGHT_MAX) {
+        std::cerr << "The frame store doesn't hold rows " << IMG_HEIGHT_MIN << " to " << IMG_HEIGHT_MAX << " of BGRA frames" << std::endl;
+        delete store;
+        return nullptr;
     }
+    return store;
 }
 
-void findCentroids(std::vector<cv::Moments>& moms, std::vector<cv::Point2f>& centroids, std::vector<std::vector<cv::Point>>& contours)
+int32_t runBatch(const std::string &path, const std::string &out, uint32_t threads,
+                 const std::map<std::string, std::string> &arguments)
 {
-    for(size_t i = 0; i < contours.size(); i++) {
-        moms[i] = cv::moments(contours[i]);
+    std::unique_ptr<frame_store::Reader> store{openStore(path)};
+    if (!store) {
+        return 1;
     }
-    // we loop through the moments and perform operations on them to get the centroid values 
-    for(size_t i = 0; i < contours.size(); i++) {
-            // m00: represents the total area of the contour. 
-            // m10: represents the sum of the x coordinates of all the pixels in the shape. 
-            // m01: represents the sum of the y coordinatese of all pixels in the shape. 
-            // m10/m00 gives us the average x coordinate of the shape which is also the x coordinate of the centroid
-            // m01/m00 gives us the average y coordinate of the shape which is also the y coordinate of the centroid  
-            // we create a Point out of the centroid x and y coordinates and store in centroids vector
-            // m10, m00, and m01 operations return double, so we cast to float
-        centroids[i] = cv::Point2f(static_cast<float>(moms[i].m10/moms[i].m00), static_cast<float>(moms[i].m01/moms[i].m00));
+    const frame_store::header_t &header = store->header();
+    const int32_t ROW_OFFSET{static_cast<int32_t>(header.rowBegin)};
 
+    // The threads of the pool are the only ones, OpenCV mustn't start its own on top of them
+    cv::setNumThreads(0);
+
+    // The detections of every frame, in frame order. It's raw memory
+    // because pos_api::data_t can't be assigned to, like in pos_api::put
+    std::vector<uint8_t> detections(header.frameCount * sizeof(pos_api::data_t));
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    // Every worker has a detector of its own
+    std::vector<std::unique_ptr<cone_detect::ConeDetector>> detectors;
+    for (uint32_t w = 0; w < threads; w++) {
+        cone_detect::config_t config = detectorConfig(header.width, header.rowEnd - header.rowBegin, ROW_OFFSET, arguments);
+        // The workers take the frames out of order, so they can't be tracked
+        config.tracking = false;
+        detectors.emplace_back(new cone_detect::ConeDetector{config});
     }
+
+    int64_t start = trace::now();
+    uint32_t used = work_pool::run(header.frameCount, threads, [&](uint32_t worker, uint64_t i) {
+        // Detection only reads the frame, so the threads can share the mapping
+        cone_detect::detections_t detected{};
+        detectors[worker]->detect(store->frame(i), header.width * 4, detected);
+
+        pos_api::cone_t bClose{};
+        pos_api::cone_t bFar{};
+        pos_api::cone_t yClose{};
+        pos_api::cone_t yFar{};
+        pipeline::fillConePositions(bClose, bFar, detected.blue, Y_TOTAL);
+        pipeline::fillConePositions(yClose, yFar, detected.yellow, Y_TOTAL);
+
+        pos_api::data_t coneData {
+            bClose,
+            bFar,
+            yClose,
+            yFar,
+            {0},
+            {store->timestamp(i)},
+            0
+        };
+        std::memcpy(&detections[i * sizeof(pos_api::data_t)], &coneData, sizeof(pos_api::data_t));
+    });
+    int64_t elapsed = trace::now() - start;
+
+    // One line per frame, so two runs can be compared with diff
+    std::ofstream file(out);
+    file << "frame;vidTimestamp;bCloseX;bCloseY;bFarX;bFarY;yCloseX;yCloseY;yFarX;yFarY" << std::endl;
+    for (uint64_t i = 0; i < header.frameCount; i++) {
+        const pos_api::data_t &d = *reinterpret_cast<const pos_api::data_t *>(&detections[i * sizeof(pos_api::data_t)]);
+        file << i << ";" << d.vidTimestamp.micros << ";"
+             << d.bClose.posX << ";" << d.bClose.posY << ";" << d.bFar.posX << ";" << d.bFar.posY << ";"
+             << d.yClose.posX << ";" << d.yClose.posY << ";" << d.yFar.posX << ";" << d.yFar.posY << "\n";
+    }
+    file.close();
+    if (!file) {
+        std::cerr << "Could not write the detections to " << out << std::endl;
+        return 1;
+    }
+
+    std::clog << "Detected the cones of " << header.frameCount << " frames on " << used << " threads in "
+              << elapsed / 1000 << " ms (" << (elapsed > 0 ? header.frameCount * 1000000 / static_cast<uint64_t>(elapsed) : 0) << " frames/s)" << std::endl;
+    return 0;
 }
 
-void drawPath(std::vector<std::vector<cv::Point>>& contours, std::vector<cv::Point2f>& centroids, Mat imgContours, Mat img)
+int32_t runCameras(const std::vector<std::string> &names, std::map<std::string, std::string> &arguments)
 {
-    if(contours.size() != 0) {
-    // loop through the contours and draw them out on an image, also draws out rectangles around cones and lines between them
-        for(size_t i = 0; i < contours.size(); i++) {
-            
-            // draws the contours out on the imgContours_blue image.
-            cv::drawContours(imgContours, contours, (int)i, cv::Scalar(0, 255, 0), 1);
-            
-            // boundingRect finds the smallest rectangle that completely encloses a given contour or set of points. 
-            // boundingRect returns the x and y coordinates of the top left corner as one Point, the width and the height and stores it in a Rect object.
-            cv::Rect rectAroundCone = cv::boundingRect(contours[i]);
-        
-            // We try to ignore the smallest contours spotted by only drawing rectangles for Rects that have width and height > 5 to reduce noise
-            if(rectAroundCone.height > 5 && rectAroundCone.width > 5) {
-                
-                // draw a rectangle with the Rect as base
-                cv::rectangle(img, rectAroundCone, cv::Scalar(0, 255, 0), 2);
-                
-                // Draw lines between the two closest contours
-                if(i == 1) {
-                    cv::line(img, cv::Point(centroids[i - 1].x, centroids[i - 1].y), cv::Point(centroids[i].x, centroids[i].y), cv::Scalar(0, 0, 255), 2);
-                //since we only care about sending data about the closeest two cones, no need to continue loop if i > 1   
-                } else if(i > 1) {
-                    break;
-                }
-            }
+    const uint32_t WIDTH{static_cast<uint32_t>(std::stoi(arguments["width"]))};
+    const uint32_t HEIGHT{static_cast<uint32_t>(std::stoi(arguments["height"]))};
+
+    // The channel and core of every camera, the first camera's channel is the one the angle calculator reads by default
+    multi_camera::config_t config{};
+    config.names = names;
+    config.channels = arguments.count("channels") ? splitList(arguments["channels"]) : std::vector<std::string>{};
+    for (const std::string &core : arguments.count("cores") ? splitList(arguments["cores"]) : std::vector<std::string>{}) {
+        config.cores.push_back(std::stoi(core));
+    }
+    if ((!config.channels.empty() && config.channels.size() != names.size()) || (!config.cores.empty() && config.cores.size() != names.size())) {
+        std::cerr << "There have to be as many channels and cores as cameras" << std::endl;
+        return 1;
+    }
+    if (arguments.count("verbose") || arguments.count("trace") || arguments.count("counters")) {
+        std::clog << "--verbose, --trace and --counters are for one camera, the statistics of every camera are published for pipeline-top." << std::endl;
+    }
+    config.detector = detectorConfig(WIDTH, HEIGHT, 0, arguments);
+    config.detector.i420 = arguments.count("i420") != 0;
+    config.region = {IMG_HEIGHT_MIN, IMG_HEIGHT_MAX, Y_TOTAL};
+    config.deadline = {arguments.count("deadline") ? std::stoll(arguments["deadline"]) : 0, QOS_HEADROOM, QOS_DOWN_FRAMES, QOS_UP_FRAMES};
+    config.realtime = arguments.count("realtime") != 0;
+    config.priority = arguments.count("priority") ? std::stoi(arguments["priority"]) : realtime::DEFAULT_PRIORITY;
+
+    // The cameras are of the same vehicle, they share its ground steering
+    cluon::OD4Session od4{static_cast<uint16_t>(std::stoi(arguments["cid"]))};
+    std::atomic<_Float32> gsrVal{0};
+    od4.dataTrigger(opendlv::proxy::GroundSteeringRequest::ID(), [&gsrVal](cluon::data::Envelope &&env) {
+        gsrVal = cluon::extractMessage<opendlv::proxy::GroundSteeringRequest>(std::move(env)).groundSteering();
+    });
+    realtimeMode = config.realtime;
+    multiCamera = true;
+    const int32_t RET_CODE{multi_camera::run(config, od4, gsrVal)};
+
+    // The session has ended, the pipelines were stopped or one of them failed, report as if interrupted
+    handleExit(RET_CODE);
+    return RET_CODE;
+}
+
+std::vector<std::string> splitList(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
         }
     }
+    return items;
+}
+
+cone_detect::config_t detectorConfig(uint32_t width, uint32_t height, int32_t rowOffset,
+                                     const std::map<std::string, std::string> &arguments)
+{
+    return {
+        width,
+        height,
+        IMG_WIDTH_MIN,
+        IMG_WIDTH_MAX,
+        static_cast<uint32_t>(IMG_HEIGHT_MIN - rowOffset),
+        static_cast<uint32_t>(IMG_HEIGHT_MAX - rowOffset),
+        {B_MIN_H, B_MIN_S, B_MIN_V, B_MAX_H, B_MAX_S, B_MAX_V},
+        {Y_MIN_H, Y_MIN_S, Y_MIN_V, Y_MAX_H, Y_MAX_S, Y_MAX_V},
+        CANNY_LOW_THRESH,
+        CANNY_HIGH_THRESH,
+        CLOSE_SIZE,
+        arguments.count("packed") != 0,
+        arguments.count("track") != 0,
+        {TRACK_ALPHA, TRACK_BETA, TRACK_GATE, TRACK_MAX_MISSES},
+        TRACK_WINDOW,
+        TRACK_SCAN_INTERVAL,
+        arguments.count("downscale") ? static_cast<uint32_t>(std::stoi(arguments.at("downscale"))) : 1,
+        arguments.count("scanlines") ? static_cast<uint32_t>(std::stoi(arguments.at("scanlines"))) : 0,
+        // The frames are in BGRA, unless the I420 image is attached to
+        false,
+        // The ranges above are cone_detect::deployed_profile_t's, filtered with its kernel
+        false,
+        arguments.count("huge-pages") ? huge_pages::parse(arguments.at("huge-pages")) : huge_pages::NONE
+    };
 }
 
-void fillConePositions(pos_api::cone_t& coneClose, pos_api::cone_t& coneFar, std::vector<cv::Point2f> centroids, int contoursSize) 
+void fillOverlay(overlay::colour_t& colour, const std::vector<std::vector<cv::Point>>& contours, const cone_detect::side_t& side)
 {
-    // if there are atleast two cones visible, enter if block and get x and y coordinates
-    if(contoursSize > 1) {
-        uint16_t closeX = centroids[0].x;
-        uint16_t closeY = Y_TOTAL - centroids[0].y;
-        uint16_t farX = centroids[1].x;
-        uint16_t farY = Y_TOTAL - centroids[1].y;
-        pos_api::cone_t tmpClose{closeX, closeY};
-        pos_api::cone_t tmpFar{farX, farY};
-        std::memcpy(&coneClose, &tmpClose, sizeof(pos_api::cone_t));
-        std::memcpy(&coneFar, &tmpFar, sizeof(pos_api::cone_t));
-    // if there are < 2 contours found, send NO_CONE_POS to represent it.   
-    } else {
-        std::memcpy(&coneClose, &pos_api::NO_CONE_POS, sizeof(pos_api::cone_t));
-        std::memcpy(&coneFar, &pos_api::NO_CONE_POS, sizeof(pos_api::cone_t));
+    // the boxes of the biggest contours, which are drawn around the cones
+    colour.count = side.count;
+    colour.boxCount = static_cast<uint32_t>(std::min(contours.size(), static_cast<size_t>(overlay::MAX_BOXES)));
+    for (uint32_t i = 0; i < colour.boxCount; i++) {
+        cv::Rect box = cv::boundingRect(contours[i]);
+        colour.boxes[i] = {static_cast<int16_t>(box.x), static_cast<int16_t>(box.y), static_cast<int16_t>(box.width), static_cast<int16_t>(box.height)};
     }
+    colour.closeX = side.close.x;
+    colour.closeY = side.close.y;
+    colour.farX = side.far.x;
+    colour.farY = side.far.y;
 }
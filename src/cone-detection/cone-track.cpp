@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "cone-track.hpp"
+
+cone_track::Track::Track(const cone_track::filter_t &filter)
+    : m_filter(filter), m_valid(false), m_misses(0), m_x(0), m_y(0), m_vx(0), m_vy(0)
+{
+}
+
+bool cone_track::Track::valid() const
+{
+    return m_valid;
+}
+
+void cone_track::Track::predict(float &x, float &y) const
+{
+    x = m_x + m_vx;
+    y = m_y + m_vy;
+}
+
+bool cone_track::Track::update(float x, float y)
+{
+    float predictedX;
+    float predictedY;
+    predict(predictedX, predictedY);
+    const float DX = x - predictedX;
+    const float DY = y - predictedY;
+
+    m_misses = 0;
+    if (!m_valid || DX * DX + DY * DY > m_filter.gate * m_filter.gate)
+    {
+        // A new cone, or another one than the tracked cone
+        const bool WAS_VALID = m_valid;
+        m_valid = true;
+        m_x = x;
+        m_y = y;
+        m_vx = 0;
+        m_vy = 0;
+        return !WAS_VALID;
+    }
+
+    m_x = predictedX + m_filter.alpha * DX;
+    m_y = predictedY + m_filter.alpha * DY;
+    m_vx += m_filter.beta * DX;
+    m_vy += m_filter.beta * DY;
+    return true;
+}
+
+void cone_track::Track::miss()
+{
+    if (!m_valid) return;
+
+    predict(m_x, m_y);
+    if (++m_misses > m_filter.maxMisses)
+    {
+        m_valid = false;
+    }
+}
+
+float cone_track::Track::x() const
+{
+    return m_x;
+}
+
+float cone_track::Track::y() const
+{
+    return m_y;
+}
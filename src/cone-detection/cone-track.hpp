@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_CONE_TRACK_HPP
+#define DIT639_2023_GROUP_13_CONE_TRACK_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+
+/*
+ * Tracks a cone from one frame to the next, so the cone
+ * detection only has to look for it close to where it's
+ * predicted to be, and its position doesn't jitter.
+ *
+ * The cones move smoothly between frames at 30 FPS, so a
+ * track is an alpha-beta filter: it predicts the position
+ * with the velocity, and then moves the position by alpha
+ * and the velocity by beta of the distance to where the
+ * cone was found. A cone found too far from its prediction
+ * (e.g. another cone took its place) restarts the track.
+ *
+ * - filter_t: the parameters of the tracks
+ *
+ * - Track:    the track of one cone
+ */
+namespace cone_track {
+
+    /**
+     * The parameters of the tracks
+     *
+     * @param alpha how much of the distance to the found position
+     * the position is moved by, from 0 to 1
+     * @param beta how much of the distance to the found position
+     * the velocity is changed by, per frame
+     * @param gate the largest distance in pixels from the prediction
+     * a cone is still taken to be the tracked one at
+     * @param maxMisses the frames in a row a cone can't be found
+     * in before its track is dropped
+     */
+    struct filter_t {
+        float alpha;
+        float beta;
+        float gate;
+        uint32_t maxMisses;
+    };
+
+    /*
+     * The track of one cone
+     */
+    class Track {
+       public:
+        /**
+         * Creates a track without a cone
+         *
+         * @param filter the parameters of the track
+         */
+        explicit Track(const filter_t &filter);
+
+        /**
+         * Checks whether the track has a cone
+         *
+         * @return whether the cone has been found recently enough
+         */
+        bool valid() const;
+
+        /**
+         * Gets the position the cone is predicted at in the next frame
+         *
+         * @param x set to the x coordinate
+         * @param y set to the y coordinate
+         */
+        void predict(float &x, float &y) const;
+
+        /**
+         * Updates the track with the position the cone was found at.
+         * A track without a cone starts at the position.
+         *
+         * @param x the x coordinate
+         * @param y the y coordinate
+         * @return whether the position was within the gate of the
+         * prediction, the track restarts at the position if not
+         */
+        bool update(float x, float y);
+
+        /**
+         * Updates the track in a frame the cone wasn't found in,
+         * it's taken to be where it was predicted
+         */
+        void miss();
+
+        /**
+         * Gets the filtered x coordinate of the cone
+         *
+         * @return the x coordinate, if the track is valid
+         */
+        float x() const;
+
+        /**
+         * Gets the filtered y coordinate of the cone
+         *
+         * @return the y coordinate, if the track is valid
+         */
+        float y() const;
+
+       private:
+        filter_t m_filter;
+        bool m_valid;
+        uint32_t m_misses;
+        float m_x;
+        float m_y;
+        // The velocity in pixels per frame
+        float m_vx;
+        float m_vy;
+    };
+} // !namespace cone_track
+
+#endif // !DIT639_2023_GROUP_13_CONE_TRACK_HPP
@@ -0,0 +1,249 @@
+/*
+* Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//include section
+#include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+// Include the single-file, header-only middleware libcluon to create high-performance microservices
+#include "../cluon-complete-v0.0.127.hpp"
+// include the stream of what the cone detector found in every frame
+#include "overlay.hpp"
+// include the frame store replayed frames are read from
+#include "frame-store.hpp"
+
+// Include the GUI and image processing header files from OpenCV
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+// How long a frame waits for the cone detector to publish its record before the newest one is drawn on it
+#define MATCH_WAIT_MS 50
+// How often the stream is looked for while there is none, and a replay is polled for new records
+#define ATTACH_POLL_MS 1000
+#define REPLAY_POLL_MS 5
+
+std::atomic<bool> stopViewer{false};         // whether a termination signal has ended the viewer loop
+std::mutex memoryMutex;                      // guards viewerMemory
+cluon::SharedMemory *viewerMemory = nullptr; // the shared memory the viewer loop waits for frames in, while it runs
+
+/**
+ * Waits on a thread of its own for a termination signal, such as ctrl+C or closing the terminal window, which every
+ * other thread blocks, and ends the viewer upon it. The viewer loop is woken until it has left, as the frames may
+ * have stopped coming
+ * @param signals the termination signals
+*/
+void waitForExit(sigset_t signals);
+
+/**
+ * This method puts a rectangle on the two closest cones of a colour and then draws a line between them,
+ * and draws the boxes of all of its blobs or contours on an image of their own.
+ * @param colour what was found of the colour
+ * @param region the region of the frame the cones were looked for in
+ * @param boxes the image of the region's size to draw the boxes on
+*/
+void drawOverlay(const overlay::colour_t &colour, cv::Mat region, cv::Mat boxes);
+
+// main function
+int32_t main(int32_t argc, char **argv) {
+    auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+    const bool REPLAY{commandlineArguments.count("replay") != 0};
+    if ( (!REPLAY && (0 == commandlineArguments.count("name"))) ||
+         (!REPLAY && (0 == commandlineArguments.count("width"))) ||
+         (!REPLAY && (0 == commandlineArguments.count("height"))) ) {
+        std::cerr << argv[0] << " draws what the cone detector (or angle-pilot) run with --verbose finds on a copy of every frame and shows it." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --name=<name of shared memory area> --width=<width> --height=<height> [--stream=<cone-detector|angle-pilot>]" << std::endl;
+        std::cerr << "         " << argv[0] << " --replay=<frame store> [--stream=<cone-detector|angle-pilot>]" << std::endl;
+        std::cerr << "         --name:   name of the shared memory area of the ARGB frames the detector attaches to" << std::endl;
+        std::cerr << "         --width:  width of the frame" << std::endl;
+        std::cerr << "         --height: height of the frame" << std::endl;
+        std::cerr << "         --replay: the frame store the detector replays" << std::endl;
+        std::cerr << "         --stream: the detector to show the cones of (default: cone-detector)" << std::endl;
+        std::cerr << "Example: " << argv[0] << " --name=img --width=640 --height=480" << std::endl;
+        return 1;
+    }
+
+    const std::string STREAM{commandlineArguments.count("stream") ? commandlineArguments["stream"] : "cone-detector"};
+
+    // The signals are blocked before any other thread is started, which inherit it, and taken by a thread of their own
+    sigset_t exitSignals;
+    sigemptyset(&exitSignals);
+    for (int sig : {SIGINT, SIGTERM, SIGQUIT, SIGHUP}) {
+        sigaddset(&exitSignals, sig);
+    }
+    pthread_sigmask(SIG_BLOCK, &exitSignals, nullptr);
+    std::thread(waitForExit, exitSignals).detach();
+
+    // The frames come from the same shared memory or frame store as the detector's
+    std::unique_ptr<frame_store::Reader> store;
+    std::unique_ptr<cluon::SharedMemory> sharedMemory;
+    uint32_t width;
+    uint32_t height;
+    int32_t rowOffset;
+    try {
+        if (REPLAY) {
+            store.reset(new frame_store::Reader{commandlineArguments["replay"]});
+            width = store->header().width;
+            height = store->header().rowEnd - store->header().rowBegin;
+            rowOffset = static_cast<int32_t>(store->header().rowBegin);
+            if (store->header().bytesPerPixel != 4) {
+                std::cerr << "The frame store doesn't hold BGRA frames" << std::endl;
+                return 1;
+            }
+        } else {
+            width = static_cast<uint32_t>(std::stoi(commandlineArguments["width"]));
+            height = static_cast<uint32_t>(std::stoi(commandlineArguments["height"]));
+            rowOffset = 0;
+            sharedMemory.reset(new cluon::SharedMemory{commandlineArguments["name"]});
+            if (!sharedMemory->valid() || sharedMemory->size() < width * height * 4) {
+                std::cerr << "No shared memory of a " << width << "x" << height << " ARGB frame to attach to" << std::endl;
+                return 1;
+            }
+        }
+    } catch (const frame_store::StoreException &) {
+        std::cerr << "Could not open the frame store" << std::endl;
+        return 1;
+    }
+
+    // The detector may be started after the viewer
+    std::unique_ptr<overlay::Reader> stream;
+    while (!stream && !stopViewer) {
+        try {
+            stream.reset(new overlay::Reader{STREAM});
+        } catch (const overlay::OverlayException &e) {
+            if (e == overlay::OverlayException::FORMAT) {
+                std::cerr << "The overlay stream " << STREAM << " is laid out by another version" << std::endl;
+                return 1;
+            }
+            std::clog << argv[0] << ": Waiting for " << STREAM << " to run with --verbose..." << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(ATTACH_POLL_MS));
+        }
+    }
+
+    // The viewer's own copy of the frame, which is drawn on
+    cv::Mat frame(static_cast<int>(height), static_cast<int>(width), CV_8UC4);
+    const size_t FRAME_BYTES{static_cast<size_t>(width) * height * 4};
+    overlay::record_t record{};
+    uint64_t shownFrame = UINT64_MAX;
+    int32_t retCode{0};
+
+    // The loop is woken when it's stopped while it waits for a frame
+    {
+        std::lock_guard<std::mutex> lock(memoryMutex);
+        viewerMemory = sharedMemory.get();
+    }
+
+    while (!stopViewer) {
+        if (REPLAY) {
+            // Show the replayed frame the detector is at, when it has moved on
+            if (!stream->latest(record) || record.frame == shownFrame || record.frame >= store->header().frameCount) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(REPLAY_POLL_MS));
+                continue;
+            }
+            std::memcpy(frame.data, store->frame(record.frame), FRAME_BYTES);
+        } else {
+            sharedMemory->wait();
+            if (stopViewer) {
+                break;
+            }
+
+            int64_t timestamp;
+            sharedMemory->lock();
+            {
+                std::memcpy(frame.data, sharedMemory->data(), FRAME_BYTES);
+                timestamp = cluon::time::toMicroseconds(sharedMemory->getTimeStamp().second);
+            }
+            sharedMemory->unlock();
+
+            // The detector usually publishes the frame's record shortly after it was copied
+            std::chrono::steady_clock::time_point giveUp = std::chrono::steady_clock::now() + std::chrono::milliseconds(MATCH_WAIT_MS);
+            while (!stream->find(timestamp, record) && std::chrono::steady_clock::now() < giveUp) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (record.timestamp != timestamp && !stream->latest(record)) {
+                continue;
+            }
+        }
+        shownFrame = record.frame;
+
+        // The region of the frame the cones were looked for in, which their positions are relative to
+        const int32_t TOP{record.top - rowOffset};
+        if (TOP < 0 || TOP + record.height > frame.rows || record.left < 0 || record.left + record.width > frame.cols) {
+            std::cerr << "The region the cones were looked for in isn't in the frame" << std::endl;
+            retCode = 1;
+            break;
+        }
+        cv::Mat region = frame(cv::Range(TOP, TOP + record.height), cv::Range(record.left, record.left + record.width));
+        cv::Mat blueBoxes = cv::Mat::zeros(record.height, record.width, CV_8UC3);
+        cv::Mat yellowBoxes = cv::Mat::zeros(record.height, record.width, CV_8UC3);
+        drawOverlay(record.blue, region, blueBoxes);
+        drawOverlay(record.yellow, region, yellowBoxes);
+
+        cv::imshow(STREAM, region);
+        cv::imshow("Blue", blueBoxes);
+        cv::imshow("Yellow", yellowBoxes);
+        cv::waitKey(1);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(memoryMutex);
+        viewerMemory = nullptr;
+    }
+    return retCode;
+}
+
+void waitForExit(sigset_t signals)
+{
+    int sig{0};
+    sigwait(&signals, &sig);
+    stopViewer = true;
+
+    // The notification may come before the loop waits, so it's repeated
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(memoryMutex);
+            if (viewerMemory == nullptr) {
+                return;
+            }
+            viewerMemory->notifyAll();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void drawOverlay(const overlay::colour_t &colour, cv::Mat region, cv::Mat boxes)
+{
+    for (uint32_t i = 0; i < colour.boxCount; i++) {
+        const cv::Rect box{colour.boxes[i].x, colour.boxes[i].y, colour.boxes[i].width, colour.boxes[i].height};
+        cv::rectangle(boxes, box, cv::Scalar(0, 255, 0), 1);
+
+        // We try to ignore the smallest boxes by only drawing the ones of the closest two cones that have width and height > 5 to reduce noise
+        if (i < 2 && box.height > 5 && box.width > 5) {
+            cv::rectangle(region, box, cv::Scalar(0, 255, 0), 2);
+        }
+    }
+
+    // Draw a line between the two closest cones
+    if (colour.count > 1) {
+        cv::line(region, cv::Point(static_cast<int>(colour.closeX), static_cast<int>(colour.closeY)),
+                 cv::Point(static_cast<int>(colour.farX), static_cast<int>(colour.farY)), cv::Scalar(0, 0, 255), 2);
+    }
+}
@@ -0,0 +1,182 @@
+/*
+* Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//include section
+#include <pthread.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+// Include the single-file, header-only middleware libcluon to create high-performance microservices
+#include "../cluon-complete-v0.0.127.hpp"
+// include the frame store the frames are written to
+#include "frame-store.hpp"
+
+// The number of frames between the checkpoints of the store, which is readable up to the last one if the capture is killed
+#define CHECKPOINT_FRAMES 300
+
+std::atomic<bool> stopCapture{false};         // whether a termination signal has ended the capture loop
+std::mutex memoryMutex;                       // guards captureMemory
+cluon::SharedMemory *captureMemory = nullptr; // the shared memory the capture loop waits for frames in, while it runs
+
+/**
+ * Waits on a thread of its own for a termination signal, such as ctrl+C or closing the terminal window, which every
+ * other thread blocks, and ends the capture upon it, so the store gets its index written. The capture loop is woken
+ * until it has left, as the decoder may not publish another frame
+ * @param signals the termination signals
+*/
+void waitForExit(sigset_t signals);
+
+// main function
+int32_t main(int32_t argc, char **argv) {
+    auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+    if ( (0 == commandlineArguments.count("name")) ||
+         (0 == commandlineArguments.count("width")) ||
+         (0 == commandlineArguments.count("height")) ||
+         (0 == commandlineArguments.count("out")) ) {
+        std::cerr << argv[0] << " attaches to a shared memory area containing an ARGB image and writes every frame to a frame store." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --name=<name of shared memory area> --width=<width> --height=<height> --out=<file>"
+                  << " [--rows=<first row>:<row after last row>] [--frames=<number of frames>]" << std::endl;
+        std::cerr << "         --name:   name of the shared memory area to attach" << std::endl;
+        std::cerr << "         --width:  width of the frame" << std::endl;
+        std::cerr << "         --height: height of the frame" << std::endl;
+        std::cerr << "         --out:    path of the frame store to create" << std::endl;
+        std::cerr << "         --rows:   only store this band of rows, e.g. the region the cone detector looks at (default: all)" << std::endl;
+        std::cerr << "         --frames: stop after this many frames (default: until ^C)" << std::endl;
+        std::cerr << "Example: " << argv[0] << " --name=img --width=640 --height=480 --out=/tmp/frames.store --rows=270:400" << std::endl;
+        return 1;
+    }
+
+    const std::string NAME{commandlineArguments["name"]};
+    const uint32_t WIDTH{static_cast<uint32_t>(std::stoi(commandlineArguments["width"]))};
+    const uint32_t HEIGHT{static_cast<uint32_t>(std::stoi(commandlineArguments["height"]))};
+    const uint64_t FRAMES{commandlineArguments.count("frames") ? std::stoull(commandlineArguments["frames"]) : UINT64_MAX};
+
+    // The band of rows to store, all of them unless told otherwise
+    uint32_t rowBegin = 0;
+    uint32_t rowEnd = HEIGHT;
+    if (commandlineArguments.count("rows")) {
+        const std::string ROWS{commandlineArguments["rows"]};
+        const size_t COLON{ROWS.find(':')};
+        if (COLON == std::string::npos) {
+            std::cerr << "--rows must be given as <first row>:<row after last row>" << std::endl;
+            return 1;
+        }
+        rowBegin = static_cast<uint32_t>(std::stoi(ROWS.substr(0, COLON)));
+        rowEnd = static_cast<uint32_t>(std::stoi(ROWS.substr(COLON + 1)));
+    }
+
+    // The signals are blocked before any other thread is started, which inherit it, and taken by a thread of their own
+    sigset_t exitSignals;
+    sigemptyset(&exitSignals);
+    for (int sig : {SIGINT, SIGTERM, SIGQUIT, SIGHUP}) {
+        sigaddset(&exitSignals, sig);
+    }
+    pthread_sigmask(SIG_BLOCK, &exitSignals, nullptr);
+    std::thread(waitForExit, exitSignals).detach();
+
+    std::unique_ptr<cluon::SharedMemory> sharedMemory{new cluon::SharedMemory{NAME}};
+    if (!sharedMemory || !sharedMemory->valid()) {
+        std::cerr << "No shared memory to attach to" << std::endl;
+        return 1;
+    }
+    std::clog << argv[0] << ": Attached to shared memory '" << sharedMemory->name() << " (" << sharedMemory->size() << " bytes)." << std::endl;
+
+    if (sharedMemory->size() < WIDTH * HEIGHT * 4) {
+        std::cerr << "The shared memory is smaller than a " << WIDTH << "x" << HEIGHT << " ARGB frame" << std::endl;
+        return 1;
+    }
+
+    try {
+        frame_store::Writer store{commandlineArguments["out"], WIDTH, HEIGHT, rowBegin, rowEnd, 4};
+
+        // The frame is copied out under the lock and written after
+        // unlocking, so the decoder isn't held up by the disk
+        std::vector<uint8_t> frame(WIDTH * HEIGHT * 4);
+
+        // The loop is woken when it's stopped while it waits for a frame
+        {
+            std::lock_guard<std::mutex> lock(memoryMutex);
+            captureMemory = sharedMemory.get();
+        }
+
+        while (!stopCapture && store.frameCount() < FRAMES) {
+            sharedMemory->wait();
+            if (stopCapture) {
+                break;
+            }
+
+            int64_t timestamp;
+            sharedMemory->lock();
+            {
+                std::memcpy(frame.data(), sharedMemory->data(), frame.size());
+                timestamp = cluon::time::toMicroseconds(sharedMemory->getTimeStamp().second);
+            }
+            sharedMemory->unlock();
+
+            store.append(frame.data(), timestamp);
+            if (store.frameCount() % CHECKPOINT_FRAMES == 0) {
+                store.checkpoint();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(memoryMutex);
+            captureMemory = nullptr;
+        }
+        store.close();
+        std::clog << "Wrote " << store.frameCount() << " frames to " << commandlineArguments["out"] << std::endl;
+    }
+    catch (const frame_store::StoreException &e) {
+        {
+            std::lock_guard<std::mutex> lock(memoryMutex);
+            captureMemory = nullptr;
+        }
+        switch (e) {
+            case frame_store::StoreException::FORMAT:
+                std::cerr << "Rows out of bounds" << std::endl;
+                break;
+            default:
+                std::cerr << "Could not write the frame store" << std::endl;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+void waitForExit(sigset_t signals)
+{
+    int sig{0};
+    sigwait(&signals, &sig);
+    stopCapture = true;
+
+    // The notification may come before the loop waits, so it's repeated
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(memoryMutex);
+            if (captureMemory == nullptr) {
+                return;
+            }
+            captureMemory->notifyAll();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "frame-store.hpp"
+
+#include <cstring>
+
+// For mmap and the file size
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The alignment of the frames, one page
+#define FRAME_ALIGNMENT 4096
+
+frame_store::Writer::Writer(const std::string &path, uint32_t width, uint32_t height,
+                            uint32_t rowBegin, uint32_t rowEnd, uint32_t bytesPerPixel)
+    : m_file(nullptr), m_header(), m_index(), m_offset(FRAME_ALIGNMENT)
+{
+    if (rowBegin >= rowEnd || rowEnd > height)
+    {
+        throw frame_store::StoreException::FORMAT;
+    }
+
+    m_file = fopen(path.c_str(), "wb");
+    if (m_file == nullptr)
+    {
+        throw frame_store::StoreException::IO;
+    }
+
+    memcpy(m_header.magic, frame_store::MAGIC, sizeof (m_header.magic));
+    m_header.version = frame_store::VERSION;
+    m_header.width = width;
+    m_header.height = height;
+    m_header.rowBegin = rowBegin;
+    m_header.rowEnd = rowEnd;
+    m_header.bytesPerPixel = bytesPerPixel;
+    m_header.frameSize = (uint64_t) width * (rowEnd - rowBegin) * bytesPerPixel;
+    m_header.frameStride = (m_header.frameSize + FRAME_ALIGNMENT - 1) / FRAME_ALIGNMENT * FRAME_ALIGNMENT;
+
+    // Reserve the first page for the header, which is
+    // written again with the final numbers on close()
+    uint8_t page[FRAME_ALIGNMENT] = {};
+    memcpy(page, &m_header, sizeof (header_t));
+    if (fwrite(page, FRAME_ALIGNMENT, 1, m_file) != 1)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+        throw frame_store::StoreException::IO;
+    }
+}
+
+frame_store::Writer::~Writer()
+{
+    // Destructors mustn't throw, a broken store is all we can leave behind
+    try
+    {
+        close();
+    }
+    catch (const frame_store::StoreException &)
+    {
+    }
+}
+
+void frame_store::Writer::append(const uint8_t *frame, int64_t timestamp)
+{
+    if (m_file == nullptr)
+    {
+        throw frame_store::StoreException::IO;
+    }
+
+    // The frames follow the header page back to back, or the last checkpoint's index
+    frame_store::index_t entry{timestamp, m_offset};
+
+    const uint8_t *rows = frame + (size_t) m_header.rowBegin * m_header.width * m_header.bytesPerPixel;
+    static const uint8_t PADDING[FRAME_ALIGNMENT] = {};
+    if (fwrite(rows, m_header.frameSize, 1, m_file) != 1 ||
+        (m_header.frameStride != m_header.frameSize &&
+         fwrite(PADDING, m_header.frameStride - m_header.frameSize, 1, m_file) != 1))
+    {
+        throw frame_store::StoreException::IO;
+    }
+
+    m_index.push_back(entry);
+    m_header.frameCount++;
+    m_offset += m_header.frameStride;
+}
+
+void frame_store::Writer::checkpoint()
+{
+    if (m_file == nullptr)
+    {
+        throw frame_store::StoreException::IO;
+    }
+
+    // The index is padded to a page, so the next frames stay aligned. It's
+    // on disk before the header points at it, and the header before the
+    // next frame is written, so a killed process leaves one or the other
+    const uint64_t INDEX_SIZE = m_index.size() * sizeof (frame_store::index_t);
+    const uint64_t PADDED_SIZE = (INDEX_SIZE + FRAME_ALIGNMENT - 1) / FRAME_ALIGNMENT * FRAME_ALIGNMENT;
+    static const uint8_t PADDING[FRAME_ALIGNMENT] = {};
+    m_header.indexOffset = m_offset;
+    bool written = fwrite(m_index.data(), sizeof (frame_store::index_t), m_index.size(), m_file) == m_index.size() &&
+                   (PADDED_SIZE == INDEX_SIZE || fwrite(PADDING, PADDED_SIZE - INDEX_SIZE, 1, m_file) == 1) &&
+                   fflush(m_file) == 0 &&
+                   fseek(m_file, 0, SEEK_SET) == 0 &&
+                   fwrite(&m_header, sizeof (header_t), 1, m_file) == 1 &&
+                   fflush(m_file) == 0 &&
+                   fseek(m_file, 0, SEEK_END) == 0;
+    if (!written)
+    {
+        throw frame_store::StoreException::IO;
+    }
+    m_offset += PADDED_SIZE;
+}
+
+void frame_store::Writer::close()
+{
+    if (m_file == nullptr) return;
+
+    m_header.indexOffset = m_offset;
+
+    bool written = fwrite(m_index.data(), sizeof (frame_store::index_t), m_index.size(), m_file) == m_index.size() &&
+                   fseek(m_file, 0, SEEK_SET) == 0 &&
+                   fwrite(&m_header, sizeof (header_t), 1, m_file) == 1;
+    written = fclose(m_file) == 0 && written;
+    m_file = nullptr;
+
+    if (!written)
+    {
+        throw frame_store::StoreException::IO;
+    }
+}
+
+uint64_t frame_store::Writer::frameCount() const
+{
+    return m_header.frameCount;
+}
+
+/**
+ * Checks that the rows, the size of the frames and the index
+ * of a store's header fit together and into the file
+ *
+ * @param header the header of the store
+ * @param size the size of the file in bytes
+ * @return whether the header is consistent
+ */
+bool valid(const frame_store::header_t &header, size_t size)
+{
+    if (header.rowBegin >= header.rowEnd || header.rowEnd > header.height || header.bytesPerPixel == 0)
+    {
+        return false;
+    }
+
+    // The rows of a frame fit in 64 bits, with the bytes of a pixel they mustn't overflow
+    const uint64_t PIXELS = (uint64_t) header.width * (header.rowEnd - header.rowBegin);
+    if (PIXELS > UINT64_MAX / header.bytesPerPixel || header.frameSize != PIXELS * header.bytesPerPixel)
+    {
+        return false;
+    }
+
+    // The index is at the end, its entries aligned
+    return header.indexOffset >= FRAME_ALIGNMENT && header.indexOffset <= size &&
+           header.indexOffset % alignof (frame_store::index_t) == 0 &&
+           header.frameCount <= (size - header.indexOffset) / sizeof (frame_store::index_t);
+}
+
+frame_store::Reader::Reader(const std::string &path)
+    : m_data(nullptr), m_size(0), m_header(nullptr), m_index(nullptr)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw frame_store::StoreException::IO;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw frame_store::StoreException::IO;
+    }
+    m_size = (size_t) st.st_size;
+    if (m_size < FRAME_ALIGNMENT)
+    {
+        ::close(fd);
+        throw frame_store::StoreException::FORMAT;
+    }
+
+    // Read-only, so a stray write to a frame faults
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        throw frame_store::StoreException::IO;
+    }
+    m_data = (const uint8_t *) data;
+    m_header = (const frame_store::header_t *) m_data;
+
+    if (memcmp(m_header->magic, frame_store::MAGIC, sizeof (m_header->magic)) != 0 ||
+        m_header->version != frame_store::VERSION ||
+        !valid(*m_header, m_size))
+    {
+        munmap(data, m_size);
+        throw frame_store::StoreException::FORMAT;
+    }
+    m_index = (const frame_store::index_t *) (m_data + m_header->indexOffset);
+
+    // Every frame has to be between the header and the index
+    for (uint64_t i = 0; i < m_header->frameCount; i++)
+    {
+        if (m_index[i].offset < FRAME_ALIGNMENT || m_index[i].offset > m_header->indexOffset ||
+            m_header->indexOffset - m_index[i].offset < m_header->frameSize)
+        {
+            munmap(data, m_size);
+            throw frame_store::StoreException::FORMAT;
+        }
+    }
+
+    // The frames are read front to back
+    madvise(data, m_size, MADV_SEQUENTIAL);
+}
+
+frame_store::Reader::~Reader()
+{
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+}
+
+const frame_store::header_t &frame_store::Reader::header() const
+{
+    return *m_header;
+}
+
+const uint8_t *frame_store::Reader::frame(uint64_t i) const
+{
+    return m_data + m_index[i].offset;
+}
+
+int64_t frame_store::Reader::timestamp(uint64_t i) const
+{
+    return m_index[i].timestamp;
+}
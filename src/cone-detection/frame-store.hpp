@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_FRAME_STORE_HPP
+#define DIT639_2023_GROUP_13_FRAME_STORE_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * A file format for raw frames captured from the decoder's
+ * shared memory, so the cone detector can be run without
+ * the decoder and an OD4 session.
+ *
+ * The file starts with a header, followed by the frames and
+ * ends with an index of the frames' timestamps and offsets.
+ * Every frame starts on a page boundary, so a frame of a
+ * memory-mapped store can be used in place, without copying.
+ * A store that is checkpointed while it's written also has
+ * the index of the frames until then between its frames.
+ *
+ * A store can hold whole frames or only a band of rows of
+ * them (e.g. the region the cone detector looks at), which
+ * saves the space and bandwidth of the rows never used.
+ *
+ * - header_t:     the header at the start of the file
+ *
+ * - index_t:      an entry of the index at the end of the file
+ *
+ * - Writer:       appends frames to a new store
+ *
+ * - Reader:       memory-maps an existing store
+ *
+ * - StoreException: exceptions related to the stores
+ */
+namespace frame_store {
+
+    // The magic number at the start of every store
+    const char MAGIC[8] = {'A', 'P', 'F', 'R', 'A', 'M', 'E', 'S'};
+
+    // The version of the format
+    const uint32_t VERSION = 1;
+
+    /**
+     * The header at the start of a store
+     *
+     * @param magic MAGIC
+     * @param version the version of the format
+     * @param width the width of the frames in pixels
+     * @param height the height of the whole frames in pixels
+     * @param rowBegin the first row of the whole frame that is stored
+     * @param rowEnd the row after the last row that is stored
+     * @param bytesPerPixel the number of bytes per pixel (4 for BGRA)
+     * @param frameSize the number of bytes of each stored frame
+     * @param frameStride the number of bytes from the start of one
+     * frame to the next, which is frameSize rounded up to a page
+     * @param frameCount the number of frames in the store
+     * @param indexOffset the offset of the index in the file
+     */
+    struct header_t {
+        char magic[8];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t rowBegin;
+        uint32_t rowEnd;
+        uint32_t bytesPerPixel;
+        uint64_t frameSize;
+        uint64_t frameStride;
+        uint64_t frameCount;
+        uint64_t indexOffset;
+    };
+
+    /**
+     * An entry of the index at the end of a store
+     *
+     * @param timestamp the timestamp of the frame in microseconds,
+     * as set by the decoder in the shared memory
+     * @param offset the offset of the frame in the file
+     */
+    struct index_t {
+        int64_t timestamp;
+        uint64_t offset;
+    };
+
+    /*
+     * Exception enumerations tied to the stores
+     */
+    enum StoreException {
+        /*
+         * An exception that is thrown when a store can't be
+         * opened, created, mapped or written to
+         */
+        IO,
+
+        /*
+         * An exception that is thrown when a file isn't a
+         * store, or a store of another version
+         */
+        FORMAT
+    };
+
+    /*
+     * Appends frames to a new store. The index is written when
+     * the writer is closed, so a store that was never closed
+     * can only be read up to its last checkpoint.
+     */
+    class Writer {
+       public:
+        /**
+         * Creates a new store, replacing any file at the path
+         *
+         * @param path the path of the file to create
+         * @param width the width of the frames in pixels
+         * @param height the height of the whole frames in pixels
+         * @param rowBegin the first row of each frame to store
+         * @param rowEnd the row after the last row to store
+         * @param bytesPerPixel the number of bytes per pixel
+         * @throws StoreException::IO if the file can't be created
+         * @throws StoreException::FORMAT if the rows aren't within
+         * the frame
+         */
+        Writer(const std::string &path, uint32_t width, uint32_t height,
+               uint32_t rowBegin, uint32_t rowEnd, uint32_t bytesPerPixel);
+        ~Writer();
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        /**
+         * Appends the stored rows of a frame
+         *
+         * @param frame the whole frame, of width * height pixels
+         * @param timestamp the timestamp of the frame in microseconds
+         * @throws StoreException::IO if the frame can't be written
+         */
+        void append(const uint8_t *frame, int64_t timestamp);
+
+        /**
+         * Writes the index of the frames appended so far after
+         * them and points the header at it, so the store can be
+         * read up to here if the writer is never closed, e.g.
+         * when its process is killed. The next frames follow the
+         * index, which is left in the store unused once there's
+         * a later one.
+         *
+         * @throws StoreException::IO if they can't be written
+         */
+        void checkpoint();
+
+        /**
+         * Writes the index and the header and closes the file.
+         * Does nothing if the writer is already closed.
+         *
+         * @throws StoreException::IO if they can't be written
+         */
+        void close();
+
+        /**
+         * Gets the number of frames appended so far
+         *
+         * @return the number of frames
+         */
+        uint64_t frameCount() const;
+
+       private:
+        FILE *m_file;
+        header_t m_header;
+        std::vector<index_t> m_index;
+        uint64_t m_offset;  // the offset the next frame is written at
+    };
+
+    /*
+     * Memory-maps an existing store. The frames are mapped
+     * read-only and used in place.
+     */
+    class Reader {
+       public:
+        /**
+         * Opens and maps a store
+         *
+         * @param path the path of the store
+         * @throws StoreException::IO if the file can't be opened
+         * or mapped
+         * @throws StoreException::FORMAT if the file isn't a
+         * store of this version, or its header or index don't
+         * fit the file
+         */
+        explicit Reader(const std::string &path);
+        ~Reader();
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        /**
+         * Gets the header of the store
+         *
+         * @return the header
+         */
+        const header_t &header() const;
+
+        /**
+         * Gets a frame without copying it
+         *
+         * @param i the number of the frame, below frameCount
+         * @return the first byte of row rowBegin of the frame
+         */
+        const uint8_t *frame(uint64_t i) const;
+
+        /**
+         * Gets the timestamp of a frame
+         *
+         * @param i the number of the frame, below frameCount
+         * @return the timestamp in microseconds
+         */
+        int64_t timestamp(uint64_t i) const;
+
+       private:
+        const uint8_t *m_data;
+        size_t m_size;
+        const header_t *m_header;
+        const index_t *m_index;
+    };
+} // !namespace frame_store
+
+#endif // !DIT639_2023_GROUP_13_FRAME_STORE_HPP
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "huge-pages.hpp"
+
+#include <new>
+
+#include <sys/mman.h>
+
+// The alignment of the buffers, a cache line
+#define BUFFER_ALIGNMENT 64
+
+huge_pages::Backing huge_pages::parse(const std::string &name)
+{
+    for (int32_t i = 0; i < BACKING_COUNT; i++)
+    {
+        if (name == BACKING_NAMES[i]) return (Backing) i;
+    }
+    throw HugePagesException::UNKNOWN;
+}
+
+huge_pages::Pool::Pool(size_t size, huge_pages::Backing backing)
+    : m_data(nullptr),
+      m_size((size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE),
+      m_used(0),
+      m_backing(backing)
+{
+    if (m_backing == EXPLICIT)
+    {
+        void *data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED)
+        {
+            m_data = (uint8_t *) data;
+            return;
+        }
+        m_backing = TRANSPARENT;
+    }
+
+    // Transparent huge pages only back whole aligned huge pages of a
+    // mapping, so one more is mapped and the unaligned ends cut off
+    uint8_t *data = (uint8_t *) mmap(nullptr, m_size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == (uint8_t *) MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+    size_t head = (HUGE_PAGE_SIZE - (uintptr_t) data % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+    if (head > 0)
+    {
+        munmap(data, head);
+    }
+    munmap(data + head + m_size, HUGE_PAGE_SIZE - head);
+    m_data = data + head;
+
+    if (m_backing == TRANSPARENT && madvise(m_data, m_size, MADV_HUGEPAGE) != 0)
+    {
+        m_backing = NONE;
+    }
+    // Ordinary pages stay ordinary even if the kernel backs every
+    // mapping with transparent huge pages, to compare with
+    else if (m_backing == NONE)
+    {
+        madvise(m_data, m_size, MADV_NOHUGEPAGE);
+    }
+}
+
+huge_pages::Pool::~Pool()
+{
+    munmap(m_data, m_size);
+}
+
+uint8_t *huge_pages::Pool::take(size_t size)
+{
+    size_t start = (m_used + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT;
+    if (start + size > m_size)
+    {
+        return nullptr;
+    }
+    m_used = start + size;
+    return m_data + start;
+}
+
+huge_pages::Backing huge_pages::Pool::backing() const
+{
+    return m_backing;
+}
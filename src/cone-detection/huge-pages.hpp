@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_HUGE_PAGES_HPP
+#define DIT639_2023_GROUP_13_HUGE_PAGES_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Frame buffers backed by 2 MB huge pages. A frame and the
+ * images of the cone detection are over a megabyte each, so
+ * with 4 kB pages the per-pixel kernels walk through hundreds
+ * of pages per frame and miss the TLB on many of them, where
+ * one huge page covers a whole image.
+ *
+ * - Backing:            the pages the buffers can be backed by
+ *
+ * - HugePagesException: exceptions related to the backing
+ *
+ * - parse:              a backing from its name
+ *
+ * - Pool:               a pool of buffers with a backing
+ */
+namespace huge_pages {
+
+    // The size of a huge page
+    const size_t HUGE_PAGE_SIZE{2 * 1024 * 1024};
+
+    /*
+     * The pages the buffers can be backed by
+     */
+    enum Backing {
+        // Ordinary 4 kB pages
+        NONE,
+
+        // Transparent huge pages, which the kernel backs an
+        // aligned mapping with when it has them free
+        TRANSPARENT,
+
+        // Explicit huge pages from the pool the kernel reserved
+        // at boot or in /proc/sys/vm/nr_hugepages
+        EXPLICIT,
+
+        // The number of backings
+        BACKING_COUNT
+    };
+
+    // The names of the backings, in the order of Backing
+    const char *const BACKING_NAMES[BACKING_COUNT] = {
+        "none",
+        "transparent",
+        "explicit"
+    };
+
+    /*
+     * Exception enumerations tied to the backing
+     */
+    enum HugePagesException {
+        /*
+         * An exception that is thrown when a name isn't the
+         * name of a backing
+         */
+        UNKNOWN
+    };
+
+    /**
+     * Gets a backing from its name
+     *
+     * @param name the name, one of BACKING_NAMES
+     * @return the backing
+     * @throws HugePagesException::UNKNOWN if there is none of that name
+     */
+    Backing parse(const std::string &name);
+
+    /*
+     * A pool of buffers in one mapping, aligned to and rounded up
+     * to huge pages. Buffers are taken from it one after the other
+     * and are only given back all at once, when it's destroyed.
+     */
+    class Pool {
+       public:
+        /**
+         * Maps a pool. When there are no explicit huge pages left
+         * it falls back to transparent ones, and when the mapping
+         * can't be advised to use those to ordinary pages, so the
+         * backing it got may be less than the one asked for.
+         *
+         * @param size the number of bytes of the buffers to take
+         * @param backing the pages to back the pool with
+         */
+        Pool(size_t size, Backing backing);
+        ~Pool();
+
+        Pool(const Pool &) = delete;
+        Pool &operator=(const Pool &) = delete;
+
+        /**
+         * Takes a buffer, aligned to a cache line
+         *
+         * @param size the number of bytes of the buffer
+         * @return the buffer, or nullptr if the pool is used up
+         */
+        uint8_t *take(size_t size);
+
+        /**
+         * Gets the pages the pool is backed by
+         *
+         * @return the backing it got
+         */
+        Backing backing() const;
+
+       private:
+        uint8_t *m_data;
+        size_t m_size;
+        size_t m_used;
+        Backing m_backing;
+    };
+} // !namespace huge_pages
+
+#endif // !DIT639_2023_GROUP_13_HUGE_PAGES_HPP
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "isa.hpp"
+
+#include <cstdint>
+
+#if defined(__arm__) || defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+// The instruction set of the kernels
+isa::Isa selectedIsa = isa::best();
+
+bool isa::supported(isa::Isa isa)
+{
+    switch (isa)
+    {
+        case GENERIC:
+            return true;
+#if defined(__x86_64__) || defined(__i386__)
+        case AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+                   __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+#elif defined(__arm__)
+        case NEON:
+            return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#elif defined(__aarch64__)
+        case NEON:
+            return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#endif
+        default:
+            return false;
+    }
+}
+
+isa::Isa isa::best()
+{
+    for (int32_t i = ISA_COUNT - 1; i > GENERIC; i--)
+    {
+        if (supported((Isa) i)) return (Isa) i;
+    }
+    return GENERIC;
+}
+
+isa::Isa isa::parse(const std::string &name)
+{
+    for (int32_t i = 0; i < ISA_COUNT; i++)
+    {
+        if (name == ISA_NAMES[i]) return (Isa) i;
+    }
+    throw IsaException::UNKNOWN;
+}
+
+void isa::select(isa::Isa isa)
+{
+    if (!supported(isa)) throw IsaException::UNSUPPORTED;
+    selectedIsa = isa;
+}
+
+isa::Isa isa::selected()
+{
+    return selectedIsa;
+}
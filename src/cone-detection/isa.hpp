@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_ISA_HPP
+#define DIT639_2023_GROUP_13_ISA_HPP
+
+#include <string>
+
+/*
+ * The instruction sets the hot kernels of the cone detection
+ * are compiled for. The images are built for a generic CPU of
+ * each architecture, so every kernel is compiled once more for
+ * each of the wider instruction sets the architecture may have,
+ * all in the same binary, and the best one the CPU supports is
+ * selected at startup.
+ *
+ * A kernel is written once as a function that's always inlined
+ * and ISA_KERNEL defines its variants, which inline it with the
+ * target of their instruction set. Nothing else is compiled for
+ * the wider instruction sets, so a CPU without them never runs
+ * an instruction it doesn't have.
+ *
+ * - Isa:          the instruction sets
+ *
+ * - IsaException: exceptions related to the selection
+ *
+ * - supported:    whether the CPU supports an instruction set
+ *
+ * - best:         the best instruction set the CPU supports
+ *
+ * - parse:        an instruction set from its name
+ *
+ * - select:       selects the instruction set of the kernels
+ *
+ * - selected:     the instruction set of the kernels
+ */
+namespace isa {
+
+    /*
+     * The instruction sets, from the narrowest to the widest
+     */
+    enum Isa {
+        // What every CPU of the architecture has (SSE2 on x86-64)
+        GENERIC,
+
+        // AVX2, with FMA and BMI2, on x86
+        AVX2,
+
+        // NEON on ARM, which every 64-bit ARM has
+        NEON,
+
+        // The number of instruction sets
+        ISA_COUNT
+    };
+
+    // The names of the instruction sets, in the order of Isa
+    const char *const ISA_NAMES[ISA_COUNT] = {
+        "generic",
+        "avx2",
+        "neon"
+    };
+
+    /*
+     * Exception enumerations tied to the selection
+     */
+    enum IsaException {
+        /*
+         * An exception that is thrown when a name isn't the
+         * name of an instruction set
+         */
+        UNKNOWN,
+
+        /*
+         * An exception that is thrown when an instruction set
+         * is selected that the CPU doesn't support
+         */
+        UNSUPPORTED
+    };
+
+    /**
+     * Checks whether the CPU supports an instruction set, with
+     * cpuid on x86 and getauxval(AT_HWCAP) on ARM
+     *
+     * @param isa the instruction set
+     * @return whether the CPU supports it and the kernels were
+     * compiled for it
+     */
+    bool supported(Isa isa);
+
+    /**
+     * Gets the best instruction set the CPU supports
+     *
+     * @return the widest supported instruction set
+     */
+    Isa best();
+
+    /**
+     * Gets an instruction set from its name
+     *
+     * @param name the name, one of ISA_NAMES
+     * @return the instruction set
+     * @throws IsaException::UNKNOWN if there is none of that name
+     */
+    Isa parse(const std::string &name);
+
+    /**
+     * Selects the instruction set of the kernels, e.g. to compare
+     * them. It's best() until selected otherwise.
+     *
+     * @param isa the instruction set
+     * @throws IsaException::UNSUPPORTED if the CPU doesn't support it
+     */
+    void select(Isa isa);
+
+    /**
+     * Gets the instruction set of the kernels
+     *
+     * @return the selected instruction set
+     */
+    Isa selected();
+} // !namespace isa
+
+// Inlines a kernel's body into each of its variants
+#define ISA_INLINE inline __attribute__((always_inline))
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ISA_VARIANT_AVX2(NAME, BODY, PARAMS, ARGS) \
+    __attribute__((target("avx2,fma,bmi,bmi2"))) static void NAME##Avx2 PARAMS { BODY ARGS; }
+#define ISA_CASE_AVX2(NAME, ARGS) case isa::AVX2: NAME##Avx2 ARGS; return;
+#else
+#define ISA_VARIANT_AVX2(NAME, BODY, PARAMS, ARGS)
+#define ISA_CASE_AVX2(NAME, ARGS)
+#endif
+
+// A 64-bit ARM always has NEON, so its generic variant is the NEON one
+#if defined(__arm__)
+#define ISA_VARIANT_NEON(NAME, BODY, PARAMS, ARGS) \
+    __attribute__((target("fpu=neon"))) static void NAME##Neon PARAMS { BODY ARGS; }
+#define ISA_CASE_NEON(NAME, ARGS) case isa::NEON: NAME##Neon ARGS; return;
+#else
+#define ISA_VARIANT_NEON(NAME, BODY, PARAMS, ARGS)
+#define ISA_CASE_NEON(NAME, ARGS)
+#endif
+
+/*
+ * Defines the kernel NAME, which calls BODY, a function declared
+ * with ISA_INLINE, compiled for the selected instruction set
+ *
+ * @param NAME the name of the kernel
+ * @param BODY the function that does the work
+ * @param PARAMS the parameters of the kernel, in parentheses
+ * @param ARGS the names of the parameters, in parentheses
+ */
+#define ISA_KERNEL(NAME, BODY, PARAMS, ARGS) \
+    static void NAME##Generic PARAMS { BODY ARGS; } \
+    ISA_VARIANT_AVX2(NAME, BODY, PARAMS, ARGS) \
+    ISA_VARIANT_NEON(NAME, BODY, PARAMS, ARGS) \
+    static void NAME PARAMS \
+    { \
+        switch (isa::selected()) \
+        { \
+            ISA_CASE_AVX2(NAME, ARGS) \
+            ISA_CASE_NEON(NAME, ARGS) \
+            default: NAME##Generic ARGS; \
+        } \
+    }
+
+#endif // !DIT639_2023_GROUP_13_ISA_HPP
@@ -0,0 +1,74 @@
+#! /usr/bin/sh
+# Measures the cheaper modes of the cone detection with cone-detector-bench and
+# writes a table of the time per frame of each, and of how well the cones each
+# finds agree with the ones of the detection at full resolution. Then writes
+# the time per frame and dTLB misses per frame of the detection on huge pages
+# against the same detection on ordinary pages.
+#
+# Usage: sh mode-report.sh [frame store]
+#
+# Run in src/cone-detection once the benchmark is built into build/, or set
+# BENCH to another cone-detector-bench. Without a frame store the benchmark's
+# generated frames are used, on which the cones found are also checked against
+# the generated ones.
+
+set -e
+
+BENCH=${BENCH:-build/cone-detector-bench}
+STORE=""
+if [ $# -gt 0 ]; then
+    STORE="--store=$1"
+fi
+
+JSON=$(mktemp)
+trap 'rm -f "$JSON"' EXIT
+
+# The ns/op of a benchmark or the value of a metric in the JSON, - if there is none
+value() {
+    awk -v name="$1" '
+        index($0, "\"name\":\"" name "\",") {
+            rest = $0
+            sub(/.*"(ns_per_op|value)":/, "", rest)
+            sub(/[,}].*$/, "", rest)
+            printf "%.2f\n", rest
+            found = 1
+            exit
+        }
+        END {
+            if (!found) print "-"
+        }
+    ' "$JSON"
+}
+
+# Benchmarks one mode and prints its row of the table
+mode() {
+    LABEL=$1
+    shift
+    "$BENCH" $STORE "$@" --json="$JSON" > /dev/null
+    printf "%-16s %12s %10s %10s %10s %10s %10s\n" "$LABEL" "$(value detect)" \
+        "$(value full_resolution/hit_rate)" "$(value full_resolution/count_rate)" \
+        "$(value full_resolution/mean_error_px)" "$(value full_resolution/max_error_px)" "$(value accuracy/hit_rate)"
+}
+
+echo "The detection of every mode against the detection at full resolution"
+printf "%-16s %12s %10s %10s %10s %10s %10s\n" "mode" "detect ns" "hit rate" "count rate" "mean px" "max px" "generated"
+mode full
+mode packed --packed
+mode downscale=2 --downscale=2
+mode downscale=4 --downscale=4
+mode scanlines=8 --scanlines=8
+mode scanlines=16 --scanlines=16
+mode scanlines=32 --scanlines=32
+
+# Benchmarks the detection on one kind of huge pages and prints its row
+pages() {
+    "$BENCH" $STORE --huge-pages="$1" --json="$JSON" > /dev/null
+    printf "%-16s %12s %12s %14s %14s\n" "$1" "$(value detect)" "$(value detect/ordinary_pages)" \
+        "$(value detect/dtlb_misses)" "$(value ordinary_pages/detect/dtlb_misses)"
+}
+
+echo
+echo "The detection on huge pages against ordinary pages, per frame"
+printf "%-16s %12s %12s %14s %14s\n" "pages" "huge ns" "ordinary ns" "huge dtlb" "ordinary dtlb"
+pages transparent
+pages explicit
@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "multi-camera.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+// For blocking the signals on the threads of the cameras
+#include <csignal>
+#include <pthread.h>
+
+// The per-stage latency, for when the cameras were started
+#include "../api/trace.hpp"
+// The real-time mode and the pinning of the threads
+#include "../api/realtime.hpp"
+
+/* The longest the pipelines of the cameras are waited for to stop, in milliseconds. A pipeline
+   only takes longer when a frame does */
+#define STOP_MS 200
+
+// The cameras, once run has set them up. They're never freed, as their threads may still
+// be waiting for a frame when the process exits
+std::atomic<std::vector<std::unique_ptr<pipeline::camera_t>> *> cameras{nullptr};
+// When the pipelines of the cameras were started
+int64_t started = 0;
+// Whether the pipelines of the cameras are to keep running, they may be stopped before they're started
+std::atomic<bool> running{true};
+// Whether a pipeline couldn't be run, which stopped the others
+std::atomic<bool> failed{false};
+// Whether the pipelines run in real-time mode, and count their page faults
+bool realtimeRun = false;
+
+/**
+ * Runs the frames of one camera through its pipeline and puts its cones into its channel, until the cameras are stopped
+ *
+ * @param camera the camera to run the pipeline of
+ * @param od4 the session the pipeline runs as long as
+ * @param gsr the latest original ground steering request
+ * @param realtimeConfig the priority to run with in real-time mode, whose core is the camera's, or nullptr to only
+ * pin the thread
+ */
+void runCamera(pipeline::camera_t &camera, cluon::OD4Session &od4, const std::atomic<_Float32> &gsr,
+               const realtime::config_t *realtimeConfig)
+{
+    // The signals are only ever taken by the thread that waits for them
+    sigset_t signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try
+    {
+        if (realtimeConfig)
+        {
+            realtime::enter({camera.core, realtimeConfig->priority});
+        }
+        else
+        {
+            realtime::pin(camera.core);
+        }
+    }
+    catch (const realtime::RealtimeException &e)
+    {
+        switch (e)
+        {
+            case realtime::RealtimeException::CORE:
+                std::cerr << "Could not pin the pipeline of '" << camera.name << "' to core " << camera.core << std::endl;
+                break;
+            case realtime::RealtimeException::SCHEDULER:
+                std::cerr << "Could not schedule the pipeline of '" << camera.name << "' with SCHED_FIFO priority " << realtimeConfig->priority << std::endl;
+                break;
+            default:
+                std::cerr << "Could not lock the memory" << std::endl;
+        }
+        // The other pipelines are stopped, and run fails once they have
+        camera.stopped = true;
+        failed = true;
+        multi_camera::stop();
+        return;
+    }
+
+    const std::function<void(const pos_api::data_t &)> HAND_OVER{[&camera](const pos_api::data_t &coneData) {
+        camera.channel->put(coneData);
+    }};
+    while (running && od4.isRunning())
+    {
+        camera.sharedMemory->wait();
+        // A pipeline that is being stopped mustn't touch anything any more
+        if (!running)
+        {
+            break;
+        }
+        pipeline::step(camera, trace::now(), nullptr, 0, gsr, HAND_OVER);
+
+        // The page faults of the camera's thread are counted from its first frame on
+        if (realtimeConfig)
+        {
+            realtime::markSteady();
+        }
+    }
+    // The faults are read on the thread that had them, before it's reported as stopped
+    if (realtimeConfig)
+    {
+        camera.faults = realtime::faults();
+    }
+    camera.stopped = true;
+}
+
+int32_t multi_camera::run(const multi_camera::config_t &config, cluon::OD4Session &od4, const std::atomic<_Float32> &gsr)
+{
+    const uint32_t CORE_COUNT{std::max(std::thread::hardware_concurrency(), 1u)};
+    if (config.cores.empty() && config.names.size() > CORE_COUNT)
+    {
+        std::clog << "There are more cameras than cores, the pipelines share cores." << std::endl;
+    }
+
+    // The pipelines are set up one after the other, their threads only start once all of them are
+    std::unique_ptr<std::vector<std::unique_ptr<pipeline::camera_t>>> pipelinesOwner{new std::vector<std::unique_ptr<pipeline::camera_t>>()};
+    std::vector<std::unique_ptr<pipeline::camera_t>> &pipelines = *pipelinesOwner;
+    pipelines.reserve(config.names.size());
+    for (size_t i = 0; i < config.names.size(); i++)
+    {
+        pipeline::camera_t *camera = new pipeline::camera_t{};
+        pipelines.emplace_back(camera);
+        camera->name = config.names[i];
+        camera->core = config.cores.empty() ? static_cast<int32_t>(i % CORE_COUNT) : config.cores[i];
+        camera->region = config.region;
+
+        camera->sharedMemory.reset(new cluon::SharedMemory{config.names[i]});
+        if (!camera->sharedMemory->valid())
+        {
+            std::cerr << "Could not attach to shared memory '" << config.names[i] << "'" << std::endl;
+            return 1;
+        }
+        std::clog << "Attached to shared memory '" << camera->sharedMemory->name() << "' (" << camera->sharedMemory->size() << " bytes)." << std::endl;
+
+        // The luma bounds only depend on the HSV ranges, so they're derived once for all cameras
+        camera->detector.reset(new cone_detect::ConeDetector{config.detector, i == 0 ? nullptr : pipelines[0]->detector->lumaBounds()});
+        if (config.deadline.deadline > 0)
+        {
+            camera->controller.reset(new qos::Controller{config.deadline});
+        }
+
+        const std::string CHANNEL{!config.channels.empty() ? config.channels[i]
+                                  : i == 0 ? pos_api::DEFAULT_CHANNEL : pos_api::DEFAULT_CHANNEL + "." + std::to_string(i)};
+        try
+        {
+            camera->channel.reset(new pos_api::Channel{CHANNEL, true});
+        }
+        catch (const pos_api::APIException &)
+        {
+            std::cerr << "Shared memory '" << CHANNEL << "' already exists" << std::endl;
+            return 1;
+        }
+
+        try
+        {
+            camera->publisher.reset(new telemetry::Publisher{"cone-detector." + config.names[i], "cone-detector"});
+        }
+        catch (const telemetry::TelemetryException &)
+        {
+            std::clog << "Could not create the telemetry segment of '" << config.names[i] << "', no statistics are published for it." << std::endl;
+        }
+
+        // The frame copied out of the shared memory, an I420 frame has its three planes one after the other
+        const uint32_t WIDTH{config.detector.width};
+        const int FRAME_ROWS{static_cast<int>(config.detector.i420 ? config.detector.height * 3 / 2 : config.detector.height)};
+        const int FRAME_TYPE{config.detector.i420 ? CV_8UC1 : CV_8UC4};
+        const size_t FRAME_BYTES{static_cast<size_t>(FRAME_ROWS) * WIDTH * CV_ELEM_SIZE(FRAME_TYPE)};
+        if (config.detector.hugePages != huge_pages::NONE)
+        {
+            camera->framePool.reset(new huge_pages::Pool{FRAME_BYTES, config.detector.hugePages});
+        }
+        camera->frame = camera->framePool ? cv::Mat(FRAME_ROWS, static_cast<int>(WIDTH), FRAME_TYPE, camera->framePool->take(FRAME_BYTES))
+                                          : cv::Mat(FRAME_ROWS, static_cast<int>(WIDTH), FRAME_TYPE);
+        std::clog << "Running the pipeline of '" << config.names[i] << "' on core " << camera->core << ", putting the cones into '" << CHANNEL << "'." << std::endl;
+    }
+
+    const realtime::config_t REALTIME_CONFIG{-1, config.priority};
+    realtimeRun = config.realtime;
+    if (config.realtime)
+    {
+        // OpenCV's threads would run on other cores without the pipelines' priority
+        cv::setNumThreads(0);
+    }
+    // The cameras are only handed to stop once they're all set up, a pipeline stopped before it starts stops right away
+    for (const std::unique_ptr<pipeline::camera_t> &camera : pipelines)
+    {
+        camera->stopped = false;
+    }
+    cameras = pipelinesOwner.release();
+    started = trace::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < pipelines.size(); i++)
+    {
+        threads.emplace_back(runCamera, std::ref(*pipelines[i]), std::ref(od4), std::cref(gsr), config.realtime ? &REALTIME_CONFIG : nullptr);
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    return failed ? 1 : 0;
+}
+
+void multi_camera::stop()
+{
+    running = false;
+    std::vector<std::unique_ptr<pipeline::camera_t>> *pipelines = cameras;
+    if (pipelines == nullptr)
+    {
+        return;
+    }
+
+    // A pipeline waiting for a frame is woken to notice, until it has stopped, which also wakes
+    // the other readers of the camera once more. The notification may come before it waits,
+    // so it's repeated
+    const int64_t DEADLINE{trace::now() + STOP_MS * 1000};
+    for (const std::unique_ptr<pipeline::camera_t> &camera : *pipelines)
+    {
+        while (!camera->stopped && trace::now() < DEADLINE)
+        {
+            camera->sharedMemory->notifyAll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void multi_camera::print(std::ostream &out)
+{
+    const std::vector<std::unique_ptr<pipeline::camera_t>> *pipelines = cameras;
+    if (pipelines == nullptr)
+    {
+        return;
+    }
+
+    // The frame rate of all cameras is over the time since they were started, which is what the hardware has to sustain
+    const int64_t ELAPSED{std::max(trace::now() - started, static_cast<int64_t>(1))};
+    uint64_t frames = 0;
+    for (const std::unique_ptr<pipeline::camera_t> &camera : *pipelines)
+    {
+        const uint64_t FRAMES{camera->frames};
+        const int64_t SPAN{camera->lastDone - camera->firstDone};
+        out << "Camera '" << camera->name << "' on core " << camera->core << ": " << FRAMES << " frames, "
+            << (FRAMES > 1 && SPAN > 0 ? static_cast<double>(FRAMES - 1) * 1e6 / static_cast<double>(SPAN) : 0.0) << " frames/s, latency mean "
+            << (FRAMES > 0 ? camera->latencySum / static_cast<int64_t>(FRAMES) : 0) << " us, max " << camera->latencyMax << " us" << std::endl;
+        // The controller is only read once its pipeline has stopped writing it
+        if (camera->controller && camera->stopped)
+        {
+            camera->controller->print(out);
+        }
+        else if (camera->controller)
+        {
+            out << "The pipeline of '" << camera->name << "' is still running, its quality levels aren't printed" << std::endl;
+        }
+        // So are the page faults of its thread
+        if (realtimeRun && camera->stopped)
+        {
+            realtime::printFaults(camera->faults, out);
+        }
+        frames += FRAMES;
+    }
+    out << "All " << pipelines->size() << " cameras: " << frames << " frames, "
+        << static_cast<double>(frames) * 1e6 / static_cast<double>(ELAPSED) << " frames/s" << std::endl;
+}
+
+void multi_camera::remove()
+{
+    const std::vector<std::unique_ptr<pipeline::camera_t>> *pipelines = cameras;
+    if (pipelines == nullptr)
+    {
+        return;
+    }
+
+    // The channel of a pipeline that didn't stop in time is left, it may still put into it
+    for (const std::unique_ptr<pipeline::camera_t> &camera : *pipelines)
+    {
+        if (camera->publisher)
+        {
+            camera->publisher->remove();
+        }
+        if (camera->stopped)
+        {
+            camera->channel.reset();
+        }
+    }
+}
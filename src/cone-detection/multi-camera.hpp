@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_MULTI_CAMERA_HPP
+#define DIT639_2023_GROUP_13_MULTI_CAMERA_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "pipeline.hpp"
+
+/*
+ * Runs the cone detector for several cameras in one process. Every
+ * camera gets a pipeline of its own, on a thread pinned to a core of
+ * its own, and puts its cones into a pos_api channel of its own. The
+ * detectors of the cameras share the luma bounds of the I420 frames.
+ *
+ * The pipelines are stopped from another thread, e.g. the one that
+ * waits for the signals of the process, or by a pipeline that can't
+ * run. Run returns once they have, and they can be reported on.
+ *
+ * - config_t: the cameras and what they run with
+ *
+ * - run:      runs the pipelines until the session ends
+ *
+ * - stop:     stops the pipelines
+ *
+ * - print:    prints the frames and latency of every camera
+ *
+ * - remove:   destroys the channels and statistics of the cameras
+ */
+namespace multi_camera {
+
+    /**
+     * The cameras and what they run with
+     *
+     * @param names the names of the cameras' shared memory areas
+     * @param channels the names of the cameras' pos_api channels,
+     * or none for DEFAULT_CHANNEL, DEFAULT_CHANNEL.1, ...
+     * @param cores the cores to pin the cameras' threads to, or
+     * none for the first cores
+     * @param detector the configuration of the cone detection of
+     * every camera
+     * @param region the rows the cones are looked for in
+     * @param deadline the time in microseconds a frame should take
+     * or 0, with the rest of the configuration of the controller
+     * @param realtime whether to run the pipelines in real-time mode
+     * @param priority the SCHED_FIFO priority in real-time mode
+     */
+    struct config_t {
+        std::vector<std::string> names;
+        std::vector<std::string> channels;
+        std::vector<int32_t> cores;
+        cone_detect::config_t detector;
+        pipeline::region_t region;
+        qos::config_t deadline;
+        bool realtime;
+        int32_t priority;
+    };
+
+    /**
+     * Sets up the pipelines of the cameras and runs them until the
+     * session ends, or they're stopped
+     *
+     * @param config the cameras and what they run with
+     * @param od4 the session the pipelines run as long as
+     * @param gsr the latest original ground steering request
+     * @return the exit code of the programme, 1 if a pipeline
+     * couldn't be set up or run
+     */
+    int32_t run(const config_t &config, cluon::OD4Session &od4, const std::atomic<_Float32> &gsr);
+
+    /**
+     * Stops the pipelines and waits for them, waking the ones
+     * waiting for a frame, for up to a fraction of a second.
+     * Pipelines that haven't been started yet stop right away
+     */
+    void stop();
+
+    /**
+     * Prints the frames and latency of every camera, the quality
+     * levels and, in real-time mode, the page faults of the ones
+     * that have stopped, and the frame rate of all of them together
+     *
+     * @param out the stream to print to
+     */
+    void print(std::ostream &out);
+
+    /**
+     * Destroys the channels of the cameras and removes their
+     * statistics. The pipelines have to be stopped first
+     */
+    void remove();
+} // !namespace multi_camera
+
+#endif // !DIT639_2023_GROUP_13_MULTI_CAMERA_HPP
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "overlay.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+// The ring, which readers map read-only, and the sequence lock of its slots
+#include "../api/shared-segment.hpp"
+
+// The first bytes of every stream, "OVL1", and the version of its layout
+#define MAGIC 0x314c564f
+#define VERSION 1
+
+/**
+ * The header at the start of a stream
+ *
+ * @param magic MAGIC once the stream is set up
+ * @param version VERSION
+ * @param slots the number of slots, overlay::RING_SIZE
+ * @param written the number of records written, the newest is
+ * in slot (written - 1) % slots
+ */
+struct header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    std::atomic<uint32_t> written;
+};
+
+/**
+ * A slot of the ring
+ *
+ * @param sequence odd while the record is written
+ * @param padding keeps the record 8-byte aligned
+ * @param record the record
+ */
+struct slot_t {
+    std::atomic<uint32_t> sequence;
+    uint32_t padding;
+    overlay::record_t record;
+};
+
+#define STREAM_SIZE (sizeof(header_t) + overlay::RING_SIZE * sizeof(slot_t))
+
+/**
+ * Gets the name of a stream in /dev/shm
+ *
+ * @param name the name of the stream, after overlay::PREFIX
+ * @return the name in /dev/shm
+ */
+std::string streamName(const std::string &name)
+{
+    return overlay::PREFIX + name;
+}
+
+overlay::Writer::Writer(const std::string &name)
+    : m_name(name), m_data(nullptr), m_removed(false)
+{
+    // The ring of a detector that didn't remove it is reused
+    try
+    {
+        m_data = shared_segment::create(streamName(name), STREAM_SIZE);
+    }
+    catch (const shared_segment::SegmentException &)
+    {
+        throw overlay::OverlayException::CREATE;
+    }
+
+    // Readers only take the stream for set up once it has the magic,
+    // which is written last
+    header_t *header = reinterpret_cast<header_t *>(m_data);
+    std::memset(m_data, 0, STREAM_SIZE);
+    new (&header->written) std::atomic<uint32_t>{0};
+    slot_t *slots = reinterpret_cast<slot_t *>(m_data + sizeof(header_t));
+    for (uint32_t i = 0; i < RING_SIZE; i++)
+    {
+        new (&slots[i].sequence) std::atomic<uint32_t>{0};
+    }
+    header->version = VERSION;
+    header->slots = RING_SIZE;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = MAGIC;
+}
+
+overlay::Writer::~Writer()
+{
+    remove();
+    shared_segment::unmap(m_data, STREAM_SIZE);
+}
+
+void overlay::Writer::put(const overlay::record_t &record)
+{
+    header_t *header = reinterpret_cast<header_t *>(m_data);
+    uint32_t written = header->written.load(std::memory_order_relaxed);
+    slot_t &slot = reinterpret_cast<slot_t *>(m_data + sizeof(header_t))[written % RING_SIZE];
+
+    uint32_t sequence = shared_segment::beginWrite(slot.sequence);
+    std::memcpy(&slot.record, &record, sizeof(overlay::record_t));
+    shared_segment::endWrite(slot.sequence, sequence);
+
+    header->written.store(written + 1, std::memory_order_release);
+}
+
+void overlay::Writer::remove()
+{
+    if (!m_removed)
+    {
+        shared_segment::unlink(streamName(m_name));
+        m_removed = true;
+    }
+}
+
+overlay::Reader::Reader(const std::string &name)
+    : m_data(nullptr)
+{
+    try
+    {
+        m_data = shared_segment::attach(streamName(name), STREAM_SIZE);
+    }
+    catch (const shared_segment::SegmentException &e)
+    {
+        // The ring of another record or ring size is of another size
+        throw e == shared_segment::SegmentException::SIZE ? overlay::OverlayException::FORMAT
+                                                          : overlay::OverlayException::ATTACH;
+    }
+
+    const header_t *header = reinterpret_cast<const header_t *>(m_data);
+    if (header->magic == MAGIC && (header->version != VERSION || header->slots != RING_SIZE))
+    {
+        shared_segment::unmap(m_data, STREAM_SIZE);
+        throw overlay::OverlayException::FORMAT;
+    }
+}
+
+overlay::Reader::~Reader()
+{
+    shared_segment::unmap(m_data, STREAM_SIZE);
+}
+
+uint32_t overlay::Reader::written() const
+{
+    const header_t *header = reinterpret_cast<const header_t *>(m_data);
+    if (header->magic != MAGIC)
+    {
+        return 0;
+    }
+    return header->written.load(std::memory_order_acquire);
+}
+
+bool overlay::Reader::latest(overlay::record_t &record) const
+{
+    uint32_t count = written();
+    return count > 0 && read((count - 1) % RING_SIZE, record);
+}
+
+bool overlay::Reader::find(int64_t timestamp, overlay::record_t &record) const
+{
+    // From the newest record back, as the frame is usually one of the last
+    uint32_t count = written();
+    for (uint32_t i = 1; i <= std::min(count, RING_SIZE); i++)
+    {
+        if (read((count - i) % RING_SIZE, record) && record.timestamp == timestamp)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool overlay::Reader::read(uint32_t slot, overlay::record_t &record) const
+{
+    const slot_t &s = reinterpret_cast<const slot_t *>(m_data + sizeof(header_t))[slot];
+    return shared_segment::read(s.sequence, &s.record, &record, sizeof(overlay::record_t));
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_OVERLAY_HPP
+#define DIT639_2023_GROUP_13_OVERLAY_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+#include <cstddef>
+
+#include <atomic>
+#include <string>
+
+/*
+ * A stream of what the cone detector found in every frame, so
+ * that another process can draw it instead of the detector.
+ * Drawing and showing the frames cost the detector more than
+ * some of its stages, and waiting on the GUI made its latency
+ * depend on the display.
+ *
+ * The records are kept in a ring of slots in a shared_segment,
+ * each slot under a sequence lock of its own, so the writer
+ * never waits and readers map the ring read-only.
+ *
+ * - MAX_BOXES:       the most boxes of a colour in a record
+ *
+ * - RING_SIZE:       the number of records the ring keeps
+ *
+ * - box_t:           the bounding box of a blob or contour
+ *
+ * - colour_t:        what was found of one colour
+ *
+ * - record_t:        what was found in a frame
+ *
+ * - OverlayException: exceptions related to the stream
+ *
+ * - Writer:          writes the records of a detector
+ *
+ * - Reader:          reads the records of another process
+ */
+namespace overlay {
+
+    // The prefix of the names of the streams, in /dev/shm
+    const char *const PREFIX{"overlay."};
+
+    // The boxes of the biggest blobs or contours are kept, the
+    // cones are the biggest two
+    const uint32_t MAX_BOXES{16};
+
+    // About a second of frames
+    const uint32_t RING_SIZE{32};
+
+    /**
+     * The bounding box of a blob or contour, relative to the
+     * region the cones are looked for in
+     *
+     * @param x the left column
+     * @param y the top row
+     * @param width the number of columns
+     * @param height the number of rows
+     */
+    struct box_t {
+        int16_t x;
+        int16_t y;
+        int16_t width;
+        int16_t height;
+    };
+
+    /**
+     * What was found of one colour
+     *
+     * @param count the number of cones found
+     * @param boxCount the number of boxes, at most MAX_BOXES
+     * @param boxes the boxes of the biggest blobs or contours, biggest first
+     * @param closeX the column of the closest cone, if count is at least 1
+     * @param closeY the row of the closest cone
+     * @param farX the column of the second closest cone, if count is at least 2
+     * @param farY the row of the second closest cone
+     */
+    struct colour_t {
+        uint32_t count;
+        uint32_t boxCount;
+        box_t boxes[MAX_BOXES];
+        float closeX;
+        float closeY;
+        float farX;
+        float farY;
+    };
+
+    /**
+     * What was found in a frame
+     *
+     * @param frame the number of the frame, its index in a replayed frame store
+     * @param timestamp the timestamp of the frame in microseconds
+     * @param left the column of the frame the region starts at
+     * @param top the row of the frame the region starts at
+     * @param width the number of columns of the region
+     * @param height the number of rows of the region
+     * @param blue the blue cones
+     * @param yellow the yellow cones
+     */
+    struct record_t {
+        uint64_t frame;
+        int64_t timestamp;
+        int32_t left;
+        int32_t top;
+        int32_t width;
+        int32_t height;
+        colour_t blue;
+        colour_t yellow;
+    };
+
+    /*
+     * Exception enumerations tied to the stream
+     */
+    enum OverlayException {
+        /*
+         * An exception that is thrown when a stream can't be
+         * created and mapped
+         */
+        CREATE,
+
+        /*
+         * An exception that is thrown when there is no stream
+         * to attach to
+         */
+        ATTACH,
+
+        /*
+         * An exception that is thrown when a stream isn't laid
+         * out as this version's
+         */
+        FORMAT
+    };
+
+    /*
+     * Writes the records of a detector to a stream of its name.
+     * It's only used by the thread that runs the frames.
+     */
+    class Writer {
+       public:
+        /**
+         * Creates the stream, or takes over one that a detector of
+         * the same name left behind
+         *
+         * @param name the name of the stream, after PREFIX
+         * @throws OverlayException::CREATE if it can't be created
+         */
+        explicit Writer(const std::string &name);
+        ~Writer();
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        /**
+         * Writes a record over the oldest one
+         *
+         * @param record the record
+         */
+        void put(const record_t &record);
+
+        /**
+         * Removes the name of the stream, so no more readers can
+         * attach
+         */
+        void remove();
+
+       private:
+        std::string m_name;
+        uint8_t *m_data;
+        bool m_removed;
+    };
+
+    /*
+     * Reads the records another process writes, through a
+     * read-only mapping of its stream
+     */
+    class Reader {
+       public:
+        /**
+         * Attaches to a stream
+         *
+         * @param name the name of the stream, after PREFIX
+         * @throws OverlayException::ATTACH if there is none
+         * @throws OverlayException::FORMAT if it isn't this version's
+         */
+        explicit Reader(const std::string &name);
+        ~Reader();
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        /**
+         * Gets the number of records written so far
+         *
+         * @return the number of records
+         */
+        uint32_t written() const;
+
+        /**
+         * Copies the newest record
+         *
+         * @param record the copy to write to
+         * @return whether there was a record that could be copied
+         */
+        bool latest(record_t &record) const;
+
+        /**
+         * Copies the record of a frame, if it's still in the ring
+         *
+         * @param timestamp the timestamp of the frame
+         * @param record the copy to write to
+         * @return whether the record was found
+         */
+        bool find(int64_t timestamp, record_t &record) const;
+
+       private:
+        /**
+         * Copies one slot of the ring
+         *
+         * @param slot the slot
+         * @param record the copy to write to
+         * @return whether a whole record was copied
+         */
+        bool read(uint32_t slot, record_t &record) const;
+
+        const uint8_t *m_data;
+    };
+} // !namespace overlay
+
+#endif // !DIT639_2023_GROUP_13_OVERLAY_HPP
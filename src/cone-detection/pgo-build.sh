@@ -0,0 +1,59 @@
+#! /usr/bin/sh
+# Builds the cone detector with profile-guided and link-time optimisation into
+# build/: an instrumented build is trained on the benchmark, then rebuilt with
+# its profile and LTO. The benchmark of a plain release build is compared with
+# the optimised one in build/pgo-report.txt.
+#
+# Usage: sh pgo-build.sh [frame store]
+#
+# The training runs on generated frames, and on the frames of a frame store
+# written by frame-capture if one is given, which profiles the detection on
+# frames of a recording and the batch mode of the cone detector as well.
+
+set -e
+
+STORE=""
+if [ $# -gt 0 ]; then
+    STORE=$(realpath "$1")
+fi
+
+rm -rf build/ build-baseline/
+
+# Benchmarks the detection and its packed variant into the JSON files of the build
+benchmark() {
+    ./cone-detector-bench --json=cone-detector.json > /dev/null
+    ./cone-detector-bench --packed --json=cone-detector-packed.json > /dev/null
+}
+
+# The plain release build, to compare with
+mkdir build-baseline
+cd build-baseline
+cmake -D CMAKE_BUILD_TYPE=Release ..
+make
+benchmark
+cd ..
+
+# The instrumented build, trained on every mode of the detection
+mkdir build
+cd build
+cmake -D CMAKE_BUILD_TYPE=Release -D PGO=generate -D LTO=OFF ..
+make
+for MODE in "" --packed --downscale=2 --downscale=4 --scanlines=16 --i420 --quality=half --quality=rows --quality=windows; do
+    ./cone-detector-bench --ops=500 $MODE > /dev/null
+done
+if [ -n "$STORE" ]; then
+    ./cone-detector-bench --store="$STORE" --ops=500 > /dev/null
+    ./cone-detector-bench --store="$STORE" --ops=500 --track > /dev/null
+    ./cone-detector --batch="$STORE" --out=/dev/null
+    ./cone-detector --batch="$STORE" --out=/dev/null --packed
+fi
+
+# The optimised build
+cmake -D PGO=use -D LTO=ON ..
+make clean
+make
+benchmark
+
+sh ../../api/bench-report.sh ../build-baseline/cone-detector.json cone-detector.json > pgo-report.txt
+sh ../../api/bench-report.sh ../build-baseline/cone-detector-packed.json cone-detector-packed.json >> pgo-report.txt
+cat pgo-report.txt
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "pipeline.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// The per-stage latency, for the statistics
+#include "../api/trace.hpp"
+
+static_assert(cone_detect::QUALITY_COUNT <= telemetry::QOS_LEVELS, "Every quality level has to fit in the telemetry segment");
+
+/**
+ * Copies the rows the cones are looked for in out of an I420
+ * image, from all three of its planes
+ *
+ * @param i420 the first byte of the image's Y plane, followed by
+ * its U and V planes
+ * @param frame the I420 image to copy the rows into, of the same size
+ * @param region the rows to copy
+ */
+void copyRegionI420(const uint8_t *i420, cv::Mat &frame, const pipeline::region_t &region)
+{
+    // The rows of the region, and the rows of chroma they share
+    const size_t WIDTH = static_cast<size_t>(frame.cols);
+    const size_t HEIGHT = static_cast<size_t>(frame.rows) * 2 / 3;
+    const size_t CHROMA_TOP = region.top / 2;
+    const size_t CHROMA_BOTTOM = (region.bottom + 1) / 2;
+    std::memcpy(frame.data + region.top * WIDTH, i420 + region.top * WIDTH, (region.bottom - region.top) * WIDTH);
+
+    // The U plane follows the Y plane and the V plane the U plane
+    for (size_t plane : {WIDTH * HEIGHT, WIDTH * HEIGHT + WIDTH * HEIGHT / 4})
+    {
+        std::memcpy(frame.data + plane + CHROMA_TOP * WIDTH / 2, i420 + plane + CHROMA_TOP * WIDTH / 2, (CHROMA_BOTTOM - CHROMA_TOP) * WIDTH / 2);
+    }
+}
+
+pipeline::times_t pipeline::step(pipeline::camera_t &camera, int64_t woke, const uint8_t *replayed, int64_t replayedTimestamp, _Float32 gsr,
+                                 const std::function<void(const pos_api::data_t &)> &handOver)
+{
+    pipeline::times_t times{woke, 0, 0, 0, replayedTimestamp};
+    const bool I420 = camera.frame.type() == CV_8UC1;
+
+    // A replayed frame is only read, so it's used in place
+    const uint8_t *pixels = replayed;
+    size_t stride = static_cast<size_t>(camera.frame.cols) * 4;
+    if (!replayed)
+    {
+        camera.sharedMemory->lock();
+        if (I420)
+        {
+            // Only the rows the cones are looked for in are copied
+            copyRegionI420(reinterpret_cast<const uint8_t *>(camera.sharedMemory->data()), camera.frame, camera.region);
+            stride = static_cast<size_t>(camera.frame.cols);
+        }
+        else
+        {
+            cv::Mat wrapped(camera.frame.rows, camera.frame.cols, CV_8UC4, camera.sharedMemory->data());
+            wrapped.copyTo(camera.frame);
+            stride = camera.frame.step[0];
+        }
+        times.timestamp = cluon::time::toMicroseconds(camera.sharedMemory->getTimeStamp().second);
+        camera.sharedMemory->unlock();
+        pixels = camera.frame.data;
+    }
+    times.captured = trace::now();
+
+    camera.detector->detect(pixels, stride, camera.detections);
+
+    pos_api::cone_t bClose{};
+    pos_api::cone_t bFar{};
+    pos_api::cone_t yClose{};
+    pos_api::cone_t yFar{};
+    pipeline::fillConePositions(bClose, bFar, camera.detections.blue, camera.region.yTotal);
+    pipeline::fillConePositions(yClose, yFar, camera.detections.yellow, camera.region.yTotal);
+
+    // The UNIX timestamp right before the cones are handed on
+    times.detected = cluon::time::toMicroseconds(cluon::time::now());
+    const pos_api::data_t CONE_DATA{
+        bClose,
+        bFar,
+        yClose,
+        yFar,
+        {times.detected},
+        {times.timestamp},
+        gsr
+    };
+    handOver(CONE_DATA);
+    times.done = trace::now();
+
+    // The next frame is detected at the level the time of this one calls for
+    if (camera.controller)
+    {
+        camera.detector->setQuality(camera.controller->update(times.detected - woke));
+    }
+    if (camera.publisher)
+    {
+        camera.publisher->record(trace::CAPTURE, times.captured - woke);
+        camera.publisher->record(trace::DETECT, times.detected - times.captured);
+        if (camera.controller)
+        {
+            camera.publisher->setQos(camera.detector->quality(), cone_detect::QUALITY_NAMES[camera.detector->quality()]);
+            for (uint8_t i = 0; i < cone_detect::QUALITY_COUNT; i++)
+            {
+                const cone_detect::Quality LEVEL = static_cast<cone_detect::Quality>(i);
+                camera.publisher->setQosTime(i, cone_detect::QUALITY_NAMES[i], camera.controller->frames(LEVEL), camera.controller->micros(LEVEL));
+            }
+        }
+        camera.publisher->frame(times.timestamp, woke, times.done);
+    }
+
+    // Only this thread writes the statistics, the atomics are for the report
+    if (camera.frames == 0)
+    {
+        camera.firstDone = times.done;
+    }
+    camera.lastDone = times.done;
+    camera.latencySum += times.done - woke;
+    camera.latencyMax = std::max(camera.latencyMax.load(), times.done - woke);
+    camera.frames++;
+    return times;
+}
+
+/**
+ * Converts a coordinate of a cone to the pixel it's in, clamped to
+ * the frame rather than wrapped when it's outside of it
+ *
+ * @param coordinate the coordinate, in pixels
+ * @param max the largest coordinate of the frame
+ * @return the pixel, from 0 to max
+ */
+uint16_t toPixel(float coordinate, uint16_t max)
+{
+    return static_cast<uint16_t>(std::min(std::max(coordinate, 0.0f), static_cast<float>(max)));
+}
+
+void pipeline::fillConePositions(pos_api::cone_t &coneClose, pos_api::cone_t &coneFar, const cone_detect::side_t &side, uint16_t yTotal)
+{
+    // if there are atleast two cones visible, enter if block and get x and y coordinates
+    if (side.count > 1)
+    {
+        uint16_t closeX = toPixel(side.close.x, UINT16_MAX);
+        uint16_t closeY = toPixel(static_cast<float>(yTotal) - side.close.y, yTotal);
+        uint16_t farX = toPixel(side.far.x, UINT16_MAX);
+        uint16_t farY = toPixel(static_cast<float>(yTotal) - side.far.y, yTotal);
+        pos_api::cone_t tmpClose{closeX, closeY};
+        pos_api::cone_t tmpFar{farX, farY};
+        std::memcpy(&coneClose, &tmpClose, sizeof(pos_api::cone_t));
+        std::memcpy(&coneFar, &tmpFar, sizeof(pos_api::cone_t));
+    }
+    // if there are < 2 cones found, send NO_CONE_POS to represent it
+    else
+    {
+        std::memcpy(&coneClose, &pos_api::NO_CONE_POS, sizeof(pos_api::cone_t));
+        std::memcpy(&coneFar, &pos_api::NO_CONE_POS, sizeof(pos_api::cone_t));
+    }
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_PIPELINE_HPP
+#define DIT639_2023_GROUP_13_PIPELINE_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+#include <cstddef>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+// Include cluon for the shared memory the frames are copied out of
+#include "cluon-complete-v0.0.127.hpp"
+// The cone data that's handed on
+#include "../api/position.hpp"
+// The statistics published for pipeline-top
+#include "../api/telemetry.hpp"
+// The page faults of the camera's thread in real-time mode
+#include "../api/realtime.hpp"
+#include "cone-detect.hpp"
+#include "huge-pages.hpp"
+#include "qos.hpp"
+
+// Include the image processing header files from OpenCV
+#include <opencv2/imgproc/imgproc.hpp>
+
+/*
+ * The steps the cone detector takes for every frame of a camera,
+ * whether it runs one camera or several: copying the frame out of
+ * the camera's shared memory, finding the cones in it, handing
+ * them on and publishing the statistics of the frame.
+ *
+ * - region_t:          the rows the cones are looked for in
+ *
+ * - camera_t:          a camera and everything its frames run on
+ *
+ * - times_t:           when a frame got through each step
+ *
+ * - step:              runs one frame through the steps
+ *
+ * - fillConePositions: turns the cones found on one side into the
+ *                      cones of the cone data
+ */
+namespace pipeline {
+
+    /**
+     * The rows of the whole frame the cones are looked for in
+     *
+     * @param top the first row
+     * @param bottom the row after the last row
+     * @param yTotal the row of the region that the y axis of the
+     * cone data, which points up, starts at
+     */
+    struct region_t {
+        uint32_t top;
+        uint32_t bottom;
+        uint16_t yTotal;
+    };
+
+    /**
+     * A camera, with everything the frames of it run on and the
+     * statistics of them. The thread that runs its frames is the
+     * only one to write to it; the statistics are atomic so they
+     * can be reported while it runs.
+     *
+     * @param name the name of the camera's shared memory area
+     * @param core the core the camera's thread is pinned to, or -1
+     * @param region the rows the cones are looked for in
+     * @param sharedMemory the camera's shared memory area, unless
+     * its frames are replayed
+     * @param detector the cone detection of the camera
+     * @param controller the quality-of-service controller, if the
+     * frames have a deadline
+     * @param channel the pos_api channel the cones are put into, if
+     * the camera has one of its own
+     * @param publisher the publisher of the statistics, if the
+     * segment could be created
+     * @param framePool the huge pages of the frame, if it's backed
+     * by them
+     * @param frame the frame copied out of the shared memory, in
+     * BGRA or as the three planes of an I420 image
+     * @param detections the cones found in the last frame
+     * @param frames the number of frames done
+     * @param latencySum the sum of the latencies of the frames, from
+     * the notification to the cones being handed on, in microseconds
+     * @param latencyMax the highest latency of a frame
+     * @param firstDone when the first frame was done
+     * @param lastDone when the last frame was done
+     * @param faults the page faults of the camera's thread in the
+     * steady state, once it has stopped in real-time mode
+     * @param stopped whether the camera's thread has stopped, or not
+     * started
+     */
+    struct camera_t {
+        std::string name{};
+        int32_t core{-1};
+        region_t region{};
+        std::unique_ptr<cluon::SharedMemory> sharedMemory{};
+        std::unique_ptr<cone_detect::ConeDetector> detector{};
+        std::unique_ptr<qos::Controller> controller{};
+        std::unique_ptr<pos_api::Channel> channel{};
+        std::unique_ptr<telemetry::Publisher> publisher{};
+        std::unique_ptr<huge_pages::Pool> framePool{};
+        cv::Mat frame{};
+        cone_detect::detections_t detections{};
+        std::atomic<uint64_t> frames{0};
+        std::atomic<int64_t> latencySum{0};
+        std::atomic<int64_t> latencyMax{0};
+        std::atomic<int64_t> firstDone{0};
+        std::atomic<int64_t> lastDone{0};
+        realtime::faults_t faults{};
+        std::atomic<bool> stopped{true};
+    };
+
+    /**
+     * When a frame got through each step, as UNIX timestamps in
+     * microseconds
+     *
+     * @param woke when the frame was announced
+     * @param captured when it was copied out of the shared memory
+     * @param detected when its cones were found
+     * @param done when the cones were handed on
+     * @param timestamp the timestamp of the frame in the recording
+     */
+    struct times_t {
+        int64_t woke;
+        int64_t captured;
+        int64_t detected;
+        int64_t done;
+        int64_t timestamp;
+    };
+
+    /**
+     * Runs one frame through the steps: copies it out of the
+     * camera's shared memory, unless it's replayed, finds the
+     * cones in it, hands them on, steps the quality of the
+     * detection and publishes the statistics of the frame
+     *
+     * @param camera the camera the frame is of
+     * @param woke when the frame was announced
+     * @param replayed the replayed frame in BGRA, used in place,
+     * or nullptr to copy the frame out of the shared memory
+     * @param replayedTimestamp the timestamp of the replayed frame
+     * @param gsr the original ground steering request
+     * @param handOver puts the cone data into a channel or steers
+     * with it
+     * @return when the frame got through each step
+     */
+    times_t step(camera_t &camera, int64_t woke, const uint8_t *replayed, int64_t replayedTimestamp, _Float32 gsr,
+                 const std::function<void(const pos_api::data_t &)> &handOver);
+
+    /**
+     * Fills the two cones closest to the car of one side into the
+     * cone data, or NO_CONE_POS if fewer than two were found
+     *
+     * @param coneClose the cone closest to the car
+     * @param coneFar the cone second closest to the car
+     * @param side the cones found of the side
+     * @param yTotal the row the y axis of the cone data starts at
+     */
+    void fillConePositions(pos_api::cone_t &coneClose, pos_api::cone_t &coneFar, const cone_detect::side_t &side, uint16_t yTotal);
+} // !namespace pipeline
+
+#endif // !DIT639_2023_GROUP_13_PIPELINE_HPP
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// The header to implement
+#include "qos.hpp"
+
+#include <string>
+
+qos::Controller::Controller(const qos::config_t &config)
+    : m_config(config), m_level(cone_detect::FULL), m_late(0), m_early(0),
+      m_frames(), m_lateFrames(), m_micros()
+{
+}
+
+cone_detect::Quality qos::Controller::update(int64_t micros)
+{
+    const bool LATE = micros > m_config.deadline;
+    m_frames[m_level]++;
+    m_lateFrames[m_level] += LATE ? 1 : 0;
+    m_micros[m_level] += micros;
+
+    m_late = LATE ? m_late + 1 : 0;
+    m_early = micros <= (int64_t) ((double) m_config.deadline * m_config.headroom) ? m_early + 1 : 0;
+
+    if (m_late >= m_config.downFrames && m_level + 1 < cone_detect::QUALITY_COUNT)
+    {
+        m_level = (cone_detect::Quality) (m_level + 1);
+        m_late = 0;
+        m_early = 0;
+    }
+    else if (m_early >= m_config.upFrames && m_level > cone_detect::FULL)
+    {
+        m_level = (cone_detect::Quality) (m_level - 1);
+        m_late = 0;
+        m_early = 0;
+    }
+    return m_level;
+}
+
+cone_detect::Quality qos::Controller::level() const
+{
+    return m_level;
+}
+
+uint64_t qos::Controller::frames(cone_detect::Quality level) const
+{
+    return m_frames[level];
+}
+
+int64_t qos::Controller::micros(cone_detect::Quality level) const
+{
+    return m_micros[level];
+}
+
+void qos::Controller::print(std::ostream &out) const
+{
+    const std::string SEP = "----------";
+
+    out << SEP << std::endl;
+    out << "Quality (deadline " << m_config.deadline << " us, now " << cone_detect::QUALITY_NAMES[m_level]
+        << "): frames / late / ms" << std::endl;
+    out << SEP << std::endl;
+    for (uint8_t i = 0; i < cone_detect::QUALITY_COUNT; i++)
+    {
+        out << cone_detect::QUALITY_NAMES[i] << ": " << m_frames[i] << " / " << m_lateFrames[i]
+            << " / " << m_micros[i] / 1000 << std::endl;
+    }
+    out << SEP << std::endl;
+}
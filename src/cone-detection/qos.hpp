@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2023  Robert Einer, Emma Litvin, Ossian Ålund, Bao Quan Lindgren, Khaled Adel Saleh Mohammed Al-Baadani
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIT639_2023_GROUP_13_QOS_HPP
+#define DIT639_2023_GROUP_13_QOS_HPP
+
+// Include the standard int types of C
+#include <cstdint>
+#include <iostream>
+
+// The quality levels that are stepped through
+#include "cone-detect.hpp"
+
+/*
+ * A quality-of-service controller for the cone detection.
+ *
+ * It watches how long every frame takes against a deadline,
+ * e.g. the time between two frames, and steps down to a
+ * cheaper quality level when the frames keep being late, so
+ * the steering keeps up with the frames instead of falling
+ * behind them. When the frames are well within the deadline
+ * for long enough it steps back up, one level at a time.
+ *
+ * - config_t:   the configuration of a controller
+ *
+ * - Controller: steps through the quality levels
+ */
+namespace qos {
+
+    /**
+     * The configuration of a controller
+     *
+     * @param deadline the time a frame should take at most,
+     * in microseconds
+     * @param headroom the fraction of the deadline a frame has
+     * to take at most to step up
+     * @param downFrames the late frames in a row to step down after
+     * @param upFrames the frames in a row within the headroom to
+     * step up after
+     */
+    struct config_t {
+        int64_t deadline;
+        double headroom;
+        uint32_t downFrames;
+        uint32_t upFrames;
+    };
+
+    /*
+     * Steps through the quality levels of the cone detection,
+     * starting at the best one
+     */
+    class Controller {
+       public:
+        /**
+         * Creates a controller at cone_detect::FULL
+         *
+         * @param config the configuration of the controller
+         */
+        explicit Controller(const config_t &config);
+
+        /**
+         * Registers the time a frame took at the current level
+         * and steps down or up if due
+         *
+         * @param micros the time the frame took in microseconds
+         * @return the level of the next frame
+         */
+        cone_detect::Quality update(int64_t micros);
+
+        /**
+         * Gets the current level
+         *
+         * @return the level of the next frame
+         */
+        cone_detect::Quality level() const;
+
+        /**
+         * Gets the number of frames done at a level
+         *
+         * @param level the level
+         * @return the number of frames
+         */
+        uint64_t frames(cone_detect::Quality level) const;
+
+        /**
+         * Gets the time spent at a level
+         *
+         * @param level the level
+         * @return the time in microseconds
+         */
+        int64_t micros(cone_detect::Quality level) const;
+
+        /**
+         * Prints the current level, and the frames, the late
+         * frames and the time of every level
+         *
+         * @param out the stream to print to
+         */
+        void print(std::ostream &out) const;
+
+       private:
+        config_t m_config;
+        cone_detect::Quality m_level;
+        // The late frames and the frames within the headroom in a row
+        uint32_t m_late;
+        uint32_t m_early;
+        uint64_t m_frames[cone_detect::QUALITY_COUNT];
+        uint64_t m_lateFrames[cone_detect::QUALITY_COUNT];
+        int64_t m_micros[cone_detect::QUALITY_COUNT];
+    };
+} // !namespace qos
+
+#endif // !DIT639_2023_GROUP_13_QOS_HPP